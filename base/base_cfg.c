@@ -0,0 +1,169 @@
+/* Wear leveled configuration store in ATmega32 EEPROM
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>
+#include <util/crc16.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+
+#include "dnode.h"
+#include "ns741.h"
+
+#include "base_main.h"
+
+// configuration record is written to the next slot every time,
+// the one with the latest sequence number and valid crc is loaded
+#define CFG_VERSION   1
+#define CFG_SLOTS     6
+#define CFG_SLOT_SIZE 128 // header + up to 124 bytes of config + crc
+
+typedef struct cfg_hdr_s {
+	uint8_t ver;
+	uint8_t seq;
+	uint8_t len; // new fields are appended to base_cfg_t, so shorter
+	             // records from older firmware are loaded over defaults
+} cfg_hdr_t;
+
+#define CFG_CRC_OFFSET(len) (sizeof(cfg_hdr_t) + (len))
+
+static uint8_t EEMEM em_cfg[CFG_SLOTS][CFG_SLOT_SIZE];
+
+// layout 0, separate variables, read only for migration
+extern uint8_t  EEMEM em_rds_name[8];
+extern uint16_t EEMEM em_radio_freq;
+extern uint8_t  EEMEM em_osccal;
+extern uint8_t  EEMEM em_ns_rt_flags;
+extern uint8_t  EEMEM em_ns_pwr_flags;
+extern uint8_t  EEMEM em_rfm_sync;
+extern uint8_t  EEMEM em_rt_flags;
+extern uint8_t  EEMEM em_dlog[MAX_DNODE_LOGS];
+extern uint8_t  EEMEM em_dvalid[MAX_DNODE_NUM];
+extern uint8_t  EEMEM em_dan_name[MAX_DNODE_NUM][NODE_NAME_LEN];
+extern uint16_t EEMEM em_nreset;
+
+static const base_cfg_t cfg_def PROGMEM = {
+	.nreset = 0,
+	.radio_freq = 9700, // 97.00 MHz
+	// average value from serial_calibrate()
+	// for MMR70 I'm running this code on it is 168 for 115200, 181 for 38400
+	.osccal = 181,
+	.rt_flags = RT_LOAD_OSCCAL,
+	.ns_rt_flags = (NS741_STEREO | NS741_RDS | NS741_GAIN),
+	.ns_pwr_flags = NS741_TXPWR0,
+	// RFM12B sync pattern, better keep it to default 0xD4
+	// as previous versions of RFM12 do not support anything else
+	.rfm_sync = 0xD4,
+	.rds_name = "BASE 01 "
+};
+
+base_cfg_t cfg;
+
+static uint8_t cfg_slot = CFG_SLOTS - 1; // slot of the loaded record
+static uint8_t cfg_seq;
+
+static uint8_t cfg_crc(const cfg_hdr_t *hdr)
+{
+	uint8_t crc = 0;
+	const uint8_t *data = (const uint8_t *)hdr;
+	for(uint8_t i = 0; i < sizeof(cfg_hdr_t); i++)
+		crc = _crc_ibutton_update(crc, data[i]);
+	data = (const uint8_t *)&cfg;
+	for(uint8_t i = 0; i < hdr->len; i++)
+		crc = _crc_ibutton_update(crc, data[i]);
+	return crc;
+}
+
+static int8_t cfg_read(uint8_t slot, const cfg_hdr_t *hdr)
+{
+	memcpy_P(&cfg, &cfg_def, sizeof(cfg));
+	eeprom_read_block(&cfg, &em_cfg[slot][sizeof(cfg_hdr_t)], hdr->len);
+	if (eeprom_read_byte(&em_cfg[slot][CFG_CRC_OFFSET(hdr->len)]) == cfg_crc(hdr))
+		return 0;
+	return -1;
+}
+
+static void cfg_migrate(void)
+{
+	memcpy_P(&cfg, &cfg_def, sizeof(cfg));
+	// EEPROM was never programmed
+	if (eeprom_read_byte(&em_rt_flags) == 0xFF)
+		return;
+
+	cfg.nreset = eeprom_read_word(&em_nreset);
+	cfg.radio_freq = eeprom_read_word(&em_radio_freq);
+	cfg.osccal = eeprom_read_byte(&em_osccal);
+	cfg.rt_flags = eeprom_read_byte(&em_rt_flags);
+	cfg.ns_rt_flags = eeprom_read_byte(&em_ns_rt_flags);
+	cfg.ns_pwr_flags = eeprom_read_byte(&em_ns_pwr_flags);
+	cfg.rfm_sync = eeprom_read_byte(&em_rfm_sync);
+	eeprom_read_block(cfg.rds_name, em_rds_name, sizeof(cfg.rds_name));
+	eeprom_read_block(cfg.dlog, em_dlog, sizeof(cfg.dlog));
+	eeprom_read_block(cfg.dvalid, em_dvalid, sizeof(cfg.dvalid));
+	eeprom_read_block(cfg.dan_name, em_dan_name, sizeof(cfg.dan_name));
+}
+
+int8_t cfg_load(void)
+{
+	uint8_t bad = 0; // slots failed crc check
+
+	for(uint8_t n = 0; n < CFG_SLOTS; n++) {
+		cfg_hdr_t hdr, last = { 0, 0, 0 };
+		uint8_t slot = 0xFF;
+
+		// only headers are scanned, the latest record is read
+		for(uint8_t i = 0; i < CFG_SLOTS; i++) {
+			if (bad & (1 << i))
+				continue;
+			eeprom_read_block(&hdr, em_cfg[i], sizeof(hdr));
+			if (hdr.ver != CFG_VERSION || hdr.len > sizeof(base_cfg_t))
+				continue;
+			if (slot == 0xFF || (int8_t)(hdr.seq - last.seq) > 0) {
+				slot = i;
+				last = hdr;
+			}
+		}
+		if (slot == 0xFF)
+			break;
+		if (cfg_read(slot, &last) == 0) {
+			cfg_slot = slot;
+			cfg_seq = last.seq;
+			return 0;
+		}
+		bad |= 1 << slot;
+	}
+
+	cfg_migrate();
+	cfg_save();
+	return 1;
+}
+
+void cfg_save(void)
+{
+	cfg_hdr_t hdr;
+	hdr.ver = CFG_VERSION;
+	hdr.seq = ++cfg_seq;
+	hdr.len = sizeof(base_cfg_t);
+	if (++cfg_slot >= CFG_SLOTS)
+		cfg_slot = 0;
+
+	// header first, if reset happens before crc is written
+	// previous slot is still the latest valid one
+	uint8_t *slot = em_cfg[cfg_slot];
+	eeprom_update_block(&hdr, slot, sizeof(hdr));
+	eeprom_update_block(&cfg, slot + sizeof(hdr), sizeof(base_cfg_t));
+	eeprom_update_byte(slot + CFG_CRC_OFFSET(sizeof(base_cfg_t)), cfg_crc(&hdr));
+}
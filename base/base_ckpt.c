@@ -0,0 +1,189 @@
+/* Base station state checkpoint in PCF2127 battery backed RAM
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stddef.h>
+#include <string.h>
+#include <util/crc16.h>
+
+#include "dnode.h"
+#include "rfm12bs.h"
+#include "pcf2127.h"
+
+#include "base_main.h"
+
+extern dnode_status_t dans[MAX_DNODE_NUM];
+extern uint16_t last_ts[MAX_DNODE_LOGS];
+extern rfm12_t rfm868;
+
+#define CKPT_MAGIC 0xC5
+// node names are kept in EEPROM
+#define CKPT_NODE_LEN offsetof(dnode_status_t, name)
+
+typedef struct ckpt_stat_s {
+	uint8_t  magic;
+	uint8_t  year; // date and time of the checkpoint
+	uint8_t  month;
+	uint8_t  day;
+	uint8_t  hour;
+	uint8_t  min;
+	uint32_t nses;
+	uint16_t nto;
+	uint16_t last_ts[MAX_DNODE_LOGS]; // log cursors
+} ckpt_stat_t;
+
+// RAM layout: stat record, then node records, each one followed by crc8
+// (22 + 1) + 12*(27 + 1) = 359 bytes, fits 512 bytes of PCF_RAM_SIZE
+#define CKPT_STAT_ADDR 0
+#define CKPT_NODE_ADDR(nid) (sizeof(ckpt_stat_t) + 1 + (nid)*(CKPT_NODE_LEN + 1))
+#define CKPT_BUF_LEN (CKPT_NODE_LEN + 1)
+
+static uint16_t ckpt_dirty; // nodes to be written
+static uint8_t  ckpt_stat;  // stat record to be written
+
+static uint8_t ckpt_crc(const uint8_t *data, uint8_t len)
+{
+	// non-zero seed, so cleared RAM is not a valid record
+	uint8_t crc = CKPT_MAGIC;
+	for(uint8_t i = 0; i < len; i++)
+		crc = _crc_ibutton_update(crc, data[i]);
+	return crc;
+}
+
+static int8_t ckpt_write(uint16_t addr, const void *data, uint8_t len)
+{
+	uint8_t buf[CKPT_BUF_LEN];
+	memcpy(buf, data, len);
+	buf[len] = ckpt_crc(buf, len);
+	return pcf2127_ram_write(addr, buf, len + 1);
+}
+
+static int8_t ckpt_read(uint16_t addr, void *data, uint8_t len)
+{
+	uint8_t buf[CKPT_BUF_LEN];
+	if (pcf2127_ram_read(addr, buf, len + 1) != 0)
+		return -1;
+	if (buf[len] != ckpt_crc(buf, len))
+		return -1;
+	memcpy(data, buf, len);
+	return 0;
+}
+
+// days since 1 March 1900, valid for years 2000-2099
+static uint32_t ckpt_days(uint8_t year, uint8_t month, uint8_t day)
+{
+	uint8_t  l = (month <= 2) ? 1 : 0;
+	uint16_t y = 100 + year - l;
+	return day + ((uint32_t)y * 36525) / 100 + ((uint32_t)(month + 1 + l * 12) * 306001) / 10000;
+}
+
+void ckpt_node(uint8_t nid)
+{
+	ckpt_dirty |= 1u << nid;
+	ckpt_stat = 1;
+}
+
+void ckpt_reset(void)
+{
+	ckpt_dirty = (1u << MAX_DNODE_NUM) - 1;
+	ckpt_stat = 1;
+}
+
+void ckpt_flush(void)
+{
+	// one node per call, stat record last so it is not
+	// newer than nodes in case of reset between writes
+	if (ckpt_dirty) {
+		uint8_t nid = 0;
+		while(!(ckpt_dirty & (1u << nid)))
+			nid++;
+		if (ckpt_write(CKPT_NODE_ADDR(nid), &dans[nid], CKPT_NODE_LEN) == 0)
+			ckpt_dirty &= ~(1u << nid);
+		return;
+	}
+
+	if (!ckpt_stat)
+		return;
+
+	ckpt_stat_t st;
+	pcf_td_t td;
+	if (pcf2127_get_date(&td) != 0)
+		return;
+	st.magic = CKPT_MAGIC;
+	st.year  = td.year;
+	st.month = td.month;
+	st.day   = td.day;
+	st.hour = td.hour;
+	st.min  = td.min;
+	st.nses = rfm868.nses;
+	st.nto  = rfm868.nto;
+	memcpy(st.last_ts, last_ts, sizeof(last_ts));
+	if (ckpt_write(CKPT_STAT_ADDR, &st, sizeof(st)) == 0)
+		ckpt_stat = 0;
+}
+
+int8_t ckpt_restore(void)
+{
+	ckpt_stat_t st;
+	pcf_td_t td;
+
+	if ((ckpt_read(CKPT_STAT_ADDR, &st, sizeof(st)) != 0) ||
+		(st.magic != CKPT_MAGIC) || (pcf2127_get_date(&td) != 0)) {
+		// write complete image on the first flush
+		ckpt_reset();
+		return -1;
+	}
+
+	// checkpoint is used only if it was made today or less
+	// than 24 hours ago yesterday, older one is discarded
+	uint16_t now = td.hour * 60 + td.min;
+	uint32_t days = ckpt_days(td.year, td.month, td.day);
+	uint32_t ckpt = ckpt_days(st.year, st.month, st.day);
+	if ((days != ckpt) && ((days != ckpt + 1) || (now >= (st.hour * 60 + st.min)))) {
+		ckpt_reset();
+		return -1;
+	}
+
+	rfm868.nses = st.nses;
+	rfm868.nto  = st.nto;
+	memcpy(last_ts, st.last_ts, sizeof(last_ts));
+
+	for(uint8_t nid = 0; nid < MAX_DNODE_NUM; nid++) {
+		dnode_status_t dan;
+		if (ckpt_read(CKPT_NODE_ADDR(nid), &dan, CKPT_NODE_LEN) != 0) {
+			ckpt_node(nid);
+			continue;
+		}
+		// valid and log flags are set from EEPROM
+		dnode_status_t *pdan = &dans[nid];
+		uint8_t flags = pdan->flags & (DANF_VALID | DANF_LOG);
+		uint8_t log = pdan->log;
+		memcpy(pdan, &dan, CKPT_NODE_LEN);
+		pdan->flags = (dan.flags & ~(DANF_VALID | DANF_LOG)) | flags | DANF_ACTIVE;
+		pdan->log = log;
+
+		// timeout counts minutes since the last session
+		uint16_t age = now + 24*60 - (pdan->ts[0] * 60 + pdan->ts[1]);
+		if (age >= 24*60)
+			age -= 24*60;
+		if (age >= pdan->tout)
+			pdan->tout = 0;
+		else
+			pdan->tout -= age;
+	}
+
+	return 0;
+}
@@ -27,6 +27,8 @@
 #include "pinio.h"
 #include "sht1x.h"
 #include "ns741.h"
+#include "task.h"
+#include "stack.h"
 #include "timer.h"
 #include "bmfont.h"
 #include "serial.h"
@@ -34,69 +36,72 @@
 #include "ili9225.h"
 #include "pcf2127.h"
 #include "serial_cli.h"
+#if PROFILER
+#include "prof.h"
+#endif
 
 #include "base_main.h"
 
 static const char version[] PROGMEM = "2018-03-25\n";
 
-// list of supported commands 
-const char cmd_list[] PROGMEM = 
-	"  mem\n"
-	"  poll\n"
-	"  reset\n"
-	"  status\n"
-	"  calibrate\n"
-	"  set osccal X\n"
-	"  time\n"
-	"  date\n"
-	"  set time HH:MM:SS\n"
-	"  set date YY/MM/DD\n"
-	"  echo rx|dan|rht|log|rds [on|off]\n"
-
-	"  ili dir 0|1\n"
-	"  ili led on|off|0-255\n"
-	"  ili disp standby|off|on\n"
-
-	"  dan show log NID\n"
-	"  dan show status NID\n"
-	"  dan set name NID str\n"
-	"  dan set log NID on|off\n"
-	"  dan set valid NID on|off\n"
-
-	"  rtc dump [mem]|init [mem]\n"
-	"  rtc dst on|off\n"
-	"  adc chan\n"
-	"  get pin (d3,b4,c2...)\n"
-	"  rdsid id\n"
-	"  rdstext\n"
-	"  freq nnnn\n"
-	"  txpwr 0-3\n"
-	"  radio on|off\n";
-
 extern ili9225_t ili;
 
-extern uint8_t EEMEM em_dlog[MAX_DNODE_LOGS];
-extern uint8_t EEMEM em_dvalid[MAX_DNODE_NUM];
 extern dnode_status_t dans[MAX_DNODE_NUM];
-extern uint8_t  EEMEM em_dan_name[MAX_DNODE_NUM][NODE_NAME_LEN];
 
 extern const char pstr_tformat[];
-static const char pstr_on[] PROGMEM = "on";
-static const char pstr_off[] PROGMEM = "off";
 static const char pstr_mem[] PROGMEM = "mem";
-static const char pstr_set[] PROGMEM = "set";
-static const char pstr_log[] PROGMEM = "log";
-static const char pstr_dan[] PROGMEM = "dan";
-static const char pstr_date[] PROGMEM = "date";
-static const char pstr_time[] PROGMEM = "time";
-static const char pstr_valid[] PROGMEM = "valid";
-static const char pstr_radio[] PROGMEM = "radio";
 static const char pstr_reset[] PROGMEM = "reset";
-static const char pstr_status[] PROGMEM = "status";
 static const char pstr_echo[] PROGMEM = "echo";
 static const char pstr_set_to[] PROGMEM = "%s set to %d\n";
 
-static void set_echo(char *name, uint8_t flag, int8_t echo)
+static const char task_name[TASK_NUM][5] PROGMEM = {
+	"rf", "rds", "cli", "disp", "sens", "rht"
+};
+
+// 'dan show log' is printed one record per step
+static int8_t   dump_log = -1;
+static uint16_t dump_ridx;
+static uint16_t dump_cnt;
+
+static int8_t dump_log_start(uint8_t log)
+{
+	uint8_t ts[3];
+	pcf2127_get_time((pcf_td_t *)ts, 0);
+	dump_ridx = ts[0]*60 + ts[1];
+	dump_cnt = 0;
+	dump_log = log;
+	return CLI_EMORE;
+}
+
+uint8_t cli_base_step(void)
+{
+	if (dump_log < 0)
+		return TASK_DONE;
+
+	dnode_log_t rec;
+	dump_ridx = log_next_rec_index(dump_ridx);
+	log_read_rec(dump_log, dump_ridx, &rec);
+	uint8_t hour = dump_ridx / 60;
+	uint8_t min = dump_ridx % 60;
+	printf("%02u:%02u ", hour, min);
+	if (rec.ssi & 0x80) {
+		int8_t val = rec.data.val;
+		if (val & 0x80)
+			val = -(val & 0x7F);
+		printf("ARSSI %3u%% T %+3d.%02u", rec.ssi & 0x7F, val, rec.data.dec);
+	}
+	else
+		uart_puts(" --- - --.--");
+	uart_puts("\n");
+
+	if (++dump_cnt < 24*60)
+		return TASK_MORE;
+	dump_log = -1;
+	cli_prompt();
+	return TASK_DONE;
+}
+
+static void set_echo(const char *name, uint8_t flag, int8_t echo)
 {
 	if (echo == 1)
 		rt_flags |= flag;
@@ -110,6 +115,16 @@ static void set_echo(char *name, uint8_t flag, int8_t echo)
 	uart_puts("\n");
 }
 
+// only osccal loading and rx echo are persistent
+static void cfg_set_rt_flags(void)
+{
+	uint8_t flags = rt_flags & (RT_LOAD_OSCCAL | RT_ECHO_RX);
+	if (cfg.rt_flags != flags) {
+		cfg.rt_flags = flags;
+		cfg_save();
+	}
+}
+
 static int8_t strtonid(const char *str)
 {
 	int8_t nid = atoi(str);
@@ -118,471 +133,674 @@ static int8_t strtonid(const char *str)
 	return nid - 1;
 }
 
-int8_t cli_base(char *buf, void *rht)
+extern const cli_cmd_t base_cmds[];
+
+static int8_t cmd_help(char *arg UNUSED, void *ptr UNUSED)
+{
+	uart_puts_p(PSTR("  version: "));
+	uart_puts_p(version);
+	cli_help(base_cmds);
+	return 0;
+}
+
+static int8_t cmd_time(char *arg UNUSED, void *ptr UNUSED)
+{
+	return print_rtc_time();
+}
+
+static int8_t cmd_date(char *arg UNUSED, void *ptr UNUSED)
 {
-	char *arg;
-	char cmd[CMD_LEN + 1];
+	pcf_td_t td;
+	if (pcf2127_get_date(&td) == 0) {
+		printf_P(PSTR("20%02d/%02d/%02d "), td.year, td.month, td.day);
+		printf_P(pstr_tformat, td.hour, td.min, td.sec);
+		uart_puts("\n");
+		return 0;
+	}
+	return CLI_ENODEV;
+}
 
-	memcpy(cmd, buf, sizeof(cmd));
-	arg = get_arg(cmd);
+static int8_t cmd_reset(char *arg UNUSED, void *ptr UNUSED)
+{
+	uart_puts("\n");
+	uart_puts("...");
+	cfg.nreset = 0;
+	cfg_save();
+	wdt_enable(WDTO_15MS);
+	while(1);
+	return 0;
+}
+
+static int8_t cmd_poll(char *arg UNUSED, void *rht)
+{
+	uart_puts("...");
+	rht_read(rht, RT_ECHO_RHT, rds_data);
+	return 0;
+}
 
-	if (str_is(cmd, PSTR("help"))) {
-		uart_puts_p(PSTR("  version: "));
-		uart_puts_p(version);
-		uart_puts_p(cmd_list);
+static int8_t cmd_task(char *arg, void *ptr UNUSED)
+{
+	if (str_is(arg, pstr_reset)) {
+		task_reset_stats();
 		return 0;
 	}
+	for(uint8_t cls = 0; cls < TASK_NUM; cls++) {
+		const task_t *pt = task_get(cls);
+		uart_puts_p(task_name[cls]);
+		printf_P(PSTR("\tlatency %5u run %5u msec\n"), pt->wlat, pt->wrun);
+	}
+	return 0;
+}
 
-	if (str_is(cmd, pstr_time))
-		return print_rtc_time();
-	
-	if (str_is(cmd, pstr_date)) {
-		pcf_td_t td;
-		if (pcf2127_get_date(&td) == 0) {
-			printf_P(PSTR("20%02d/%02d/%02d "), td.year, td.month, td.day);
-			printf_P(pstr_tformat, td.hour, td.min, td.sec);
-			uart_puts("\n");
-			return 0;
-		}
-		return CLI_ENODEV;
+// free memory, stack high water mark and the previous run record
+static int8_t cmd_mem(char *arg UNUSED, void *ptr UNUSED)
+{
+	printf_P(PSTR("memory %u stack %u unused %u\n"), free_mem(), stack_size(), stack_unused());
+	const stack_rec_t *last = stack_last();
+	if (last) {
+		printf_P(PSTR("last run unused %u"), last->unused);
+		if (last->flags & STACK_OVERFLOW)
+			printf_P(PSTR(" overflow sp %04X"), last->sp);
+		else if (stack_rec.flags & STACK_WDT)
+			uart_puts_p(PSTR(" watchdog reset"));
+		else if (stack_rec.flags & STACK_EXT)
+			uart_puts_p(PSTR(" external reset"));
+		serial_putc('\n');
 	}
+	return 0;
+}
 
-	if (str_is(cmd, pstr_reset)) {
-		uart_puts("\n");
-		uart_puts("...");
-		eeprom_write_word(&em_nreset, 0);
-		wdt_enable(WDTO_15MS);
-		while(1);
+static void perf_print(const char *name, const perf_t *pp, uint32_t limit)
+{
+	uint16_t over = 0;
+	uart_puts_p(name);
+	printf_P(PSTR("\tworst %lu usec"), pp->worst);
+	if (pp->job < TASK_NUM) {
+		uart_puts_p(PSTR(" by "));
+		uart_puts_p(task_name[pp->job]);
+	}
+	printf_P(PSTR(" at %lu sec\n"), pp->when / 1000);
+	for(uint8_t i = 0; i < PERF_BUCKETS; i++) {
+		uint32_t usec = perf_bucket_usec(i);
+		if (usec >= limit)
+			over += pp->hist[i];
+		if (pp->hist[i])
+			printf_P(PSTR("%8lu %5u\n"), usec, pp->hist[i]);
 	}
+	if (limit)
+		printf_P(PSTR("over %lu usec %u\n"), limit, over);
+}
 
-	if (str_is(cmd, PSTR("calibrate"))) {
-		uart_puts("\n");
-		uart_puts("...");
-		if (str_is(arg, PSTR("default")))
-			serial_calibrate(osccal_def);
-		else
-			serial_calibrate(OSCCAL);
+// log2 histograms of main loop and radio poll intervals
+static int8_t cmd_perf(char *arg, void *ptr UNUSED)
+{
+	if (str_is(arg, pstr_reset)) {
+		perf_start();
 		return 0;
 	}
+	perf_print(PSTR("loop"), &perf_loop, 0);
+	perf_print(PSTR("rf"), &perf_rf, PERF_RF_LIMIT);
+	return 0;
+}
+
+static int8_t cmd_status(char *arg UNUSED, void *ptr UNUSED)
+{
+	print_status(1);
+	return 0;
+}
 
-	if (str_is(cmd, PSTR("poll"))) {
-		uart_puts("...");
-		rht_read(rht, RT_ECHO_RHT, rds_data);
-		ns741_rds_set_radiotext(rds_data);
+// rtc ------------------------------------------------------------------------
+static int8_t rtc_init(char *arg, void *ptr UNUSED)
+{
+	if (str_is(arg, pstr_mem)) {
+		uint8_t buf[16];
+		memset(buf, 0, sizeof(buf));
+		for(uint8_t i = 0; i < PCF_RAM_SIZE/16; i++)
+			pcf2127_ram_write(i*16, buf, 16);
+		ckpt_reset();
 		return 0;
 	}
 
-	if (str_is(cmd, pstr_mem)) {
-		printf_P(PSTR("available %d\n"), free_mem());
+	pcf2127_init();
+	return 0;
+}
+
+static int8_t rtc_dump(char *arg, void *ptr UNUSED)
+{
+	uint8_t buf[PCF_MAX_REG > 16 ? PCF_MAX_REG : 16];
+
+	if (str_is(arg, pstr_mem)) {
+		for(uint8_t i = 0; i < PCF_RAM_SIZE/16; i++) {
+			if (pcf2127_ram_read(i*16, buf, 16) != 0)
+				return -1;
+			printf_P(PSTR("%3u | "), i*16);
+			for(int8_t n = 0; n < 16; n++)
+				printf("%02X ", buf[n]);
+			uart_puts("\n");
+		}
 		return 0;
 	}
 
-	if (str_is(cmd, pstr_status)) {
-		print_status(1);
+	if (pcf2127_read(0x00, buf, PCF_MAX_REG) == 0) {
+		for(int8_t i = 0; i < PCF_MAX_REG; i++) {
+			printf("%02X ", i);
+		}
+		uart_puts("\n");
+		for(int8_t i = 0; i < PCF_MAX_REG; i++) {
+			printf("%02X ", buf[i]);
+		}
+		uart_puts("\n");
 		return 0;
 	}
+	return -1;
+}
 
-	// rtc --------------------------------------------------------------------
-	if (str_is(cmd, PSTR("rtc"))) {
-		char *sval = get_arg(arg);
-		if (str_is(arg, PSTR("init"))) {
-			if (str_is(sval, pstr_mem)) {
-				for(uint8_t i = 0; i < 16; i++)
-					cmd[i] = 0;
-				for(uint8_t i = 0; i < PCF_RAM_SIZE/16; i++)
-					pcf2127_ram_write(i*16, (uint8_t *)cmd, 16);
-				return 0;
-			}
+static int8_t rtc_dst(char *arg, void *ptr UNUSED)
+{
+	uint8_t ts[3];
+	int8_t on = get_on_off(arg);
+	if (on < 0)
+		return -1;
+	pcf2127_get_time((pcf_td_t *)ts, 0);
+	if (on) {
+		uint8_t hour = ts[0] + 1;
+		if (hour > 23)
+			hour = 0;
+		ts[0] = hour;
+	}
+	else {
+		if (ts[0] != 0)
+			ts[0] -= 1;
+		else
+			ts[0] = 23;
+	}
+	pcf2127_set_time((pcf_td_t *)ts);
+	return print_rtc_time();
+}
 
-			pcf2127_init();
-			return 0;
-		}
+// set ------------------------------------------------------------------------
+static int8_t set_osccal(char *arg, void *ptr UNUSED)
+{
+	uint8_t osc = atoi(arg);
+	serial_set_osccal(osc);
+	cfg.osccal = osc;
+	cfg_save();
+	return 0;
+}
 
-		if (str_is(arg, PSTR("dump"))) {
-			if (str_is(sval, pstr_mem)) {
-				for(uint8_t i = 0; i < PCF_RAM_SIZE/16; i++) {
-					if (pcf2127_ram_read(i*16, (uint8_t *)cmd, 16) != 0)
-						return -1;
-					printf_P(PSTR("%3u | "), i*16);
-					for(int8_t n = 0; n < 16; n++)
-						printf("%02X ", cmd[n]);
-					uart_puts("\n");
-				}
-				return 0;
-			}
+static int8_t set_time(char *arg, void *ptr UNUSED)
+{
+	uint8_t ts[3];
+	if (get_hms(arg, ts) != 0)
+		return -1;
+	pcf2127_set_time((pcf_td_t *)ts);
+	return 0;
+}
 
-			if (pcf2127_read(0x00, (uint8_t *)cmd, PCF_MAX_REG) == 0) {
-				for(int8_t i = 0; i < PCF_MAX_REG; i++) {
-					printf("%02X ", i);
-				}
-				uart_puts("\n");
-				for(int8_t i = 0; i < PCF_MAX_REG; i++) {
-					printf("%02X ", cmd[i]);
-				}
-				uart_puts("\n");
+static int8_t set_date(char *arg, void *ptr UNUSED)
+{
+	pcf_td_t ts;
+	ts.year = strtoul(arg, &arg, 10);
+	if (ts.year < 99 && *arg == '/') {
+		ts.month = strtoul(arg + 1, &arg, 10);
+		if (ts.month < 13 && *arg == '/') {
+			ts.day = strtoul(arg + 1, &arg, 10);
+			if (ts.day < 31) {
+				pcf2127_set_date(&ts);
 				return 0;
 			}
-			return -1;
 		}
+	}
+	return -1;
+}
 
-		if (str_is(arg, PSTR("dst"))) {
-			uint8_t ts[3];
-			pcf2127_get_time((pcf_td_t *)ts, 0);
-			if (str_is(sval, pstr_on)) {
-				uint8_t hour = ts[0] + 1;
-				if (hour > 23)
-					hour = 0;
-				ts[0] = hour;
-				pcf2127_set_time((pcf_td_t *)ts);
-				return print_rtc_time();
-			}
-			if (str_is(sval, pstr_off)) {
-				if (ts[0] != 0)
-					ts[0] -= 1;
-				else
-					ts[0] = 23;
-				pcf2127_set_time((pcf_td_t *)ts);
-				return print_rtc_time();
-			}
-			return -1;
-		}
+// echo -----------------------------------------------------------------------
+static int8_t cmd_echo(char *arg, void *ptr UNUSED)
+{
+	if (*arg)
 		return -1;
-	}
+	set_echo("rx ", RT_ECHO_RX, -1);
+	set_echo("dan", RT_ECHO_DAN, -1);
+	set_echo("rht", RT_ECHO_RHT, -1);
+	set_echo("log", RT_ECHO_LOG, -1);
+	return 0;
+}
 
-	// set --------------------------------------------------------------------
-	if (str_is(cmd, pstr_set)) {
-		char *sval = get_arg(arg);
+static int8_t echo_rx(char *arg, void *ptr UNUSED)
+{
+	set_echo("rx", RT_ECHO_RX, get_on_off(arg));
+	cfg_set_rt_flags();
+	return 0;
+}
 
-		if (str_is(arg, PSTR("osccal"))) {
-			uint8_t osc = atoi(sval);
-			serial_set_osccal(osc);
-			eeprom_update_byte(&em_osccal, osc);
-			return 0;
-		}
+static int8_t echo_dan(char *arg, void *ptr UNUSED)
+{
+	set_echo("dan", RT_ECHO_DAN, get_on_off(arg));
+	return 0;
+}
 
-		if (str_is(arg, pstr_time)) {
-			uint8_t ts[3];
-			ts[0] = strtoul(sval, &arg, 10);
-			if (ts[0] < 24 && *arg == ':') {
-				ts[1] = strtoul(arg + 1, &arg, 10);
-				if (ts[1] < 60 && *arg == ':') {
-					ts[2] = strtoul(arg + 1, &arg, 10);
-					if (ts[2] < 60) {
-						pcf2127_set_time((pcf_td_t *)ts);
-						return 0;
-					}
-				}
-			}
-		}
+static int8_t echo_rht(char *arg, void *ptr UNUSED)
+{
+	set_echo("rht", RT_ECHO_RHT, get_on_off(arg));
+	return 0;
+}
 
-		if (str_is(arg, pstr_date)) {
-			pcf_td_t ts;
-			ts.year = strtoul(sval, &arg, 10);
-			if (ts.year < 99 && *arg == '/') {
-				ts.month = strtoul(arg + 1, &arg, 10);
-				if (ts.month < 13 && *arg == '/') {
-					ts.day = strtoul(arg + 1, &arg, 10);
-					if (ts.day < 31) {
-						pcf2127_set_date(&ts);
-						return 0;
-					}
-				}
-			}
-		}
-		return -1;
+static int8_t echo_log(char *arg, void *ptr UNUSED)
+{
+	set_echo("log", RT_ECHO_LOG, get_on_off(arg));
+	return 0;
+}
+
+static int8_t echo_rds(char *arg, void *ptr UNUSED)
+{
+	int8_t echo = get_on_off(arg);
+	if (echo >= 0)
+		ns741_rds_debug(echo);
+	return 0;
+}
+
+static int8_t echo_off(char *arg UNUSED, void *ptr UNUSED)
+{
+	rt_flags &= ~(RT_ECHO_RX | RT_ECHO_DAN | RT_ECHO_RHT | RT_ECHO_LOG);
+	cfg_set_rt_flags();
+	ns741_rds_debug(0);
+	uart_puts_p(pstr_echo);
+	uart_putc(' ');
+	uart_puts(is_on(0));
+	uart_puts("\n");
+	return 0;
+}
+
+static int8_t cmd_adc(char *arg, void *ptr UNUSED)
+{
+	uint8_t ai = atoi((const char *)arg);
+	if (ai < 8) {
+		uint8_t adc = analogGetChannel();
+		uint16_t val = analogRead(ai);
+		analogSetChannel(adc);
+		printf_P(PSTR("ADC %d %4d\n"), ai, val);
+		return 0;
 	}
+	return -1;
+}
 
-	// echo -------------------------------------------------------------------
-	if (str_is(cmd, pstr_echo)) {
-		int8_t echo = -1;
-		char *sval = get_arg(arg);
-		if (str_is(sval, pstr_on))
-			echo = 1;
-		else if (str_is(sval, pstr_off))
-			echo = 0;
-		if (str_is(arg, PSTR("rx"))) {
-			set_echo(arg, RT_ECHO_RX, echo);
-			eeprom_update_byte(&em_rt_flags, rt_flags & (RT_LOAD_OSCCAL | RT_ECHO_RX));
-			return 0;
-		}
-		if (str_is(arg, pstr_dan)) {
-			set_echo(arg, RT_ECHO_DAN, echo);
-			return 0;
-		}
-		if (str_is(arg, PSTR("rht"))) {
-			set_echo(arg, RT_ECHO_RHT, echo);
-			return 0;
-		}
-		if (str_is(arg, pstr_log)) {
-			set_echo(arg, RT_ECHO_LOG, echo);
-			return 0;
-		}
-		if (str_is(arg, PSTR("rds"))) {
-			if (echo >= 0)
-				ns741_rds_debug(echo);
-			return 0;
-		}
-		if (str_is(arg, pstr_off)) {
-			rt_flags &= ~(RT_ECHO_RX | RT_ECHO_DAN | RT_ECHO_RHT | RT_ECHO_LOG);
-			eeprom_update_byte(&em_rt_flags, rt_flags & (RT_LOAD_OSCCAL | RT_ECHO_RX));
-			ns741_rds_debug(0);
-			uart_puts_p(pstr_echo);
-			uart_putc(' ');
-			uart_puts(is_on(0));
-			uart_puts("\n");
-			return 0;
-		}
-		if (*arg == 0) {
-			set_echo("rx ", RT_ECHO_RX, -1);
-			set_echo("dan", RT_ECHO_DAN, -1);
-			set_echo("rht", RT_ECHO_RHT, -1);
-			set_echo("log", RT_ECHO_LOG, -1);
-			return 0;
-		}
+// radio ----------------------------------------------------------------------
+static int8_t cmd_rdsid(char *arg, void *ptr UNUSED)
+{
+	if (*arg != '\0') {
+		memset(rds_name, ' ', 8);
+		for(int8_t i = 0; (i < 8) && arg[i]; i++)
+			rds_name[i] = arg[i];
+		ns741_rds_set_progname(rds_name);
+		memcpy(cfg.rds_name, rds_name, 8);
+		cfg_save();
+	}
+	printf_P(PSTR("rdsid %s\n"), rds_name);
+	putlx(0, 4, rds_name, 0);
+	return 0;
+}
+
+static int8_t cmd_rdstext(char *arg UNUSED, void *ptr UNUSED)
+{
+	char buf[RDS_TEXT_LEN + 1];
+	rds_get_text(buf);
+	puts(buf);
+	return 0;
+}
+
+static int8_t cmd_freq(char *arg, void *ptr UNUSED)
+{
+	uint16_t freq = atoi((const char *)arg);
+	if (freq < NS741_MIN_FREQ || freq > NS741_MAX_FREQ) {
+		uart_puts_p(PSTR("Frequency is out of band\n"));
 		return -1;
 	}
+	freq = NS741_FREQ_STEP*(freq / NS741_FREQ_STEP);
+	if (freq != radio_freq) {
+		radio_freq = freq;
+		ns741_set_frequency(radio_freq);
+		cfg.radio_freq = radio_freq;
+		cfg_save();
+	}
+	printf_P(pstr_set_to, "freq", radio_freq);
+	get_fm_freq(fm_freq);
+	putlx(2, -1, fm_freq, TEXT_OVERLINE | TEXT_UNDERLINE);
+	return 0;
+}
 
-	if (str_is(cmd, PSTR("adc"))) {
-		uint8_t ai = atoi((const char *)arg);
-		if (ai < 8) {
-			uint8_t adc = analogGetChannel();
-			uint16_t val = analogRead(ai);
-			analogSetChannel(adc);
-			printf_P(PSTR("ADC %d %4d\n"), ai, val);
-			return 0;
-		}
+static int8_t cmd_txpwr(char *arg, void *ptr UNUSED)
+{
+	uint8_t pwr = atoi((const char *)arg);
+	if (pwr > 3) {
+		uart_puts_p(PSTR("Invalid TX power level\n"));
 		return -1;
 	}
+	ns_pwr_flags &= ~NS741_TXPWR;
+	ns_pwr_flags |= pwr;
+	ns741_txpwr(pwr);
+	printf_P(pstr_set_to, "txpwr", pwr);
+	cfg.ns_pwr_flags = ns_pwr_flags;
+	cfg_save();
+	update_radio_status();
+	return 0;
+}
 
-	if (str_is(cmd, PSTR("get"))) {
-		char   port = arg[0];
-		uint8_t idx = atoi(arg+1) & 0x07;
-		uint8_t val = 0;
-		if (port == 'b')
-			val = _pin_get(&PINB, 1 << idx);
-		if (port == 'c')
-			val = _pin_get(&PINC, 1 << idx);
-		if (port == 'd')
-			val = _pin_get(&PIND, 1 << idx);
-		printf_P(PSTR("%c%d = %d\n"), port, idx, !!val);
+static int8_t cmd_radio(char *arg, void *ptr UNUSED)
+{
+	int8_t on = get_on_off(arg);
+	if (on == 1)
+		ns_pwr_flags |= NS741_POWER;
+	else if (on == 0)
+		ns_pwr_flags &= ~NS741_POWER;
+	ns741_radio_power(ns_pwr_flags & NS741_POWER);
+	cfg.ns_pwr_flags = ns_pwr_flags;
+	cfg_save();
+	uart_puts_p(PSTR("radio "));
+	uart_puts(is_on(ns_pwr_flags & NS741_POWER));
+	uart_puts("\n");
+	update_radio_status();
+	return 0;
+}
+
+// ili ------------------------------------------------------------------------
+static int8_t ili_disp(char *arg, void *ptr UNUSED)
+{
+	int8_t on = get_on_off(arg);
+	if (on == 1) {
+		ili9225_set_disp(&ili, ILI9225_DISP_ON);
 		return 0;
 	}
-
-	// radio ------------------------------------------------------------------
-	if (str_is(cmd, PSTR("rdsid"))) {
-		if (*arg != '\0') {
-			memset(rds_name, ' ', 8);
-			for(int8_t i = 0; (i < 8) && arg[i]; i++)
-				rds_name[i] = arg[i];
-			ns741_rds_set_progname(rds_name);
-			eeprom_update_block((const void *)rds_name, (void *)em_rds_name, 8);
-		}
-		printf_P(PSTR("%s %s\n"), cmd, rds_name);
-		putlx(0, 4, rds_name, 0);
+	if (on == 0) {
+		ili9225_set_disp(&ili, ILI9225_DISP_OFF);
 		return 0;
 	}
-
-	if (str_is(cmd, PSTR("rdstext"))) {
-		puts(rds_data);
+	if (str_is(arg, PSTR("standby"))) {
+		ili9225_set_disp(&ili, ILI9225_DISP_STANDBY);
 		return 0;
 	}
+	return CLI_EARG;
+}
 
-	if (str_is(cmd, PSTR("freq"))) {
-		uint16_t freq = atoi((const char *)arg);
-		if (freq < NS741_MIN_FREQ || freq > NS741_MAX_FREQ) {
-			uart_puts_p(PSTR("Frequency is out of band\n"));
-			return -1;
-		}
-		freq = NS741_FREQ_STEP*(freq / NS741_FREQ_STEP);
-		if (freq != radio_freq) {
-			radio_freq = freq;
-			ns741_set_frequency(radio_freq);
-			eeprom_update_word(&em_radio_freq, radio_freq);
-		}
-		printf_P(pstr_set_to, cmd, radio_freq);
-		get_fm_freq(fm_freq);
-		putlx(2, -1, fm_freq, TEXT_OVERLINE | TEXT_UNDERLINE);
+static int8_t ili_led(char *arg, void *ptr UNUSED)
+{
+	int8_t on = get_on_off(arg);
+	if (on == 1) {
+		ili9225_set_backlight(&ili, ILI9225_BKL_ON);
 		return 0;
 	}
-
-	if (str_is(cmd, PSTR("txpwr"))) {
-		uint8_t pwr = atoi((const char *)arg);
-		if (pwr > 3) {
-			uart_puts_p(PSTR("Invalid TX power level\n"));
-			return -1;
-		}
-		ns_pwr_flags &= ~NS741_TXPWR;
-		ns_pwr_flags |= pwr;
-		ns741_txpwr(pwr);
-		printf_P(pstr_set_to, cmd, pwr);
-		eeprom_update_byte(&em_ns_pwr_flags, ns_pwr_flags);
-		update_radio_status();
+	if (on == 0) {
+		ili9225_set_backlight(&ili, ILI9225_BKL_OFF);
 		return 0;
 	}
+	uint8_t duty = atoi(arg);
+	ili9225_set_backlight(&ili, duty);
+	return CLI_EOK;
+}
 
-	if (str_is(cmd, pstr_radio)) {
-		if (str_is(arg, pstr_on))
-			ns_pwr_flags |= NS741_POWER;
-		else if (str_is(arg, pstr_off))
-			ns_pwr_flags &= ~NS741_POWER;
-		ns741_radio_power(ns_pwr_flags & NS741_POWER);
-		eeprom_update_byte(&em_ns_pwr_flags, ns_pwr_flags);
-		uart_puts_p(pstr_radio);
-		uart_putc(' ');
-		uart_puts(is_on(ns_pwr_flags & NS741_POWER));
-		uart_puts("\n");
-		update_radio_status();
-		return 0;
+static int8_t ili_dir(char *arg, void *ptr UNUSED)
+{
+	uint8_t dir = atoi(arg);
+	ili9225_set_dir(&ili, dir);
+	return 0;
+}
+
+// dan ------------------------------------------------------------------------
+static int8_t dan_show_status(char *arg, void *ptr UNUSED)
+{
+	int8_t nid = strtonid(arg);
+	if (nid < 0)
+		return CLI_EARG;
+	print_node(nid);
+	return 0;
+}
+
+static int8_t dan_show_log(char *arg, void *ptr UNUSED)
+{
+	int8_t nid = strtonid(arg);
+	if (nid < 0 || !(dans[nid].flags & DANF_LOG))
+		return CLI_EARG;
+	return dump_log_start(dans[nid].log);
+}
+
+static int8_t dan_set_name(char *arg, void *ptr UNUSED)
+{
+	char *str = get_arg(arg);
+	int8_t nid = strtonid(arg);
+	if (nid < 0)
+		return CLI_EARG;
+	uint8_t *name = dans[nid].name;
+	memset(name, 0, NODE_NAME_LEN);
+	for(uint8_t i = 0; i < (NODE_NAME_LEN - 1); i++) {
+		if (str[i] == 0)
+			break;
+		name[i] = str[i];
 	}
+	memcpy(cfg.dan_name[nid], name, NODE_NAME_LEN);
+	cfg_save();
+	return 0;
+}
 
-	// ili --------------------------------------------------------------------
-	if (str_is(cmd, PSTR("ili"))) {
-		char *sval = get_arg(arg);
-		if (str_is(arg, PSTR("disp"))) {
-			if (str_is(sval,pstr_on)) {
-				ili9225_set_disp(&ili, ILI9225_DISP_ON);
-				return 0;
-			}
-			if (str_is(sval, pstr_off)) {
-				ili9225_set_disp(&ili, ILI9225_DISP_OFF);
-				return 0;
-			}
-			if (str_is(sval, PSTR("standby"))) {
-				ili9225_set_disp(&ili, ILI9225_DISP_STANDBY);
-				return 0;
-			}
-			return CLI_EARG;
-		}
-		if (str_is(arg, PSTR("led"))) {
-			if (str_is(sval,pstr_on)) {
-				ili9225_set_backlight(&ili, ILI9225_BKL_ON);
-				return 0;
-			}
-			if (str_is(sval, pstr_off)) {
-				ili9225_set_backlight(&ili, ILI9225_BKL_OFF);
+static int8_t dan_set_valid(char *arg, void *ptr UNUSED)
+{
+	char *str = get_arg(arg);
+	int8_t nid = strtonid(arg);
+	if (nid < 0)
+		return CLI_EARG;
+	int8_t on = get_on_off(str);
+	if (on == 1)
+		dans[nid].flags |= DANF_VALID;
+	else if (on == 0)
+		dans[nid].flags &= ~DANF_VALID;
+	else
+		return CLI_EARG;
+	cfg.dvalid[nid] = dans[nid].flags & DANF_VALID;
+	cfg_save();
+	return 0;
+}
+
+static int8_t dan_set_log(char *arg, void *ptr UNUSED)
+{
+	char *str = get_arg(arg);
+	int8_t nid = strtonid(arg);
+	if (nid < 0)
+		return CLI_EARG;
+	int8_t on = get_on_off(str);
+	if (on == 1) {
+		if (dans[nid].flags & DANF_LOG)
+			return 0;
+		for(uint8_t i = 0; i < MAX_DNODE_LOGS; i++) {
+			if (cfg.dlog[i] == 0) {
+				cfg.dlog[i] = nid + 1;
+				dans[nid].flags |= DANF_LOG;
+				dans[nid].log = i;
+				cfg_save();
+				log_erase(i);
 				return 0;
 			}
-			uint8_t duty = atoi(sval);
-			ili9225_set_backlight(&ili, duty);
-			return CLI_EOK;
-		}
-		if (str_is(arg, PSTR("dir"))) {
-			uint8_t dir = atoi(sval);
-			ili9225_set_dir(&ili, dir);
-			return 0;
 		}
 		return CLI_EARG;
 	}
-
-	// dan --------------------------------------------------------------------
-	if (str_is(cmd, PSTR("dan"))) {
-		char *sprop = get_arg(arg);
-		char *snode = get_arg(sprop);
-		char *str = get_arg(snode);
-
-		if (str_is(arg, PSTR("show"))) {
-			int8_t nid = strtonid(snode);
-			if (nid < 0)
-				return CLI_EARG;
-			if (str_is(sprop, pstr_status)) {
-				print_node(nid);
-				return 0;
-			}
-			if (str_is(sprop, pstr_log)) {
-				if (!(dans[nid].flags & DANF_LOG))
-					return CLI_EARG;
-
-				uint8_t ts[3];
-				pcf2127_get_time((pcf_td_t *)ts, 0);
-				uint16_t ridx = ts[0]*60 + ts[1];
-
-				dnode_log_t rec;
-				for(uint16_t i = 0; i < 24*60; i++) {
-					ridx = log_next_rec_index(ridx);
-					log_read_rec(dans[nid].log, ridx, &rec);
-					uint8_t hour = ridx / 60;
-					uint8_t min = ridx % 60;
-					printf("%02u:%02u ", hour, min);
-					if (rec.ssi & 0x80) {
-						int8_t val = rec.data.val;
-						if (val & 0x80)
-							val = -(val & 0x7F);
-						printf("ARSSI %3u%% T %+3d.%02u", rec.ssi & 0x7F, val, rec.data.dec);
-					}
-					else
-						uart_puts(" --- - --.--");
-					uart_puts("\n");
-				}
-				return 0;
-			}
+	if (on == 0) {
+		if (!(dans[nid].flags & DANF_LOG))
+			return 0;
+		dans[nid].flags &= ~DANF_LOG;
+		uint8_t i = dans[nid].log;
+		if (i < MAX_DNODE_LOGS) {
+			cfg.dlog[i] = 0;
+			cfg_save();
+			return 0;
 		}
+	}
+	return CLI_EARG;
+}
 
-		if (str_is(arg, pstr_set)) {
-			if (str_is(sprop, PSTR("name"))) {
-				int8_t nid = strtonid(snode);
-				if (nid < 0)
-					return CLI_EARG;
-				uint8_t *name = dans[nid].name;
-				memset(name, 0, NODE_NAME_LEN);
-				for(uint8_t i = 0; i < (NODE_NAME_LEN - 1); i++) {
-					if (str[i] == 0)
-						break;
-					name[i] = str[i];
-				}
-				eeprom_update_block((const void *)name, (void *)em_dan_name[nid], NODE_NAME_LEN);
-				return 0;
-			}
+#if PROFILER
+// prof -----------------------------------------------------------------------
+static int8_t prof_cmd_start(char *arg UNUSED, void *ptr UNUSED)
+{
+	prof_reset();
+	return prof_start();
+}
 
-			if (str_is(sprop, pstr_valid)) {
-				int8_t nid = strtonid(snode);
-				if (nid < 0)
-					return CLI_EARG;
-				if (str_is(str, pstr_on))
-					dans[nid].flags |= DANF_VALID;
-				else if (str_is(str, pstr_off))
-					dans[nid].flags &= ~DANF_VALID;
-				else
-					return CLI_EARG;
-				eeprom_update_byte(&em_dvalid[nid], dans[nid].flags & DANF_VALID);
-				return 0;
-			}
+static int8_t prof_cmd_stop(char *arg UNUSED, void *ptr UNUSED)
+{
+	prof_stop();
+	return 0;
+}
 
-			if (str_is(sprop, pstr_log)) {
-				int8_t nid = strtonid(snode);
-				if (nid < 0)
-					return CLI_EARG;
-				if (str_is(str, pstr_on)) {
-					if (dans[nid].flags & DANF_LOG)
-						return 0;
-					uint8_t dlog[MAX_DNODE_LOGS];
-					eeprom_read_block((void *)dlog, (const void *)em_dlog, MAX_DNODE_LOGS);
-					for(uint8_t i = 0; i < MAX_DNODE_LOGS; i++) {
-						if (dlog[i] == 0) {
-							dlog[i] = nid + 1;
-							dans[nid].flags |= DANF_LOG;
-							dans[nid].log = i;
-							eeprom_write_byte(&em_dlog[i], dlog[i]);
-							log_erase(i);
-							return 0;
-						}
-					}
-					return CLI_EARG;
-				}
-				if (str_is(str, pstr_off)) {
-					if (!(dans[nid].flags & DANF_LOG))
-						return 0;
-					dans[nid].flags &= ~DANF_LOG;
-					uint8_t i = dans[nid].log;
-					if (i < MAX_DNODE_LOGS) {
-						eeprom_write_byte(&em_dlog[i], 0);
-						return 0;
-					}
-					return CLI_EARG;
-				}
-			}
-		}
-		return CLI_EARG;
+// bucket flash byte address and samples, see tools/profmap.py
+static int8_t prof_cmd_dump(char *arg UNUSED, void *ptr UNUSED)
+{
+	uint8_t scale = prof_scale();
+	printf_P(PSTR("prof %lu samples %lu Hz bucket %u %s\n"), prof_samples(), PROF_HZ,
+		1 << PROF_SHIFT, prof_running() ? "running" : "stopped");
+	for(uint16_t i = 0; i < PROF_BUCKETS; i++) {
+		uint8_t n = prof_count(i);
+		if (n)
+			printf_P(PSTR("%04X %lu\n"), i << PROF_SHIFT, (uint32_t)n << scale);
 	}
+	return 0;
+}
+#endif
+
+// commands table, first word of the string is the command name ---------------
+static const char pstr_help[] PROGMEM = "help";
+static const char pstr_task[] PROGMEM = "task [reset]";
+static const char pstr_perf[] PROGMEM = "perf [reset]";
+static const char pstr_poll[] PROGMEM = "poll";
+static const char pstr_status[] PROGMEM = "status";
+static const char pstr_calibrate[] PROGMEM = "calibrate";
+static const char pstr_time[] PROGMEM = "time";
+static const char pstr_date[] PROGMEM = "date";
+static const char pstr_set[] PROGMEM = "set";
+static const char pstr_set_osccal[] PROGMEM = "osccal X";
+static const char pstr_set_time[] PROGMEM = "time HH:MM:SS";
+static const char pstr_set_date[] PROGMEM = "date YY/MM/DD";
+static const char pstr_echo_cmd[] PROGMEM = "echo rx|dan|rht|log|rds [on|off]";
+static const char pstr_rx[] PROGMEM = "rx";
+static const char pstr_dan[] PROGMEM = "dan";
+static const char pstr_rht[] PROGMEM = "rht";
+static const char pstr_log[] PROGMEM = "log";
+static const char pstr_rds[] PROGMEM = "rds";
+static const char pstr_off[] PROGMEM = "off";
+static const char pstr_ili[] PROGMEM = "ili";
+static const char pstr_ili_dir[] PROGMEM = "dir 0|1";
+static const char pstr_ili_led[] PROGMEM = "led on|off|0-255";
+static const char pstr_ili_disp[] PROGMEM = "disp standby|off|on";
+static const char pstr_show[] PROGMEM = "show";
+static const char pstr_log_nid[] PROGMEM = "log NID";
+static const char pstr_status_nid[] PROGMEM = "status NID";
+static const char pstr_name_nid[] PROGMEM = "name NID str";
+static const char pstr_log_nid_on[] PROGMEM = "log NID on|off";
+static const char pstr_valid_nid_on[] PROGMEM = "valid NID on|off";
+static const char pstr_rtc[] PROGMEM = "rtc";
+static const char pstr_rtc_dump[] PROGMEM = "dump [mem]";
+static const char pstr_rtc_init[] PROGMEM = "init [mem]";
+static const char pstr_rtc_dst[] PROGMEM = "dst on|off";
+static const char pstr_adc[] PROGMEM = "adc chan";
+static const char pstr_get[] PROGMEM = "get pin (d3,b4,c2...)";
+static const char pstr_rdsid[] PROGMEM = "rdsid id";
+static const char pstr_rdstext[] PROGMEM = "rdstext";
+static const char pstr_freq[] PROGMEM = "freq nnnn";
+static const char pstr_txpwr[] PROGMEM = "txpwr 0-3";
+static const char pstr_radio[] PROGMEM = "radio on|off";
+#if PROFILER
+static const char pstr_prof[] PROGMEM = "prof";
+static const char pstr_prof_start[] PROGMEM = "start";
+static const char pstr_prof_stop[] PROGMEM = "stop";
+static const char pstr_prof_dump[] PROGMEM = "dump";
+#endif
+
+static const cli_cmd_t set_cmds[] PROGMEM = {
+	{ pstr_set_osccal, set_osccal, NULL },
+	{ pstr_set_time, set_time, NULL },
+	{ pstr_set_date, set_date, NULL },
+	{ NULL, NULL, NULL }
+};
+
+static const cli_cmd_t echo_cmds[] PROGMEM = {
+	{ pstr_rx, echo_rx, NULL },
+	{ pstr_dan, echo_dan, NULL },
+	{ pstr_rht, echo_rht, NULL },
+	{ pstr_log, echo_log, NULL },
+	{ pstr_rds, echo_rds, NULL },
+	{ pstr_off, echo_off, NULL },
+	{ NULL, NULL, NULL }
+};
+
+static const cli_cmd_t ili_cmds[] PROGMEM = {
+	{ pstr_ili_dir, ili_dir, NULL },
+	{ pstr_ili_led, ili_led, NULL },
+	{ pstr_ili_disp, ili_disp, NULL },
+	{ NULL, NULL, NULL }
+};
+
+static const cli_cmd_t dan_show_cmds[] PROGMEM = {
+	{ pstr_log_nid, dan_show_log, NULL },
+	{ pstr_status_nid, dan_show_status, NULL },
+	{ NULL, NULL, NULL }
+};
+
+static const cli_cmd_t dan_set_cmds[] PROGMEM = {
+	{ pstr_name_nid, dan_set_name, NULL },
+	{ pstr_log_nid_on, dan_set_log, NULL },
+	{ pstr_valid_nid_on, dan_set_valid, NULL },
+	{ NULL, NULL, NULL }
+};
+
+static const cli_cmd_t dan_cmds[] PROGMEM = {
+	{ pstr_show, NULL, dan_show_cmds },
+	{ pstr_set, NULL, dan_set_cmds },
+	{ NULL, NULL, NULL }
+};
+
+static const cli_cmd_t rtc_cmds[] PROGMEM = {
+	{ pstr_rtc_dump, rtc_dump, NULL },
+	{ pstr_rtc_init, rtc_init, NULL },
+	{ pstr_rtc_dst, rtc_dst, NULL },
+	{ NULL, NULL, NULL }
+};
+
+#if PROFILER
+static const cli_cmd_t prof_cmds[] PROGMEM = {
+	{ pstr_prof_start, prof_cmd_start, NULL },
+	{ pstr_prof_stop, prof_cmd_stop, NULL },
+	{ pstr_prof_dump, prof_cmd_dump, NULL },
+	{ NULL, NULL, NULL }
+};
+#endif
 
-	return CLI_ENOTSUP;
+// list of supported commands 
+const cli_cmd_t base_cmds[] PROGMEM = {
+	{ pstr_help, cmd_help, NULL },
+	{ pstr_mem, cmd_mem, NULL },
+	{ pstr_task, cmd_task, NULL },
+	{ pstr_perf, cmd_perf, NULL },
+	{ pstr_poll, cmd_poll, NULL },
+	{ pstr_reset, cmd_reset, NULL },
+	{ pstr_status, cmd_status, NULL },
+	{ pstr_calibrate, cli_calibrate, NULL },
+	{ pstr_time, cmd_time, NULL },
+	{ pstr_date, cmd_date, NULL },
+	{ pstr_set, NULL, set_cmds },
+	{ pstr_echo_cmd, cmd_echo, echo_cmds },
+	{ pstr_ili, NULL, ili_cmds },
+	{ pstr_dan, NULL, dan_cmds },
+	{ pstr_rtc, NULL, rtc_cmds },
+	{ pstr_adc, cmd_adc, NULL },
+	{ pstr_get, cli_get_pin, NULL },
+	{ pstr_rdsid, cmd_rdsid, NULL },
+	{ pstr_rdstext, cmd_rdstext, NULL },
+	{ pstr_freq, cmd_freq, NULL },
+	{ pstr_txpwr, cmd_txpwr, NULL },
+	{ pstr_radio, cmd_radio, NULL },
+#if PROFILER
+	{ pstr_prof, NULL, prof_cmds },
+#endif
+	{ NULL, NULL, NULL }
+};
+
+int8_t cli_base(char *buf, void *rht)
+{
+	return cli_dispatch(base_cmds, buf, rht);
 }
@@ -31,9 +31,12 @@
 #include "dnode.h"
 #include "mmrio.h"
 #include "ns741.h"
+#include "task.h"
+#include "stack.h"
 #include "timer.h"
 #include "bmp180.h"
 #include "bmfont.h"
+#include "fmtnum.h"
 #include "serial.h"
 #include "i2cmem.h"
 #include "ili9225.h"
@@ -47,7 +50,8 @@
 #error F_CPU must be defined in Makefile, use -DF_CPU=xxxUL
 #endif
 
-// some default variables we want to store in EEPROM
+// configuration layout 0: separate variables, replaced by base_cfg_t
+// records in base_cfg.c and kept at the same addresses for migration
 uint8_t  EEMEM em_rds_name[8] = "BASE 01 "; // Base station name
 uint16_t EEMEM em_radio_freq  = 9700; // 97.00 MHz
 
@@ -78,6 +82,8 @@ uint8_t  rt_flags;
 
 uint32_t uptime;
 uint32_t sw_clock;
+static uint16_t nbeacon;      // time sync beacons sent
+static uint16_t nbeacon_late; // and skipped
 
 rht_t rht;
 bmp180_t press;
@@ -112,9 +118,9 @@ uint8_t EEMEM  em_dvalid[MAX_DNODE_NUM]; // valid nodes in the network
 uint8_t EEMEM  em_dan_name[MAX_DNODE_NUM][NODE_NAME_LEN]; // Nodes' names
 // track number of resets
 uint16_t nreset;
-uint16_t EEMEM em_nreset = 0;
+uint16_t EEMEM em_nreset = 0; // layout 0
 
-static uint16_t last_ts[MAX_DNODE_LOGS];
+uint16_t last_ts[MAX_DNODE_LOGS]; // log cursors
 
 // adc channel ARSSI connected to (> 0)
 #define ARSSI_ADC 5
@@ -129,9 +135,23 @@ static const char *s_pwr[4] = {
 // avr-gcc does not do string pooling for PROGMEM
 const char pstr_tformat[] PROGMEM = "%02d:%02d:%02d";
 
-void update_screen(void);
+static uint8_t poll_clock;
+static uint8_t rds_clock;
+
+perf_t perf_loop;
+perf_t perf_rf;
+
+void update_screen(uint8_t idx);
 void update_line(uint8_t line, uint8_t idx);
 
+static void tsync_beacon(void);
+static uint8_t rf_task(void *data);
+static uint8_t rds_task(void *data);
+static uint8_t cli_task(void *data);
+static uint8_t disp_task(void *data);
+static uint8_t sens_task(void *data);
+static uint8_t rht_task(void *data);
+
 void update_radio_status(void)
 {
 	sprintf_P(status, PSTR("TxPwr %smW %s"), s_pwr[ns_pwr_flags & NS741_TXPWR],
@@ -161,6 +181,20 @@ static void bsort(uint8_t *data, int8_t len)
 	}
 }
 
+// every task step is a job for both histograms
+static void perf_task(uint8_t cls, uint32_t usec)
+{
+	perf_job(&perf_loop, cls, usec);
+	perf_job(&perf_rf, cls, usec);
+}
+
+void perf_start(void)
+{
+	perf_reset(&perf_loop);
+	perf_reset(&perf_rf);
+	task_set_hook(perf_task);
+}
+
 static volatile uint8_t aidx;
 static uint8_t  areads[8];
 
@@ -172,24 +206,25 @@ ISR(ADC_vect)
 
 int main(void)
 {
-	uint8_t poll_clock = 3;
-	nreset = eeprom_read_word(&em_nreset);
-	nreset += 1;
-	eeprom_write_word(&em_nreset, nreset);
+	stack_init();
+	poll_clock = 3;
+	int8_t migrated = cfg_load();
+	nreset = ++cfg.nreset;
+	cfg_save();
 
 	mmr_led_on(); // turn on LED while booting
 	memset(dans, 0, sizeof(dans));
 
 	for(uint8_t i = 0; i < MAX_DNODE_NUM; i++) {
-		eeprom_read_block((void *)dans[i].name, (const void *)em_dan_name[i], NODE_NAME_LEN);
+		memcpy(dans[i].name, cfg.dan_name[i], NODE_NAME_LEN);
 		if (dans[i].name[0] == '\0')
 			sprintf((char *)dans[i].name, "DAN%02u", i+1);
 		dans[i].name[NODE_NAME_LEN - 1] = '\0';
-		dans[i].flags = eeprom_read_byte(&em_dvalid[i]);
+		dans[i].flags = cfg.dvalid[i];
 	}
 
 	for(uint8_t i = 0; i < MAX_DNODE_LOGS; i++) {
-		uint8_t nid = eeprom_read_byte(&em_dlog[i]);
+		uint8_t nid = cfg.dlog[i];
 		if (nid && nid <= MAX_DNODE_NUM) {
 			dans[nid-1].log = i;
 			dans[nid-1].flags |= DANF_LOG;
@@ -212,25 +247,31 @@ int main(void)
 
 	// initialise all components
 	// read settings from EEPROM
-	ns_rt_flags = eeprom_read_byte(&em_ns_rt_flags);
-	ns_pwr_flags = eeprom_read_byte(&em_ns_pwr_flags);
-	rt_flags = eeprom_read_byte(&em_rt_flags);
+	ns_rt_flags = cfg.ns_rt_flags;
+	ns_pwr_flags = cfg.ns_pwr_flags;
+	rt_flags = cfg.rt_flags;
 
 	sei();
 	serial_init(UART_BAUD_RATE);
 	if (rt_flags & RT_LOAD_OSCCAL) {
-		uint8_t new_osccal = eeprom_read_byte(&em_osccal);
-		serial_set_osccal(new_osccal);
+		serial_set_osccal(cfg.osccal);
+	}
+	if (migrated)
+		uart_puts_p(PSTR("config migrated\n"));
+	{
+		const stack_rec_t *last = stack_last();
+		if (last && (last->flags & STACK_OVERFLOW))
+			printf_P(PSTR("stack overflow, sp %04X\n"), last->sp);
 	}
 
 	i2c_init(); // needed for ns741*, bmp180* and pcf2127*
-	// accessing i2c memory can be quite slow, so register our
-	// io handler for any pending I/O requests
-	i2cmem_set_idle_callback(io_handler);
+	// accessing i2c memory can be quite slow, so let
+	// higher priority tasks run while waiting for it
+	i2cmem_set_idle_callback(task_yield);
 
 	analogReference(VREF_AVCC); // enable ADC with Vcc reference
 	analogRead(ARSSI_ADC); // dummy read to start ADC
-	uint8_t sync = eeprom_read_byte(&em_rfm_sync);
+	uint8_t sync = cfg.rfm_sync;
 
 	spi_init(SPI_CLOCK_DIV4); // RFM12 supports only < 2.5MHz
 
@@ -246,7 +287,7 @@ int main(void)
 	ili9225_set_backlight(&ili, 127);
 
 	// initialize NS741 chip	
-	eeprom_read_block((void *)rds_name, (const void *)em_rds_name, 8);
+	memcpy(rds_name, cfg.rds_name, 8);
 	ns741_rds_set_progname(rds_name);
 	// initialize ns741 with default parameters
 	ns741_init();
@@ -263,7 +304,7 @@ int main(void)
 	ns741_gain(NS741_GAIN);
 	ns_pwr_flags |= NS741_GAIN;
 	// read radio frequency from EEPROM
-	radio_freq = eeprom_read_word(&em_radio_freq);
+	radio_freq = cfg.radio_freq;
 	if (radio_freq < NS741_MIN_FREQ) radio_freq = NS741_MIN_FREQ;
 	if (radio_freq > NS741_MAX_FREQ) radio_freq = NS741_MAX_FREQ;
 	get_fm_freq(fm_freq);
@@ -283,6 +324,7 @@ int main(void)
 
 	// turn on RDS
 	ns741_rds(1);
+	ns741_rds_irq(1);
 	ns_rt_flags |= NS741_RDS;
 
 	// reset our soft clock
@@ -324,15 +366,28 @@ int main(void)
 			if (sec != rd_ts[2])
 				break;
 		}
+		// RTC CLKOUT (open drain) ticks time cache
+		pinMode(PNB2, INPUT_UP);
+		pcf2127_clk_irq(1);
+
+		// warm restart after watchdog reset
+		if (ckpt_restore() == 0)
+			uart_puts_p(PSTR("state restored\n"));
 	}
 
+	task_init(TASK_RF, rf_task, NULL, TASK_POLL);
+	task_init(TASK_RDS, rds_task, NULL, TASK_POLL);
+	task_init(TASK_CLI, cli_task, &rht, TASK_POLL);
+	task_init(TASK_DISP, disp_task, NULL, 0);
+	task_init(TASK_SENS, sens_task, NULL, 0);
+	task_init(TASK_RHT, rht_task, NULL, TASK_POLL);
+	perf_start();
+
 	// main loop
 	for(;;) {
-		if (io_handler())    // keep local sensors read shifted 500 msec
-			tenth_clock = 5; // to avoid collisions with the radio
-
-		// process serial port commands
-		cli_interact(cli_base, &rht);
+		perf_mark(&perf_loop);
+		task_run();
+		pcf2127_clk_poll();
 
 		// once-a-second checks
 		if (tenth_clock >= 10) {
@@ -340,43 +395,117 @@ int main(void)
 			uptime++;
 			sw_clock++; 
 			poll_clock ++;
+			rds_clock = 1;
+			stack_unused(); // update high water mark
+			task_post(TASK_DISP);
+			task_post(TASK_SENS);
+		}
+	}
+}
 
-			update_screen();
+static uint8_t rf_task(void *data __attribute__((unused)))
+{
+	if (io_handler())    // keep local sensors read shifted 500 msec
+		tenth_clock = 5; // to avoid collisions with the radio
+	tsync_beacon();
+	return TASK_DONE;
+}
 
-			uint8_t ts[3];
-			if (pcf2127_get_time((pcf_td_t *)ts, 0) == 0) {
-				sprintf_P(fm_freq, pstr_tformat, ts[0], ts[1], ts[2]);
-				putlx(0, ILI9225_LCD_WIDTH-8*8-4, fm_freq, 0);
-			}
+static uint8_t rds_task(void *data __attribute__((unused)))
+{
+	// RDS blocks are sent from INT0, only debug output and recovery here
+	ns741_rds_poll();
+	if (rds_clock) {
+		rds_clock = 0;
+		rds_schedule();
+	}
+	return TASK_DONE;
+}
+
+static uint8_t cli_task(void *data)
+{
+	// finish pending long output before accepting new commands
+	if (cli_base_step() == TASK_MORE)
+		return TASK_MORE;
+	// process serial port commands
+	cli_interact(cli_base, data);
+	return TASK_DONE;
+}
+
+// redraw one node line per step, then time and status lines
+static uint8_t disp_task(void *data __attribute__((unused)))
+{
+	static uint8_t idx;
+
+	if (idx < MAX_DNODE_NUM) {
+		update_screen(idx++);
+		return TASK_MORE;
+	}
+	idx = 0;
+
+	uint8_t ts[3];
+	if (pcf2127_get_time((pcf_td_t *)ts, 0) == 0) {
+		fmt_hms(fm_freq, ts[0], ts[1], ts[2]);
+		putlx(0, ILI9225_LCD_WIDTH-8*8-4, fm_freq, 0);
+	}
+	uint8_t font = bmfont_select(BMFONT_6x8);
+	char *str = fmt_str_P(status, PSTR("RST "), 0);
+	str = fmt_u16(str, nreset - 1, 0, 0);
+	str = fmt_str_P(str, PSTR(" SES "), 0);
+	str = fmt_u32(str, rfm868.nses);
+	str = fmt_str_P(str, PSTR(" TOUT "), 0);
+	fmt_u16(str, rfm868.nto, 0, 0);
+	putlx(25, TEXT_CENTRE, status, 0);
+	bmfont_select(font);
+	return TASK_DONE;
+}
+
+// pressure every second, RHT every 5 seconds
+static uint8_t sens_task(void *data __attribute__((unused)))
+{
+	static uint8_t step;
+
+	if (step == 0) {
+		ckpt_flush();
+		if ((bmp180_poll(&press, 0) == 0) && (press.valid & BMP180_P_VALID)) {
 			uint8_t font = bmfont_select(BMFONT_6x8);
-			sprintf(status, "RST %u SES %lu TOUT %u", nreset - 1, rfm868.nses, rfm868.nto);
-			putlx(25, TEXT_CENTRE, status, 0);
-			if ((bmp180_poll(&press, 0) == 0) && (press.valid & BMP180_P_VALID)) {
-				sprintf_P(hpa, PSTR("P %u.%02u hPa"), press.p, press.pdec);
-				putlx(4, TEXT_CENTRE, hpa, 0);
-			}
+			char *str = fmt_str_P(hpa, PSTR("P "), 0);
+			str = fmt_u16(str, press.p, 0, 0);
+			*str++ = '.';
+			str = fmt_02u(str, press.pdec);
+			fmt_str_P(str, PSTR(" hPa"), 0);
+			putlx(4, TEXT_CENTRE, hpa, 0);
 			bmfont_select(font);
 		}
+		if (poll_clock < 5)
+			return TASK_DONE;
+		step = 1;
+		return TASK_MORE;
+	}
 
-		// poll RHT every 5 seconds
-		if (poll_clock >= 5) {
-			poll_clock = 0;
-			putlx(2, 0, "*", 0);
-			rht_read(&rht, rt_flags & RT_ECHO_RHT, rds_data);
-			ns741_rds_set_radiotext(rds_data);
-			putlx(2, TEXT_CENTRE, rds_data, TEXT_OVERLINE | TEXT_UNDERLINE);
-			if (rt_flags & RT_ECHO_LOG) {
-				uint8_t ts[3];
-				pcf2127_get_time((pcf_td_t *)ts, sw_clock);
-				printf_P(pstr_tformat, ts[0], ts[1], ts[2]);
-				int8_t val = get_u8val(rht.temperature.val);
-				printf_P(PSTR(" %d.%02d %d.%02d %d.%02d\n"),
-					val, rht.temperature.dec,
-					rht.humidity.val, rht.humidity.dec,
-					press.p, press.pdec);
-			}
-		}
-    }
+	step = 0;
+	poll_clock = 0;
+	putlx(2, 0, "*", 0);
+	rht_read(&rht, rt_flags & RT_ECHO_RHT, rds_data);
+	putlx(2, TEXT_CENTRE, rds_data, TEXT_OVERLINE | TEXT_UNDERLINE);
+	if (rt_flags & RT_ECHO_LOG) {
+		uint8_t ts[3];
+		pcf2127_get_time((pcf_td_t *)ts, sw_clock);
+		printf_P(pstr_tformat, ts[0], ts[1], ts[2]);
+		int8_t val = get_u8val(rht.temperature.val);
+		printf_P(PSTR(" %d.%02d %d.%02d %d.%02d\n"),
+			val, rht.temperature.dec,
+			rht.humidity.val, rht.humidity.dec,
+			press.p, press.pdec);
+	}
+	return TASK_DONE;
+}
+
+// measurement started by rht_read() is clocked out in short steps
+static uint8_t rht_task(void *data __attribute__((unused)))
+{
+	rht_step();
+	return TASK_DONE;
 }
 
 void print_rd(void)
@@ -384,25 +513,57 @@ void print_rd(void)
 	if (rd.nid == 0)
 		return;
 
-	printf_P(pstr_tformat, rd_ts[0], rd_ts[1], rd_ts[2]);
-	uart_puts_p(PSTR(" | "));
+	char buf[24];
+	char *str = fmt_hms(buf, rd_ts[0], rd_ts[1], rd_ts[2]);
+	str = fmt_str_P(str, PSTR(" | "), 0);
 	for(uint8_t i = 0; i < 4; i++) {
 		uint8_t *pu8 = (uint8_t *)&rd;
-		printf_P(PSTR("%02X "), pu8[i]);
+		str = fmt_hex8(str, pu8[i]);
+		*str++ = ' ';
 	}
-	printf_P(PSTR("| NID %u SID %u "), rd.nid & NID_MASK, (rd.nid & SENS_MASK) >> 4);
+	*str = '\0';
+	uart_puts(buf);
+	str = fmt_str_P(buf, PSTR("| NID "), 0);
+	str = fmt_u16(str, rd.nid & NID_MASK, 0, 0);
+	str = fmt_str_P(str, PSTR(" SID "), 0);
+	str = fmt_u16(str, (rd.nid & SENS_MASK) >> 4, 0, 0);
+	fmt_str(str, " ", 0);
+	uart_puts(buf);
 
 	if ((rd.nid & SENS_MASK) == SENS_LIST) {
-		for(uint8_t i = 1; i <= MAX_SENSORS; i++)
-			printf_P(PSTR("%02u "), get_sens_type(&rd, i));
+		for(uint8_t i = 1; i <= MAX_SENSORS; i++) {
+			str = fmt_02u(buf, get_sens_type(&rd, i));
+			fmt_str(str, " ", 0);
+			uart_puts(buf);
+		}
 	}
 	else {
-		int8_t val = get_dval(rd.data.val);
-		printf_P(PSTR("S%u L%u A%u E%u V %u T%+3d.%02d ARSSI %u %3d%%"),
-			!!(rd.stat & STAT_SLEEP), !!(rd.stat & STAT_LED),
-			!!(rd.stat & STAT_ACK), !!(rd.stat & STAT_EOS),
-			rd_bv, val, rd.data.dec,
-			rd_arssi, rd_signal);
+		static const uint8_t stat[4] PROGMEM = { STAT_SLEEP, STAT_LED, STAT_ACK, STAT_EOS };
+		static const char sflag[4] PROGMEM = { 'S', 'L', 'A', 'E' };
+		str = buf;
+		for(uint8_t i = 0; i < 4; i++) {
+			*str++ = pgm_read_byte(&sflag[i]);
+			*str++ = (rd.stat & pgm_read_byte(&stat[i])) ? '1' : '0';
+			*str++ = ' ';
+		}
+		str = fmt_str_P(str, PSTR("V "), 0);
+		fmt_u16(str, rd_bv, 0, 0);
+		uart_puts(buf);
+		// only SID 1 is known to be temperature
+		if (GET_SENS(rd.nid) == 1) {
+			str = fmt_str_P(buf, PSTR(" T"), 0);
+			fmt_fixed(str, rd.data.val, rd.data.dec, 3, FMT_PLUS);
+		}
+		else {
+			str = fmt_str_P(buf, PSTR(" D "), 0);
+			fmt_u16(str, rd.data.v16, 0, 0);
+		}
+		uart_puts(buf);
+		str = fmt_str_P(buf, PSTR(" ARSSI "), 0);
+		str = fmt_u16(str, rd_arssi, 0, 0);
+		*str++ = ' ';
+		fmt_pct(str, rd_signal, 3);
+		uart_puts(buf);
 	}
 	uart_puts("\n");
 }
@@ -456,8 +617,8 @@ void print_status(uint8_t verbose)
 		uart_puts_p(PSTR("RTC time: "));
 		print_rtc_time();
 		if (uptime) {
-			printf_P(PSTR("Resets %u, Timeouts %u, Sessions %lu, Uptime %lu sec or "),
-				nreset - 1, rfm868.nto, rfm868.nses, uptime);
+			printf_P(PSTR("Resets %u, Timeouts %u, Sessions %lu, Beacons %u/%u late, Uptime %lu sec or "),
+				nreset - 1, rfm868.nto, rfm868.nses, nbeacon, nbeacon_late, uptime);
 			if (uptime > 86400)
 				printf_P(PSTR("%lu days "), uptime / 86400l);
 			uint32_t utime = uptime % 86400l;
@@ -517,15 +678,63 @@ void putlx(uint8_t line, uint8_t x, const char *str, uint8_t atr)
 //	spi_set_clock(SPI_CLOCK_DIV4);
 }
 
+// time sync reply, RTC phase is added if CLKOUT ticks are available
+static void tsync_send(uint8_t dest)
+{
+	dnode_t tsync;
+	uint8_t ts[3];
+	int16_t phase = pcf2127_get_phase((pcf_td_t *)ts);
+	if (phase < 0) {
+		ts[0] = rd_ts[0];
+		ts[1] = rd_ts[1];
+		ts[2] = rd_ts[2];
+	}
+	tsync.raw[0] = ts[0];
+	tsync.raw[1] = ts[1];
+	tsync.raw[2] = ts[2];
+	tsync.nid = NODE_TSYNC;
+	ts_pack(&tsync, dest);
+	if (phase >= 0)
+		tsync.raw[0] |= ts_phase_pack(phase);
+	rfm12_send(&rfm868, &tsync, sizeof(tsync));
+}
+
+// time sync beacon, needs CLKOUT ticks to be sent at known phase
+static void tsync_beacon(void)
+{
+	static uint8_t sent;
+	uint8_t ts[3];
+
+	int16_t phase = pcf2127_get_phase((pcf_td_t *)ts);
+	if (phase < 0 || !IS_BEACON(ts[1], ts[2])) {
+		sent = 0;
+		return;
+	}
+	if (sent || phase < BEACON_DELAY)
+		return;
+	sent = 1;
+	// nodes would set wrong RTC phase
+	if (phase > (BEACON_DELAY + BEACON_LATE)) {
+		nbeacon_late++;
+		return;
+	}
+
+	tsync_send(0);
+	rfm12_set_mode(&rfm868, RFM_MODE_RX);
+	nbeacon++;
+	if (rt_flags & RT_ECHO_DAN) {
+		printf_P(pstr_tformat, ts[0], ts[1], ts[2]);
+		printf_P(PSTR(" beacon %d\n"), phase);
+	}
+}
+
 uint8_t io_handler(void)
 {
 	uint8_t ret;
+	perf_mark(&perf_rf);
 	// set watchdog timer to 20 sec just in case if radio fails
 	rtc_set_wdt(20);
-	// RDSPIN is low when NS741 is ready to transmit next RDS frame
-	if (mmr_rdsint_get() == LOW)
-		ns741_rds_isr();
-	
+
 	// RFM sessions processing
 	// Enable ARSSI signal reading
 	uint8_t rx_flags = ARSSI_ADC;
@@ -550,21 +759,16 @@ uint8_t io_handler(void)
 			dans[dan].ts[1] = rd_ts[1];
 			dans[dan].ts[2] = rd_ts[2];
 			dans[dan].tout = 5; // reset timeout to 5 minutes
+			ckpt_node(dan);
 
 			if (!(dans[dan].flags & DANF_VALID))
 				goto restart_rx;
 		}
 
 		if (rd.nid & NODE_TSYNC) { // remote node requests time sync
-			dnode_t tsync;
-			tsync.raw[0] = rd_ts[0];
-			tsync.raw[1] = rd_ts[1];
-			tsync.raw[2] = rd_ts[2];
-			tsync.nid = NODE_TSYNC;
-			ts_pack(&tsync, dan);
 			if (dan != NODE_LBS)
 				dans[dan].flags |= DANF_TSYNC;
-			rfm12_send(&rfm868, &tsync, sizeof(tsync));
+			tsync_send(dan);
 			if (rt_flags & RT_ECHO_DAN) {
 				printf_P(pstr_tformat, rd_ts[0], rd_ts[1], rd_ts[2]);
 				printf_P(PSTR(" sync %02X\n"), GET_NID(rd.nid));
@@ -603,18 +807,23 @@ uint8_t io_handler(void)
 
 		dans[dan].ssi = rd_signal;
 
+		uint8_t sid = GET_SENS(rd.nid);
 		if ((rd.nid & SENS_MASK) == SENS_LIST) {
 			dans[dan].flags |= DANF_SLIST;
+			for(uint8_t i = 0; i < MAX_SENSORS; i++)
+				dans[dan].stype[i] = get_sens_type(&rd, i + 1);
 		}
 		else {
-			dans[dan].sdata[0].v16 = rd.data.v16;
+			// only SID 1 temperature is displayed and logged
+			if (sid && sid <= MAX_SENSORS)
+				dans[dan].sdata[sid - 1].v16 = rd.data.v16;
 
 			rd_bv = (rd.stat & STAT_VBAT) * 10;
 			dans[dan].flags |= rd.stat & ~DANF_MASK;
 			dans[dan].vbat = rd_bv;
 			rd_bv += 230;
 
-			if (dans[dan].flags & DANF_LOG) {
+			if ((dans[dan].flags & DANF_LOG) && sid == 1) {
 				uint16_t ridx = rd_ts[0]*60 + rd_ts[1];
 				uint16_t i = ridx;
 
@@ -654,8 +863,10 @@ void update_line(uint8_t line, uint8_t idx)
 			ili9225_set_bk_color(&ili, RGB16_YELLOW);
 		}
 	}
-	int8_t val = get_dval(dan->sdata[0].val);
-	sprintf_P(fm_freq, PSTR("%-5s T% 3d.%02d "), dan->name, val, dan->sdata[0].dec);
+	char *str = fmt_str(fm_freq, (const char *)dan->name, 5);
+	str = fmt_str_P(str, PSTR(" T"), 0);
+	str = fmt_fixed(str, dan->sdata[0].val, dan->sdata[0].dec, 3, FMT_SPACE);
+	fmt_str(str, " ", 0);
 	putlx(line, 4, fm_freq, 0);
 	ili9225_set_fg_color(&ili, RGB16_WHITE);
 	ili9225_set_bk_color(&ili, RGB16_BLACK);
@@ -671,7 +882,7 @@ void update_line(uint8_t line, uint8_t idx)
 		}
 	}
 
-	sprintf_P(status, PSTR("V %d.%02d"), vbat / 100, vbat % 100);
+	fmt_cent(fmt_str_P(status, PSTR("V "), 0), vbat);
 	putlx(line, ILI9225_LCD_WIDTH - 6 * 6 - 4, status, 0);
 	ili9225_set_fg_color(&ili, RGB16_WHITE);
 	ili9225_set_bk_color(&ili, RGB16_BLACK);
@@ -686,7 +897,8 @@ void update_line(uint8_t line, uint8_t idx)
 		}
 	}
 
-	sprintf_P(status, PSTR("S %2d%% "), rssi);
+	str = fmt_pct(fmt_str_P(status, PSTR("S "), 0), rssi, 2);
+	fmt_str(str, " ", 0);
 	putlx(line + 1, ILI9225_LCD_WIDTH - 6 * 6 - 4, status, 0);
 	ili9225_set_fg_color(&ili, RGB16_WHITE);
 	ili9225_set_bk_color(&ili, RGB16_BLACK);
@@ -708,25 +920,28 @@ static int8_t get_node_line(uint8_t nid)
 	return -1;
 }
 
-void update_screen(void)
+void update_screen(uint8_t idx)
 {
 	static uint8_t minute = 60;
 
-	minute -= 1;
-	for (uint8_t i = 0; i < MAX_DNODE_NUM; i++) {
-		if (!minute) {
+	// node timeouts are counted in minutes
+	if (idx == 0 && --minute == 0) {
+		minute = 60;
+		for (uint8_t i = 0; i < MAX_DNODE_NUM; i++) {
 			if (dans[i].tout) {
-				dans[i].tout -= 1;
+				// timed out node is checkpointed, so its
+				// session time stamp is not used on restore
+				if (--dans[i].tout == 0)
+					ckpt_node(i);
 				dans[i].flags |= DANF_ACTIVE;
 			}
 		}
-		if ((dans[i].flags & (DANF_VALID | DANF_ACTIVE)) == (DANF_VALID | DANF_ACTIVE)) {
-			dans[i].flags &= ~DANF_ACTIVE;
-			int8_t line = get_node_line(i);
-			if (line >= 0)
-				update_line(line + 5, i);
-		}
 	}
-	if (!minute)
-		minute = 60;
-}
\ No newline at end of file
+
+	if ((dans[idx].flags & (DANF_VALID | DANF_ACTIVE)) == (DANF_VALID | DANF_ACTIVE)) {
+		dans[idx].flags &= ~DANF_ACTIVE;
+		int8_t line = get_node_line(idx);
+		if (line >= 0)
+			update_line(line + 5, idx);
+	}
+}
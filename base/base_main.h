@@ -21,6 +21,9 @@
 #include <stdint.h>
 #include <avr/eeprom.h>
 
+#include "dnode.h"
+#include "perf.h"
+
 #ifdef __cplusplus
 extern "C" {
 #if 0 // to trick VisualAssist
@@ -56,13 +59,25 @@ extern char status[33];   // TxPwr status
 #define RT_ECHO_LOG  0x40
 #define RT_ECHO_RX   0x80
 
-extern uint8_t  EEMEM em_rds_name[8];
-extern uint16_t EEMEM em_radio_freq;
-extern uint8_t  EEMEM em_ns_rt_flags;
-extern uint8_t  EEMEM em_ns_pwr_flags;
-extern uint8_t  EEMEM em_rt_flags;
-extern uint8_t  EEMEM em_osccal;
-extern uint16_t EEMEM em_nreset;
+// persistent configuration, see base_cfg.c
+typedef struct base_cfg_s {
+	uint16_t nreset; // number of resets
+	uint16_t radio_freq;
+	uint8_t  osccal;
+	uint8_t  rt_flags; // RT_LOAD_OSCCAL | RT_ECHO_RX
+	uint8_t  ns_rt_flags;
+	uint8_t  ns_pwr_flags;
+	uint8_t  rfm_sync;
+	char     rds_name[8];
+	uint8_t  dlog[MAX_DNODE_LOGS]; // nodes for data logging
+	uint8_t  dvalid[MAX_DNODE_NUM]; // valid nodes in the network
+	uint8_t  dan_name[MAX_DNODE_NUM][NODE_NAME_LEN]; // nodes' names
+} base_cfg_t;
+
+extern base_cfg_t cfg;
+
+int8_t cfg_load(void); // 0 - loaded, 1 - migrated from separate variables
+void   cfg_save(void); // write to the next slot
 
 extern uint16_t radio_freq;
 extern uint8_t  ns_rt_flags;
@@ -83,7 +98,26 @@ void   update_radio_status(void);
 
 uint8_t io_handler(void); // check if I/O request is pending
 
-int8_t cli_base(char *buf, void *rht);
+// main loop iterations and io_handler() calls, the latter has to
+// be called at least every 4 msec while RFM12 receives a packet
+#define PERF_RF_LIMIT 4096 // usec, log2 bucket boundary
+extern perf_t perf_loop;
+extern perf_t perf_rf;
+void perf_start(void); // reset histograms and start task run time reports
+
+// RDS content scheduler, rotates local and nodes readings
+#define RDS_TEXT_LEN 64
+void rds_schedule(void); // to be called once a second
+void rds_get_text(char *buf); // Radiotext on air, RDS_TEXT_LEN + 1 buffer
+
+// state checkpoint in RTC RAM for warm restart
+void   ckpt_node(uint8_t nid); // node state and log cursor changed
+void   ckpt_reset(void); // write complete checkpoint
+void   ckpt_flush(void); // to be called once a second
+int8_t ckpt_restore(void);
+
+int8_t  cli_base(char *buf, void *rht);
+uint8_t cli_base_step(void); // continue long command output, TASK_MORE if not done
 
 #define MAX_NODES_PER_SCREEN 8
 
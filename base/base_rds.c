@@ -0,0 +1,114 @@
+/* RDS content scheduler for shDAN base station
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>
+#include <avr/pgmspace.h>
+
+#include "dnode.h"
+#include "ns741.h"
+#include "fmtnum.h"
+#include "pcf2127.h"
+
+#include "base_main.h"
+
+extern dnode_status_t dans[MAX_DNODE_NUM];
+
+// seconds every item stays on air,
+// full Radiotext cycle takes about 1.5 seconds
+#define RDS_ITEM_TIME 8
+#define RDS_ITEM_BASE 0xFF // local sensors
+
+static uint8_t rds_item = RDS_ITEM_BASE; // item on air
+static uint8_t rds_time; // seconds left for the item
+static uint8_t rds_min = 0xFF; // minute of the last CT group
+
+static inline uint8_t rds_node_valid(uint8_t nid)
+{
+	return (dans[nid].flags & DANF_VALID) && dans[nid].tout;
+}
+
+// next valid active node after the item, then local sensors again
+static uint8_t rds_next_item(uint8_t item)
+{
+	uint8_t nid = (item == RDS_ITEM_BASE) ? 0 : item + 1;
+	for(; nid < MAX_DNODE_NUM; nid++) {
+		if (rds_node_valid(nid))
+			return nid;
+	}
+	return RDS_ITEM_BASE;
+}
+
+// builds Radiotext for the item, returns PS name
+static const char *rds_build(char *buf, uint8_t item)
+{
+	if (item == RDS_ITEM_BASE) {
+		// rds_data fits, pressure is added if there is space left
+		char *str = fmt_str(buf, rds_data, 0);
+		if (hpa[0] && ((str - buf) + 1 + strlen(hpa)) < RDS_TEXT_LEN) {
+			*str++ = ' ';
+			fmt_str(str, hpa, 0);
+		}
+		return rds_name;
+	}
+
+	dnode_status_t *dan = &dans[item];
+	char *str = fmt_str(buf, (const char *)dan->name, 0);
+	str = fmt_str_P(str, PSTR(" T "), 0);
+	str = fmt_fixed(str, dan->sdata[0].val, dan->sdata[0].dec, 0, FMT_PLUS);
+	str = fmt_str_P(str, PSTR("C Vbat "), 0);
+	str = fmt_cent(str, dan->vbat + 230);
+	str = fmt_str_P(str, PSTR("V S "), 0);
+	str = fmt_pct(str, dan->ssi, 0);
+	str = fmt_str_P(str, PSTR(" at "), 0);
+	fmt_hms(str, dan->ts[0], dan->ts[1], dan->ts[2]);
+	return (const char *)dan->name;
+}
+
+void rds_get_text(char *buf)
+{
+	rds_build(buf, rds_item);
+}
+
+void rds_schedule(void)
+{
+	char buf[RDS_TEXT_LEN + 1];
+	uint8_t item = rds_item;
+
+	if (!rds_time || ((item != RDS_ITEM_BASE) && !rds_node_valid(item))) {
+		item = rds_next_item(item);
+		rds_time = RDS_ITEM_TIME;
+	}
+	rds_time--;
+
+	// unchanged groups are not resent, so updated
+	// reading of the same item is on air in a few groups
+	const char *name = rds_build(buf, item);
+	ns741_rds_set_radiotext(buf);
+	if (item != rds_item) {
+		rds_item = item;
+		ns741_rds_set_progname(name);
+		// new message, receivers should clear old text
+		ns741_rds_reset_radiotext();
+	}
+
+	// Clock-Time at the start of every minute
+	pcf_td_t td;
+	if ((pcf2127_get_date(&td) == 0) && (td.min != rds_min)) {
+		rds_min = td.min;
+		ns741_rds_set_ct(td.year, td.month, td.day, td.hour, td.min);
+	}
+}
@@ -0,0 +1,58 @@
+/* Cycle-count benchmarks of shDAN firmware hot paths,
+   shared by bench_main.c firmware and simbench.c simavr runner
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SHDAN_BENCH_H
+#define SHDAN_BENCH_H
+
+// Benchmark markers are written to PORTA, not populated on MMR-70:
+// bench id at the start of a measured section and BENCH_STOP at its end.
+// simbench counts CPU cycles between them using simavr cycle counter.
+#define BENCH_PORT PORTA
+#define BENCH_PORT_NAME 'A'
+#define BENCH_STOP 0x00
+
+#define BENCH_RUNS     8  // each section is measured BENCH_RUNS times
+#define BENCH_CRC_LEN  32 // bytes passed to rfm_crc8()
+#define BENCH_RX_LEN   4  // sizeof(dnode_t)
+#define BENCH_RX_BYTES (BENCH_RX_LEN + 3) // len, data, crc and tail from RX FIFO
+#define BENCH_GLYPHS   16 // characters in ili9225_text() string
+#define BENCH_SORT_LEN 8  // ARSSI reads
+
+// id, name, unit, number of units in one measured section
+#define BENCH_LIST(X) \
+	X(BENCH_EMPTY,   "empty",              "call",  1) \
+	X(BENCH_RFM_RX,  "rfm12_receive_data", "byte",  BENCH_RX_BYTES) \
+	X(BENCH_CRC8,    "rfm_crc8",           "byte",  BENCH_CRC_LEN) \
+	X(BENCH_TEXT,    "ili9225_text",       "glyph", BENCH_GLYPHS) \
+	X(BENCH_RDS_ISR, "ns741_rds_isr",      "call",  1) \
+	X(BENCH_BMP_T,   "bmp180_calc_t",      "call",  1) \
+	X(BENCH_BMP_P,   "bmp180_calc_p",      "call",  1) \
+	X(BENCH_TS_PACK, "ts_pack",            "call",  1) \
+	X(BENCH_TS_UNPK, "ts_unpack",          "call",  1) \
+	X(BENCH_LINE,    "update_line",        "call",  1) \
+	X(BENCH_BSORT,   "bsort",              "call",  1)
+
+#define BENCH_ENUM(id, name, unit, n) id,
+enum bench_id_e {
+	BENCH_NONE = BENCH_STOP,
+	BENCH_LIST(BENCH_ENUM)
+	BENCH_NUM
+};
+#undef BENCH_ENUM
+
+#endif
@@ -0,0 +1,222 @@
+/* Cycle-count benchmarks of shDAN firmware hot paths,
+   harness firmware to be run by simbench under simavr
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// base station code is included as is to get access to bsort(),
+// update_line() and base globals, its main() is not used
+#define main base_main
+#include "../base/base_main.c"
+#undef main
+
+#include <avr/sleep.h>
+
+#include "bench.h"
+
+// keeps results of measured code alive
+static volatile uint8_t sink;
+
+static inline void bench_mark(uint8_t id)
+{
+	__asm__ __volatile__("" ::: "memory");
+	BENCH_PORT = id;
+	__asm__ __volatile__("" ::: "memory");
+}
+
+static void bench_empty(void)
+{
+	for(uint8_t run = 0; run < BENCH_RUNS; run++) {
+		bench_mark(BENCH_EMPTY);
+		bench_mark(BENCH_STOP);
+	}
+}
+
+// simbench loads a frame to RFM12 RX FIFO on every RX mode command
+static void bench_rfm_rx(void)
+{
+	dnode_t msg;
+
+	spi_init(SPI_CLOCK_DIV4);
+	rfm868.mode = RFM_SPI_MODE_HW;
+	rfm12_init(&rfm868, 0xD4, RFM12_BAND_868, 868.0, RFM12_BPS_9600);
+
+	for(uint8_t run = 0; run < BENCH_RUNS; run++) {
+		rfm868.ridx = 0;
+		rfm12_set_mode(&rfm868, RFM_MODE_RX);
+		bench_mark(BENCH_RFM_RX);
+		uint8_t ret = rfm12_receive_data(&rfm868, &msg, sizeof(msg), 0);
+		bench_mark(BENCH_STOP);
+		sink = ret;
+	}
+	rfm12_set_mode(&rfm868, RFM_MODE_IDLE);
+}
+
+// rfm_crc8() of rfm12bs.c, exported by RFM12_BENCH build
+static void bench_crc8(void)
+{
+	uint8_t buf[BENCH_CRC_LEN];
+	for(uint8_t i = 0; i < BENCH_CRC_LEN; i++)
+		buf[i] = i * 37;
+
+	for(uint8_t run = 0; run < BENCH_RUNS; run++) {
+		bench_mark(BENCH_CRC8);
+		uint8_t crc = rfm12_crc8(0xD4, buf, BENCH_CRC_LEN);
+		bench_mark(BENCH_STOP);
+		sink = crc;
+	}
+}
+
+static void bench_text(void)
+{
+	ili9225_init(&ili);
+	ili9225_set_dir(&ili, ILI9225_DISP_UPDOWN);
+	bmfont_select(BMFONT_8x16);
+
+	for(uint8_t run = 0; run < BENCH_RUNS; run++) {
+		bench_mark(BENCH_TEXT);
+		ili9225_text(&ili, 0, 0, "shDAN 0123456789", 0);
+		bench_mark(BENCH_STOP);
+	}
+}
+
+// RDSINT is configured as output, INT0 is triggered by PD2 falling edge
+static void bench_rds_isr(void)
+{
+	ns741_rds_set_progname("BENCH 01");
+	ns741_rds_set_radiotext("shDAN cycle count benchmark");
+	mmr_rdsint_mode(OUTPUT_HIGH);
+	ns741_rds_irq(1);
+	sei();
+
+	for(uint8_t run = 0; run < BENCH_RUNS; run++) {
+		bench_mark(BENCH_RDS_ISR);
+		mmr_rdsint_set(LOW);
+		// INT0 flag is set with a cycle of synchronization delay
+		__asm__ __volatile__("nop\n\tnop\n\t" ::: "memory");
+		bench_mark(BENCH_STOP);
+		mmr_rdsint_set(HIGH);
+		// let TWI send RDS block
+		delay(2);
+	}
+
+	ns741_rds_irq(0);
+	cli();
+}
+
+// BMP180 datasheet calculation example
+static void bench_bmp180(void)
+{
+	bmp180_t bmp;
+	bmp.ac1 = 408;
+	bmp.ac2 = -72;
+	bmp.ac3 = -14383;
+	bmp.ac4 = 32741;
+	bmp.ac5 = 32757;
+	bmp.ac6 = 23153;
+	bmp.b1  = 6190;
+	bmp.b2  = 4;
+	bmp.mc  = -8711;
+	bmp.md  = 2868;
+	bmp.rawt = 27898;
+	bmp.rawp = 23843;
+	bmp.valid = 0;
+
+	for(uint8_t run = 0; run < BENCH_RUNS; run++) {
+		bmp.cmd = BMP180_GET_T;
+		bench_mark(BENCH_BMP_T);
+		bmp180_calc(&bmp, BMP180_P_MODE);
+		bench_mark(BENCH_STOP);
+		bench_mark(BENCH_BMP_P);
+		bmp180_calc(&bmp, BMP180_P_MODE);
+		bench_mark(BENCH_STOP);
+	}
+	sink = bmp.pdec;
+}
+
+static void bench_ts(void)
+{
+	dnode_t ts;
+
+	for(uint8_t run = 0; run < BENCH_RUNS; run++) {
+		ts.nid = NODE_TSYNC;
+		ts.raw[0] = 23;
+		ts.raw[1] = 59;
+		ts.raw[2] = run;
+		bench_mark(BENCH_TS_PACK);
+		ts_pack(&ts, 5);
+		bench_mark(BENCH_STOP);
+		bench_mark(BENCH_TS_UNPK);
+		sink = ts_unpack(&ts);
+		bench_mark(BENCH_STOP);
+	}
+}
+
+static void bench_line(void)
+{
+	dnode_status_t *dan = &dans[0];
+	memcpy(dan->name, "DAN01", NODE_NAME_LEN);
+	dan->tout  = 5;
+	dan->vbat  = 100;
+	dan->ssi   = 75;
+	dan->sdata[0].val = 21;
+	dan->sdata[0].dec = 50;
+	bmfont_select(BMFONT_8x16);
+
+	for(uint8_t run = 0; run < BENCH_RUNS; run++) {
+		bench_mark(BENCH_LINE);
+		update_line(5, 0);
+		bench_mark(BENCH_STOP);
+	}
+}
+
+// worst case: ascending ARSSI reads
+static void bench_bsort(void)
+{
+	uint8_t data[BENCH_SORT_LEN];
+
+	for(uint8_t run = 0; run < BENCH_RUNS; run++) {
+		for(uint8_t i = 0; i < BENCH_SORT_LEN; i++)
+			data[i] = 30 + i * 5;
+		bench_mark(BENCH_BSORT);
+		bsort(data, BENCH_SORT_LEN);
+		bench_mark(BENCH_STOP);
+		sink = data[3] + data[4];
+	}
+}
+
+int main(void)
+{
+	bench_mark(BENCH_STOP);
+
+	i2c_init();
+	bench_empty();
+	bench_rfm_rx();
+	bench_crc8();
+	bench_text();
+	bench_rds_isr();
+	bench_bmp180();
+	bench_ts();
+	bench_line();
+	bench_bsort();
+
+	// simavr stops on sleep with interrupts disabled
+	cli();
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	sleep_enable();
+	sleep_cpu();
+	return 0;
+}
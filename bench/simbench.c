@@ -0,0 +1,353 @@
+/* simavr runner for shDAN cycle-count benchmarks
+
+   Loads bench_main.elf to simulated ATmega32 with RFM12 and I2C
+   models and counts CPU cycles between PORTA markers, see bench.h
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "avr_ioport.h"
+#include "avr_spi.h"
+#include "avr_twi.h"
+
+#include "bench.h"
+
+#define BENCH_FREQ      8000000
+#define BENCH_MAX_CYCLE (BENCH_FREQ * 60ULL) // one minute of AVR time
+
+// RFM12 pins as in base_main.c: SS (PB4) and nIRQ (PD3)
+#define RFM_CS_PORT  'B'
+#define RFM_CS_PIN   4
+#define RFM_IRQ_PORT 'D'
+#define RFM_IRQ_PIN  3
+
+#define BENCH_INFO(id, name, unit, n) [id] = { name, unit, n },
+static const struct {
+	const char *name;
+	const char *unit;
+	uint32_t    n;
+} info[BENCH_NUM] = {
+	BENCH_LIST(BENCH_INFO)
+};
+
+typedef struct bench_stat_s {
+	uint32_t runs;
+	uint64_t sum;
+	uint64_t min;
+	uint64_t max;
+} bench_stat_t;
+
+static bench_stat_t stat[BENCH_NUM];
+static uint8_t  bench_id;
+static uint64_t bench_start;
+
+// RFM12 model: status and RX FIFO reads, RX FIFO is loaded with
+// a valid frame on every 'receiver chain on' power command
+typedef struct rfm_s {
+	uint8_t cs;
+	uint8_t idx; // byte index in 16 bit command
+	uint8_t cmd; // command high byte
+	uint8_t fifo[BENCH_RX_BYTES];
+	uint8_t head;
+	uint8_t len;
+	avr_irq_t *spi_in;
+	avr_irq_t *nirq;
+} rfm_t;
+
+static rfm_t rfm;
+
+static void bench_port(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+	avr_t *avr = (avr_t *)param;
+	(void)irq;
+
+	if (value == BENCH_STOP) {
+		if (bench_id) {
+			bench_stat_t *st = &stat[bench_id];
+			uint64_t cycles = avr->cycle - bench_start;
+			if (!st->runs || cycles < st->min)
+				st->min = cycles;
+			if (cycles > st->max)
+				st->max = cycles;
+			st->sum += cycles;
+			st->runs++;
+		}
+		bench_id = 0;
+		return;
+	}
+	if (value < BENCH_NUM) {
+		bench_id = value;
+		bench_start = avr->cycle;
+	}
+}
+
+// same as _crc_ibutton_update()
+static uint8_t crc_ibutton(uint8_t crc, uint8_t data)
+{
+	crc ^= data;
+	for(uint8_t i = 0; i < 8; i++)
+		crc = (crc & 0x01) ? (crc >> 1) ^ 0x8C : (crc >> 1);
+	return crc;
+}
+
+// len, data ^ 0xA5, crc and tail as sent by rfm12_send()
+static void rfm_load(void)
+{
+	const uint8_t data[BENCH_RX_LEN] = { 0x11, 0x0A, 21, 50 };
+	uint8_t crc = crc_ibutton(0xD4, BENCH_RX_LEN);
+	uint8_t i = 0;
+
+	rfm.fifo[i++] = BENCH_RX_LEN;
+	for(uint8_t n = 0; n < BENCH_RX_LEN; n++) {
+		crc = crc_ibutton(crc, data[n]);
+		rfm.fifo[i++] = data[n] ^ 0xA5;
+	}
+	rfm.fifo[i++] = crc;
+	rfm.fifo[i++] = 0x55;
+	rfm.head = 0;
+	rfm.len = i;
+}
+
+static void rfm_cs(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+	(void)irq;
+	(void)param;
+	rfm.cs = value;
+	if (!value)
+		rfm.idx = 0;
+}
+
+static void rfm_spi(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+	uint8_t reply = 0;
+	(void)irq;
+	(void)param;
+
+	if (!rfm.cs) {
+		if (rfm.idx == 0) {
+			rfm.cmd = value;
+			// status and FIFO read: FFIT is the first bit out
+			if (value == 0x00)
+				reply = rfm.len ? 0x80 : 0;
+			else if (value == 0xB0)
+				reply = 0x80;
+		}
+		else {
+			if (rfm.cmd == 0xB0 && rfm.len) {
+				reply = rfm.fifo[rfm.head++];
+				rfm.len--;
+			}
+			// RFM12CMD_PWR | RFM12_ERXCHAIN
+			if (rfm.cmd == 0x82 && (value & 0x80))
+				rfm_load();
+		}
+		rfm.idx ^= 1;
+	}
+	avr_raise_irq(rfm.spi_in, reply);
+	avr_raise_irq(rfm.nirq, rfm.len ? 0 : 1);
+}
+
+// acknowledges any address and data, reads return 0xFF
+static void twi_slave(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+	avr_t *avr = (avr_t *)param;
+	avr_twi_msg_irq_t v;
+	avr_irq_t *in = avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_INPUT);
+	(void)irq;
+
+	v.u.v = value;
+	if (v.u.twi.msg & TWI_COND_START)
+		avr_raise_irq(in, avr_twi_irq_msg(TWI_COND_ACK, v.u.twi.addr, 1));
+	if (v.u.twi.msg & TWI_COND_WRITE)
+		avr_raise_irq(in, avr_twi_irq_msg(TWI_COND_ACK, v.u.twi.addr, 1));
+	if (v.u.twi.msg & TWI_COND_READ)
+		avr_raise_irq(in, avr_twi_irq_msg(TWI_COND_READ, v.u.twi.addr, 0xFF));
+}
+
+static void bench_attach(avr_t *avr)
+{
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(BENCH_PORT_NAME),
+		IOPORT_IRQ_REG_PORT), bench_port, avr);
+
+	rfm.cs = 1;
+	rfm.spi_in = avr_io_getirq(avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_INPUT);
+	rfm.nirq = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(RFM_IRQ_PORT), RFM_IRQ_PIN);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_OUTPUT),
+		rfm_spi, NULL);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(RFM_CS_PORT), RFM_CS_PIN),
+		rfm_cs, NULL);
+	avr_raise_irq(rfm.nirq, 1);
+
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_OUTPUT),
+		twi_slave, avr);
+}
+
+// average cycles of a section without marker overhead
+static double bench_cycles(uint8_t id)
+{
+	const bench_stat_t *st = &stat[id];
+	if (!st->runs)
+		return 0;
+	double cycles = (double)st->sum / st->runs;
+	if (id != BENCH_EMPTY && stat[BENCH_EMPTY].runs)
+		cycles -= (double)stat[BENCH_EMPTY].min;
+	return cycles;
+}
+
+static void report(void)
+{
+	printf("%-20s %10s %-6s %10s %10s %10s %5s\n",
+		"name", "cycles", "per", "total", "min", "max", "runs");
+	for(uint8_t id = 1; id < BENCH_NUM; id++) {
+		const bench_stat_t *st = &stat[id];
+		double cycles = bench_cycles(id);
+		printf("%-20s %10.1f %-6s %10.1f %10llu %10llu %5u\n",
+			info[id].name, cycles / info[id].n, info[id].unit, cycles,
+			(unsigned long long)st->min, (unsigned long long)st->max, st->runs);
+	}
+}
+
+static int8_t baseline_write(const char *fname)
+{
+	FILE *fd = fopen(fname, "w");
+	if (!fd) {
+		perror(fname);
+		return -1;
+	}
+	fprintf(fd, "# name cycles per unit, generated by simbench\n");
+	for(uint8_t id = 1; id < BENCH_NUM; id++)
+		fprintf(fd, "%s %.1f\n", info[id].name, bench_cycles(id) / info[id].n);
+	fclose(fd);
+	return 0;
+}
+
+// returns number of benchmarks slower than baseline by more than tol percent
+static int baseline_check(const char *fname, double tol)
+{
+	char line[128], name[64];
+	double base;
+	int slower = 0;
+
+	FILE *fd = fopen(fname, "r");
+	if (!fd) {
+		perror(fname);
+		return -1;
+	}
+	printf("\n%-20s %10s %10s %8s\n", "name", "baseline", "now", "diff");
+	while(fgets(line, sizeof(line), fd)) {
+		if (line[0] == '#' || sscanf(line, "%63s %lf", name, &base) != 2)
+			continue;
+		uint8_t id;
+		for(id = 1; id < BENCH_NUM; id++) {
+			if (strcmp(name, info[id].name) == 0)
+				break;
+		}
+		if (id == BENCH_NUM) {
+			printf("%-20s %10.1f %10s\n", name, base, "removed");
+			continue;
+		}
+		double now = bench_cycles(id) / info[id].n;
+		double diff = base ? 100.0 * (now - base) / base : 0;
+		uint8_t bad = diff > tol;
+		printf("%-20s %10.1f %10.1f %+7.1f%%%s\n", name, base, now, diff, bad ? " SLOWER" : "");
+		slower += bad;
+	}
+	fclose(fd);
+	return slower;
+}
+
+static void usage(const char *name)
+{
+	printf("usage: %s [-w baseline] [-c baseline] [-t percent] bench_main.elf\n", name);
+	printf("  -w FILE  write results to baseline file\n");
+	printf("  -c FILE  compare results with baseline file, fails if slower\n");
+	printf("  -t PCT   allowed slowdown, percent (0)\n");
+}
+
+int main(int argc, char **argv)
+{
+	const char *wfile = NULL, *cfile = NULL;
+	double tol = 0;
+	int opt;
+
+	while((opt = getopt(argc, argv, "w:c:t:h")) != -1) {
+		switch(opt) {
+		case 'w': wfile = optarg; break;
+		case 'c': cfile = optarg; break;
+		case 't': tol = atof(optarg); break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (optind >= argc) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	elf_firmware_t fw;
+	memset(&fw, 0, sizeof(fw));
+	if (elf_read_firmware(argv[optind], &fw) != 0) {
+		fprintf(stderr, "unable to load %s\n", argv[optind]);
+		return 1;
+	}
+
+	avr_t *avr = avr_make_mcu_by_name("atmega32");
+	if (!avr) {
+		fprintf(stderr, "atmega32 is not supported by simavr\n");
+		return 1;
+	}
+	avr_init(avr);
+	// bench_main.elf has no .mmcu section
+	fw.frequency = BENCH_FREQ;
+	avr_load_firmware(avr, &fw);
+	avr->frequency = BENCH_FREQ;
+	bench_attach(avr);
+
+	int state = cpu_Running;
+	while((state != cpu_Done) && (state != cpu_Crashed) && (avr->cycle < BENCH_MAX_CYCLE))
+		state = avr_run(avr);
+
+	if (state != cpu_Done) {
+		fprintf(stderr, "bench firmware %s at cycle %llu\n",
+			(state == cpu_Crashed) ? "crashed" : "timed out", (unsigned long long)avr->cycle);
+		return 1;
+	}
+
+	report();
+	for(uint8_t id = 1; id < BENCH_NUM; id++) {
+		if (!stat[id].runs) {
+			fprintf(stderr, "%s was not measured\n", info[id].name);
+			return 1;
+		}
+	}
+
+	if (wfile && baseline_write(wfile) != 0)
+		return 1;
+	if (cfile) {
+		int slower = baseline_check(cfile, tol);
+		if (slower)
+			return 1;
+	}
+	return 0;
+}
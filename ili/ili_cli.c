@@ -35,184 +35,215 @@ void test_draw(ili9225_t *ili, uint8_t reset);
 
 static const char version[] PROGMEM = "2015-05-04\n";
 
-// list of supported commands 
-const char cmd_list[] PROGMEM = 
-	"  mem\n"
-	"  time\n"
-	"  reset\n"
-	"  status\n"
-	"  calibrate\n"
-	"  led on|off\n"
-	"  set osccal X\n"
-	"  ili dir 0|1\n"
-	"  ili led on|off|0-255\n"
-	"  ili init|draw|text str\n"
-	"  ili disp standby|off|on\n"
-	"  ili scroll set start end\n"
-	"  ili scroll line\n";
+extern const cli_cmd_t ili_cmds[];
 
-int8_t cli_ili(char *buf, void *ptr)
+static int8_t cmd_help(char *arg UNUSED, void *ptr UNUSED)
 {
-	char *arg;
-	char cmd[CMD_LEN + 1];
+	uart_puts_p(PSTR("  version: "));
+	uart_puts_p(version);
+	cli_help(ili_cmds);
+	return 0;
+}
 
-	ili9225_t *ili = ptr;
-	memcpy(cmd, buf, sizeof(cmd));
-	arg = get_arg(cmd);
+// SW reset
+static int8_t cmd_reset(char *arg UNUSED, void *ptr UNUSED)
+{
+	puts_P(PSTR("\nresetting..."));
+	wdt_enable(WDTO_15MS);
+	while(1);
+	return 0;
+}
 
-	if (str_is(cmd, PSTR("help"))) {
-		uart_puts_p(PSTR("  version: "));
-		uart_puts_p(version);
-		uart_puts_p(cmd_list);
-		return 0;
-	}
+static int8_t cmd_time(char *arg UNUSED, void *ptr UNUSED)
+{
+	char buf[16];
+	get_time(buf);
+	printf_P(PSTR("%s\n"), buf);
+	return 0;
+}
 
-	// SW reset
-	if (str_is(cmd, PSTR("reset"))) {
-		puts_P(PSTR("\nresetting..."));
-		wdt_enable(WDTO_15MS);
-		while(1);
-	}
+static int8_t cmd_led(char *arg, void *ptr UNUSED)
+{
+	int8_t on = get_on_off(arg);
+	if (on == 1)
+		active |= ACTIVE_DLED;
+	if (on == 0)
+		active &= ~ACTIVE_DLED;
+	if (!(active & ACTIVE_DLED))
+		pinMode(PND7, OUTPUT_LOW);
+	printf_P(PSTR("led is %s\n"), is_on(active & ACTIVE_DLED));
+	return 0;
+}
+
+static int8_t cmd_status(char *arg UNUSED, void *ptr UNUSED)
+{
+	print_status();
+	return 0;
+}
 
-	if (str_is(cmd, PSTR("mem"))) {
-		printf_P(PSTR("memory %d\n"), free_mem());
+static int8_t ili_init(char *arg UNUSED, void *ili)
+{
+	ili9225_init(ili);
+	return 0;
+}
+
+static int8_t ili_draw(char *arg UNUSED, void *ili)
+{
+	test_draw(ili, 1);
+	return 0;
+}
+
+static int8_t ili_text(char *arg, void *ili)
+{
+	ili9225_text(ili, 0, 0, arg, TEXT_OVERLINE | TEXT_UNDERLINE);
+	return 0;
+}
+
+static int8_t ili_disp(char *arg, void *ili)
+{
+	if (str_is(arg, PSTR("on"))) {
+		ili9225_set_disp(ili, ILI9225_DISP_ON);
 		return 0;
 	}
-
-	if (str_is(cmd, PSTR("time"))) {
-		get_time(cmd);
-		printf_P(PSTR("%s\n"), cmd);
+	if (str_is(arg, PSTR("off"))) {
+		ili9225_set_disp(ili, ILI9225_DISP_OFF);
 		return 0;
 	}
-
-	if (str_is(cmd, PSTR("led"))) {
-		if (str_is(arg, PSTR("on")))
-			active |= ACTIVE_DLED;
-		if (str_is(arg, PSTR("off")))
-			active &= ~ACTIVE_DLED;
-		if (!(active & ACTIVE_DLED))
-			pinMode(PND7, OUTPUT_LOW);
-		printf_P(PSTR("%s is %s\n"), cmd, is_on(active & ACTIVE_DLED));
+	if (str_is(arg, PSTR("standby"))) {
+		ili9225_set_disp(ili, ILI9225_DISP_STANDBY);
 		return 0;
 	}
+	return CLI_EARG;
+}
 
-	if (str_is(cmd, PSTR("status"))) {
-		print_status();
+static int8_t ili_led(char *arg, void *ili)
+{
+	int8_t on = get_on_off(arg);
+	if (on == 1) {
+		ili9225_set_backlight(ili, ILI9225_BKL_ON);
 		return 0;
 	}
-
-	if (str_is(cmd, PSTR("calibrate"))) {
-		puts_P(PSTR("\ncalibrating..."));
-		if (str_is(arg, PSTR("default")))
-			serial_calibrate(osccal_def);
-		else
-			serial_calibrate(OSCCAL);
+	if (on == 0) {
+		ili9225_set_backlight(ili, ILI9225_BKL_OFF);
 		return 0;
 	}
+	uint8_t duty = atoi(arg);
+	ili9225_set_backlight(ili, duty);
+	return CLI_EOK;
+}
 
-	if (str_is(cmd, PSTR("ili"))) {
-		char *sval = get_arg(arg);
-		if (str_is(arg, PSTR("init"))) {
-			ili9225_init(ili);
-			return 0;
-		}
-		if (str_is(arg, PSTR("draw"))) {
-			test_draw(ili, 1);
-			return 0;
-		}
-		if (str_is(arg, PSTR("text"))) {
-			ili9225_text(ili, 0, 0, sval, TEXT_OVERLINE | TEXT_UNDERLINE);
-			return 0;
-		}
-		if (str_is(arg, PSTR("disp"))) {
-			if (str_is(sval, PSTR("on"))) {
-				ili9225_set_disp(ili, ILI9225_DISP_ON);
-				return 0;
-			}
-			if (str_is(sval, PSTR("off"))) {
-				ili9225_set_disp(ili, ILI9225_DISP_OFF);
-				return 0;
-			}
-			if (str_is(sval, PSTR("standby"))) {
-				ili9225_set_disp(ili, ILI9225_DISP_STANDBY);
-				return 0;
-			}
-			return CLI_EARG;
-		}
-		if (str_is(arg, PSTR("led"))) {
-			if (str_is(sval, PSTR("on"))) {
-				ili9225_set_backlight(ili, ILI9225_BKL_ON);
-				return 0;
-			}
-			if (str_is(sval, PSTR("off"))) {
-				ili9225_set_backlight(ili, ILI9225_BKL_OFF);
-				return 0;
-			}
-			uint8_t duty = atoi(sval);
-			ili9225_set_backlight(ili, duty);
-			return CLI_EOK;
-		}
-		if (str_is(arg, PSTR("dir"))) {
-			uint8_t dir = atoi(sval);
-			ili9225_set_dir(ili, dir);
-			test_draw(ili, 1);
-			ili9225_text(ili, 0, 0, "text text text text ", TEXT_OVERLINE | TEXT_UNDERLINE);
-			return 0;
-		}
-		if (str_is(arg, PSTR("scroll"))) {
-			char *start = get_arg(sval);
-			char *end = get_arg(start);
-			if (str_is(sval, PSTR("set"))) {
-				uint8_t top = atoi(start);
-				uint8_t bot = atoi(end);
-				if (top > ILI9225_MAX_Y)
-					top = ILI9225_MAX_Y;
-				if (bot > ILI9225_MAX_Y)
-					bot = ILI9225_MAX_Y;
-				if (top < bot)
-					ili9225_set_scroll(ili, top, bot);
-				else
-					ili9225_set_scroll(ili, bot, top);
-				return 0;
-			}
-			uint8_t line = atoi(sval);
-			if (line < 219 && line) {
-				ili9225_set_fg_color(ili, RGB16_RED);
-				ili9225_line(ili, 0, line-1, 175, line-1);
-			}
-			ili9225_scroll(ili, line);
-			return 0;
-		}
-		return CLI_EARG;
-	}
+static int8_t ili_dir(char *arg, void *ili)
+{
+	uint8_t dir = atoi(arg);
+	ili9225_set_dir(ili, dir);
+	test_draw(ili, 1);
+	ili9225_text(ili, 0, 0, "text text text text ", TEXT_OVERLINE | TEXT_UNDERLINE);
+	return 0;
+}
 
-	if (str_is(cmd, PSTR("set"))) {
-		char *sval = get_arg(arg);
-		if (str_is(arg, PSTR("osccal"))) {
-			uint8_t osc = atoi(sval);
-			serial_set_osccal(osc);
-			eeprom_update_byte(&em_osccal, osc);
-			return 0;
-		}
-		
-		if (str_is(arg, PSTR("time"))) {
-			uint8_t hour, min, sec;
-			hour = strtoul(sval, &arg, 10);
-			if (hour < 24 && *arg == ':') {
-				min = strtoul(arg + 1, &arg, 10);
-				if (min < 60 && *arg == ':') {
-					sec = strtoul(arg + 1, &arg, 10);
-					if (sec < 60) {
-						swtime = hour * 3600;
-						swtime += min*60;
-						swtime += sec;
-						return 0;
-					}
-				}
-			}
-		}
-		return -1;
+static int8_t ili_scroll(char *arg, void *ili)
+{
+	uint8_t line = atoi(arg);
+	if (line < 219 && line) {
+		ili9225_set_fg_color(ili, RGB16_RED);
+		ili9225_line(ili, 0, line-1, 175, line-1);
 	}
+	ili9225_scroll(ili, line);
+	return 0;
+}
+
+static int8_t ili_scroll_set(char *arg, void *ili)
+{
+	char *end = get_arg(arg);
+	uint8_t top = atoi(arg);
+	uint8_t bot = atoi(end);
+	if (top > ILI9225_MAX_Y)
+		top = ILI9225_MAX_Y;
+	if (bot > ILI9225_MAX_Y)
+		bot = ILI9225_MAX_Y;
+	if (top < bot)
+		ili9225_set_scroll(ili, top, bot);
+	else
+		ili9225_set_scroll(ili, bot, top);
+	return 0;
+}
+
+static int8_t set_osccal(char *arg, void *ptr UNUSED)
+{
+	uint8_t osc = atoi(arg);
+	serial_set_osccal(osc);
+	eeprom_update_byte(&em_osccal, osc);
+	return 0;
+}
 
-	return CLI_ENOTSUP;
+static int8_t set_time(char *arg, void *ptr UNUSED)
+{
+	uint8_t hms[3];
+	if (get_hms(arg, hms) != 0)
+		return CLI_EARG;
+	swtime = hms[0] * 3600;
+	swtime += hms[1]*60;
+	swtime += hms[2];
+	return 0;
+}
+
+static const char pstr_help[] PROGMEM = "help";
+static const char pstr_mem[] PROGMEM = "mem";
+static const char pstr_time[] PROGMEM = "time";
+static const char pstr_reset[] PROGMEM = "reset";
+static const char pstr_status[] PROGMEM = "status";
+static const char pstr_calibrate[] PROGMEM = "calibrate";
+static const char pstr_led[] PROGMEM = "led on|off";
+static const char pstr_set[] PROGMEM = "set";
+static const char pstr_osccal[] PROGMEM = "osccal X";
+static const char pstr_set_time[] PROGMEM = "time hh:mm:ss";
+static const char pstr_ili[] PROGMEM = "ili";
+static const char pstr_ili_dir[] PROGMEM = "dir 0|1";
+static const char pstr_ili_led[] PROGMEM = "led on|off|0-255";
+static const char pstr_ili_init[] PROGMEM = "init";
+static const char pstr_ili_draw[] PROGMEM = "draw";
+static const char pstr_ili_text[] PROGMEM = "text str";
+static const char pstr_ili_disp[] PROGMEM = "disp standby|off|on";
+static const char pstr_ili_scroll[] PROGMEM = "scroll line|set start end";
+static const char pstr_ili_scroll_set[] PROGMEM = "set start end";
+
+static const cli_cmd_t set_cmds[] PROGMEM = {
+	{ pstr_osccal, set_osccal, NULL },
+	{ pstr_set_time, set_time, NULL },
+	{ NULL, NULL, NULL }
+};
+
+static const cli_cmd_t scroll_cmds[] PROGMEM = {
+	{ pstr_ili_scroll_set, ili_scroll_set, NULL },
+	{ NULL, NULL, NULL }
+};
+
+static const cli_cmd_t ili_sub_cmds[] PROGMEM = {
+	{ pstr_ili_dir, ili_dir, NULL },
+	{ pstr_ili_led, ili_led, NULL },
+	{ pstr_ili_init, ili_init, NULL },
+	{ pstr_ili_draw, ili_draw, NULL },
+	{ pstr_ili_text, ili_text, NULL },
+	{ pstr_ili_disp, ili_disp, NULL },
+	{ pstr_ili_scroll, ili_scroll, scroll_cmds },
+	{ NULL, NULL, NULL }
+};
+
+// list of supported commands 
+const cli_cmd_t ili_cmds[] PROGMEM = {
+	{ pstr_help, cmd_help, NULL },
+	{ pstr_mem, cli_mem, NULL },
+	{ pstr_time, cmd_time, NULL },
+	{ pstr_reset, cmd_reset, NULL },
+	{ pstr_status, cmd_status, NULL },
+	{ pstr_calibrate, cli_calibrate, NULL },
+	{ pstr_led, cmd_led, NULL },
+	{ pstr_set, NULL, set_cmds },
+	{ pstr_ili, NULL, ili_sub_cmds },
+	{ NULL, NULL, NULL }
+};
+
+int8_t cli_ili(char *buf, void *ptr)
+{
+	return cli_dispatch(ili_cmds, buf, ptr);
 }
@@ -16,10 +16,12 @@
    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <stdio.h>
+#include <string.h>
 #ifdef __AVR_ARCH__
 	#include <avr/pgmspace.h>
 #else
 	#define PROGMEM
+	#define pgm_read_byte(x) (*((const uint8_t *)(x)))
 #endif
 
 #include "bmfont.h"
@@ -37,10 +39,10 @@ static const uint8_t font816[] PROGMEM = {
 };
 
 static bmfont_t _ofont[BMFONT_MAX+1] = {
-	{  6,  8, 32, 127-32, font68 },	
-	{  8,  8, 32, 127-32, font88 },
-	{  8, 16, 32, 127-32, font816 },
-	{  0,  0, 0,       0, NULL }
+	{  6,  8, 32, 127-32, font68, BMFONT_PAGES },
+	{  8,  8, 32, 127-32, font88, BMFONT_PAGES },
+	{  8, 16, 32, 127-32, font816, BMFONT_PAGES },
+	{  0,  0, 0,       0, NULL, 0 }
 };
 
 static uint8_t _cfont;
@@ -66,10 +68,88 @@ void bmfont_set(bmfont_t *nfont, bmfont_t *ofont)
 		ofont->go = _ofont[BMFONT_USER].go;
 		ofont->gn = _ofont[BMFONT_USER].gn;
 		ofont->font = _ofont[BMFONT_USER].font;
+		ofont->flags = _ofont[BMFONT_USER].flags;
 	}
 	_ofont[BMFONT_USER].gw = nfont->gw;
 	_ofont[BMFONT_USER].gh = nfont->gh; 
 	_ofont[BMFONT_USER].go = nfont->go;
 	_ofont[BMFONT_USER].gn = nfont->gn;
 	_ofont[BMFONT_USER].font = nfont->font;
+	_ofont[BMFONT_USER].flags = nfont->flags;
+}
+
+uint8_t bmfont_glyph_size(const bmfont_t *pfont, uint8_t layout)
+{
+	if (layout & BMFONT_ROWS)
+		return ((pfont->gw + 7) / 8) * pfont->gh;
+	return pfont->gw * ((pfont->gh + 7) / 8);
+}
+
+// PackBits: control byte 0-127 is followed by 1-128 literal bytes,
+// 128-255 by one byte repeated 2-129 times
+static void bmfont_unpack(const uint8_t *src, uint8_t *dst, uint8_t len)
+{
+	while(len) {
+		uint8_t c = pgm_read_byte(src++);
+		uint8_t n = (c & 0x7F) + ((c & 0x80) ? 2 : 1);
+		if (n > len)
+			n = len;
+		len -= n;
+		if (c & 0x80) {
+			memset(dst, pgm_read_byte(src++), n);
+			dst += n;
+		}
+		else {
+			for(; n; n--)
+				*dst++ = pgm_read_byte(src++);
+		}
+	}
+}
+
+uint8_t bmfont_glyph(const bmfont_t *pfont, char ch, uint8_t *buf, uint8_t layout)
+{
+	uint8_t idx = (uint8_t)ch - pfont->go;
+	if (idx >= pfont->gn)
+		return 0;
+
+	uint8_t gb = bmfont_glyph_size(pfont, pfont->flags);
+	uint8_t *src = buf;
+	uint8_t tmp[BMFONT_GLYPH_MAX];
+	// converted glyph is unpacked to tmp first
+	if ((layout ^ pfont->flags) & BMFONT_ROWS)
+		src = tmp;
+
+	if (pfont->flags & BMFONT_RLE) {
+		// compressed glyphs are preceded by the table of 16 bit offsets
+		const uint8_t *poff = pfont->font + idx*2;
+		uint16_t off = pgm_read_byte(poff) | (pgm_read_byte(poff + 1) << 8);
+		bmfont_unpack(pfont->font + off, src, gb);
+	}
+	else {
+		const uint8_t *glyph = pfont->font + idx*gb;
+		for(uint8_t i = 0; i < gb; i++)
+			src[i] = pgm_read_byte(glyph + i);
+	}
+
+	if (src == buf)
+		return gb;
+
+	uint8_t gw = pfont->gw;
+	uint8_t gh = pfont->gh;
+	uint8_t rb = (gw + 7) / 8; // bytes per row
+	gb = bmfont_glyph_size(pfont, layout);
+	memset(buf, 0, gb);
+	for(uint8_t y = 0; y < gh; y++) {
+		for(uint8_t x = 0; x < gw; x++) {
+			if (layout & BMFONT_ROWS) {
+				if (src[(y/8)*gw + x] & (1 << (y & 7)))
+					buf[y*rb + x/8] |= 1 << (x & 7);
+			}
+			else {
+				if (src[y*rb + x/8] & (1 << (x & 7)))
+					buf[(y/8)*gw + x] |= 1 << (y & 7);
+			}
+		}
+	}
+	return gb;
 }
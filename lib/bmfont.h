@@ -33,6 +33,14 @@ extern "C" {
 #define BMFONT_USER 3
 #define BMFONT_MAX  BMFONT_USER
 
+/** glyph layout and compression, bmfont_t flags */
+#define BMFONT_PAGES 0x00 /*< bytes are columns of 8 pixel pages, page by page, as bdfe makes */
+#define BMFONT_ROWS  0x01 /*< rows of pixels, (gw+7)/8 bytes per row, leftmost pixel in bit 0 */
+#define BMFONT_RLE   0x02 /*< glyphs are compressed, see tools/bmfont.py */
+
+/** buffer size for bmfont_glyph(), enough for 16x32 glyphs */
+#define BMFONT_GLYPH_MAX 64
+
 typedef struct bmfont_s
 {
 	uint8_t gw; /*< glyph width  */
@@ -40,6 +48,7 @@ typedef struct bmfont_s
 	uint8_t go; /*< font offset, first glyph index */
 	uint8_t gn; /*< number of glyphs presented */
 	const uint8_t *font;
+	uint8_t flags; /*< BMFONT_ROWS, BMFONT_RLE */
 } bmfont_t;
 
 /** text attributes */
@@ -59,6 +68,15 @@ bmfont_t *bmfont_get(void);
  */
 void bmfont_set(bmfont_t *nfont, bmfont_t *ofont);
 
+/** glyph size in bytes for the layout, BMFONT_PAGES or BMFONT_ROWS */
+uint8_t bmfont_glyph_size(const bmfont_t *pfont, uint8_t layout);
+
+/**
+ unpack glyph of ch to buf in the layout requested, converting it from
+ the font's one if needed, returns glyph size or 0 if ch is not in the font
+ */
+uint8_t bmfont_glyph(const bmfont_t *pfont, char ch, uint8_t *buf, uint8_t layout);
+
 #ifdef __cplusplus
 }
 #endif
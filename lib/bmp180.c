@@ -107,15 +107,9 @@ int8_t bmp180_init(bmp180_t *pcc)
 	return 0;
 }
 
-int8_t bmp180_poll(bmp180_t *pcc, uint8_t tmode)
+// quite lengthly conversion of raw t/p values
+void bmp180_calc(bmp180_t *pcc, uint8_t tmode)
 {
-	// read raw t/p from bmp180
-	if (bmp180_read_data(pcc) != 0) {
-		pcc->valid &= ~(BMP180_T_VALID | BMP180_P_VALID);
-		return -1;
-	}
-
-	// quite lengthly conversion of raw t/p values
 	if (tmode || (pcc->cmd == BMP180_GET_T)) {
 		int32_t x1 = (((uint32_t)pcc->rawt - (uint32_t)pcc->ac6)*pcc->ac5) >> 15;
 		int32_t x2 = (((int32_t)pcc->mc) << 11)/(x1 + pcc->md);
@@ -163,6 +157,16 @@ int8_t bmp180_poll(bmp180_t *pcc, uint8_t tmode)
 		pcc->valid |= BMP180_P_VALID;
 		pcc->cmd = BMP180_GET_T;
 	}
+}
+
+int8_t bmp180_poll(bmp180_t *pcc, uint8_t tmode)
+{
+	// read raw t/p from bmp180
+	if (bmp180_read_data(pcc) != 0) {
+		pcc->valid &= ~(BMP180_T_VALID | BMP180_P_VALID);
+		return -1;
+	}
 
+	bmp180_calc(pcc, tmode);
 	return bmp180_write(BMP180_CMD_REG, pcc->cmd);
 }
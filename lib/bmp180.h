@@ -67,6 +67,8 @@ int8_t bmp180_init(bmp180_t *pcc);
 #define BMP180_P_MODE 0
 #define BMP180_T_MODE 1
 int8_t bmp180_poll(bmp180_t *pcc, uint8_t mode);
+// convert rawt/rawp to t/p, called by bmp180_poll() after reading raw data
+void bmp180_calc(bmp180_t *pcc, uint8_t mode);
 
 #ifdef __cplusplus
 }
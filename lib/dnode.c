@@ -81,10 +81,14 @@ int8_t log_read_rec(uint8_t lidx, uint16_t ridx, dnode_log_t *rec)
 	return i2cmem_read_data(addr, rec, sizeof(dnode_log_t));
 }
 
+// log records are written from the radio task,
+// do not wait for EEPROM there
+static i2cmem_xfer_t log_mx;
+
 int8_t log_write_rec(uint8_t lidx, uint16_t ridx, dnode_log_t *rec)
 {
 	uint16_t addr = LOG_SIZE * lidx + ridx*sizeof(dnode_log_t);
-	return i2cmem_write_data(addr, rec, sizeof(dnode_log_t));
+	return i2cmem_write_async(&log_mx, addr, rec, sizeof(dnode_log_t));
 }
 
 int8_t log_erase_rec(uint8_t lidx, uint16_t ridx)
@@ -30,6 +30,7 @@ extern "C" {
 #define MAX_DNODE_NUM  12
 
 #define NODE_LBS       13 // listening base station
+#define REPEAT_DELAY   2  // sec, TX repeat session delay in node + 6 slot
 
 #define NID_MASK   0x0F // node index mask
 #define NODE_TSYNC 0x80 // time sync request
@@ -88,7 +89,9 @@ extern "C" {
        node 2 at 05 sec of every minute and so one.
 	   Session cannot be longer that 5 seconds, last message should have EOS
 	   bit set to indicate End of Session, so base station can sent messages
-	   to AA (Always Active) nodes or other nodes can transmit urgent data
+	   to AA (Always Active) nodes or other nodes can transmit urgent data.
+	   Nodes 1-6 with TX repeat send the session again REPEAT_DELAY seconds
+	   after the start of node + 6 slot, so they do not collide with it
 
  stat bits: sla0vvvv
  s: sleep mode is on
@@ -102,6 +105,8 @@ extern "C" {
  c: command
 */
 
+// on-air and EEPROM layout, byte packed as on AVR for host builds
+#pragma pack(push, 1)
 typedef union dsens_data_u {
 	struct {
 		uint8_t val; // value, high bit: negative value
@@ -156,6 +161,7 @@ typedef struct dnode_status_s {
 	dsens_data_t sdata[6]; // sensor data
 	uint8_t name[NODE_NAME_LEN];
 } dnode_status_t;
+#pragma pack(pop)
 
 typedef int8_t sens_poll(dnode_t *dval, void *ptr);
 
@@ -191,10 +197,47 @@ static inline uint8_t get_sens_type(dnode_t *dval, uint8_t sid)
 uint8_t ts_unpack(dnode_t *tsync);
 void ts_pack(dnode_t *tsync, uint8_t nid);
 
+/*
+ Time sync beacon: time sync reply to node 0 (broadcast) sent by the base
+ BEACON_DELAY msec after RTC tick of second BEACON_SEC of every BEACON_PERIOD
+ minutes. Nodes with known RTC phase listen to it around the expected time
+ instead of requesting time sync, and set their RTC phase from its arrival.
+ Beacon is skipped if the base could not send it within BEACON_LATE msec.
+*/
+#define BEACON_SEC    59
+#define BEACON_PERIOD 5   // minutes
+#define BEACON_DELAY  200 // msec
+#define BEACON_LATE   20  // msec
+
+#define IS_BEACON(min,sec) (((sec) == BEACON_SEC) && !((min) % BEACON_PERIOD))
+
+// bits 1-3 of packed raw[0] are not used by ts_pack(), base puts there
+// msec passed since its RTC tick when time sync was sent, in 1/7 sec units
+// plus one, 0 if base RTC tick is not known
+#define TS_PHASE_MASK 0x0E
+
+static inline uint8_t ts_phase_pack(uint16_t msec)
+{
+	if (msec > 999)
+		msec = 999;
+	return ((msec * 7 / 1000 + 1) << 1) & TS_PHASE_MASK;
+}
+
+// msec since the base tick, middle of the 1/7 sec unit, 0xFFFF if not known
+static inline uint16_t ts_phase_unpack(uint8_t raw0)
+{
+	uint8_t units = (raw0 & TS_PHASE_MASK) >> 1;
+	if (!units)
+		return 0xFFFF;
+	return (2 * units - 1) * 500u / 7;
+}
+
+#pragma pack(push, 1)
 typedef struct dnode_log_s {
 	uint8_t      ssi;
 	dsens_data_t data;
 } dnode_log_t;
+#pragma pack(pop)
 
 // logging functions
 void   log_erase(uint8_t lidx);
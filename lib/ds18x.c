@@ -22,6 +22,8 @@
    https://opensource.org/licenses/MIT
 */
 #include <stdio.h>
+#include <string.h>
+#include <avr/eeprom.h>
 #include <util/crc16.h>
 #include <util/delay.h>
 #include <util/atomic.h>
@@ -31,6 +33,8 @@
 
 #define DS_Tstart 1 // start time
 #define DS_Trec   2 // recovery time, the longer wire, the longer time
+#define DS_CFG_9BIT 0x1F // configuration register for 93.75 ms conversion
+#define DS_Tcopy  10 // msec, scratchpad copy to EEPROM
 
 int8_t ds18x_reset(uint8_t pin)
 {
@@ -99,19 +103,31 @@ static void ds18x_write(uint8_t pin, uint8_t data)
 	}
 }
 
-int8_t ds18x_cmd(uint8_t pin, uint8_t cmd)
+// addresses device with specified ROM, or all devices if rom is NULL
+static int8_t ds18x_rom_cmd(uint8_t pin, const uint8_t *rom, uint8_t cmd)
 {
 	int8_t error = ds18x_reset(pin);
 	if (!error) {
-		ds18x_write(pin, DS18x_CMD_SKIP_ROM);
+		if (rom) {
+			ds18x_write(pin, DS18x_CMD_MATCH_ROM);
+			for(uint8_t i = 0; i < DS18x_ROM_LEN; i++)
+				ds18x_write(pin, rom[i]);
+		}
+		else
+			ds18x_write(pin, DS18x_CMD_SKIP_ROM);
 		ds18x_write(pin, cmd);
 	}
 	return error;
 }
 
-static int8_t ds18x_read_pad(uint8_t pin, uint8_t *pad)
+int8_t ds18x_cmd(uint8_t pin, uint8_t cmd)
 {
-	int8_t error = ds18x_cmd(pin, DS18x_CMD_READ_PAD);
+	return ds18x_rom_cmd(pin, NULL, cmd);
+}
+
+static int8_t ds18x_read_pad(uint8_t pin, const uint8_t *rom, uint8_t *pad)
+{
+	int8_t error = ds18x_rom_cmd(pin, rom, DS18x_CMD_READ_PAD);
 	if (!error) {
 		for(uint8_t i = 0; i < DS18x_PAD_LEN; i++) 
 			pad[i] = ds18x_read(pin);
@@ -128,7 +144,7 @@ int8_t ds18x_init(uint8_t pin, uint8_t type)
 {
 	if (type == DSx18_TYPE_B) {
 		uint8_t pad[DS18x_PAD_LEN];
-		if (ds18x_read_pad(pin, pad) == 0) {
+		if (ds18x_read_pad(pin, NULL, pad) == 0) {
 			pad[4] = 0x3F; // 9 bit temperature conversion
 			ds18x_cmd(pin, DS18x_CMD_WRITE_PAD);
 			ds18x_write(pin, pad[2]);
@@ -144,7 +160,7 @@ int8_t ds18x_init(uint8_t pin, uint8_t type)
 int8_t ds18x_wite_data(uint8_t pin, uint16_t data)
 {
 	uint8_t pad[DS18x_PAD_LEN];
-	int8_t error = ds18x_read_pad(pin, pad);
+	int8_t error = ds18x_read_pad(pin, NULL, pad);
 	if (!error) {
 		uint16_t *ptr = (uint16_t *)pad;
 		ptr[1] = data;
@@ -161,7 +177,7 @@ int8_t ds18x_wite_data(uint8_t pin, uint16_t data)
 int8_t ds18x_read_data(uint8_t pin, uint16_t *data)
 {
 	uint8_t pad[DS18x_PAD_LEN];
-	int8_t error = ds18x_read_pad(pin, pad);
+	int8_t error = ds18x_read_pad(pin, NULL, pad);
 	if (!error) {
 		uint16_t *ptr = (uint16_t *)pad;
 		*data = ptr[1];
@@ -169,6 +185,24 @@ int8_t ds18x_read_data(uint8_t pin, uint16_t *data)
 	return error;
 }
 
+static void ds18x_parse(ds_temp_t *t, const uint8_t *pad, uint8_t family)
+{
+	// S: 0.5C per bit, B: 1/16C per bit, 3 lower bits are undefined at 9 bit
+	int16_t raw = (int16_t)((pad[1] << 8) | pad[0]);
+	uint8_t shift = 1;
+	if (family != DS18x_FAMILY_S) {
+		raw &= ~0x07;
+		shift = 4;
+	}
+	// val and dec are taken from magnitude, so -0.5 keeps its sign
+	uint16_t mag = (raw < 0) ? -raw : raw;
+	t->neg = (raw < 0);
+	t->val = mag >> shift;
+	if (t->neg)
+		t->val = -t->val;
+	t->dec = ((mag >> (shift - 1)) & 0x01) * 5;
+}
+
 int8_t ds18x_read_temp(uint8_t pin, ds_temp_t *t, uint8_t *buf)
 {
 	uint8_t local[DS18x_PAD_LEN];
@@ -176,13 +210,9 @@ int8_t ds18x_read_temp(uint8_t pin, ds_temp_t *t, uint8_t *buf)
 	if (buf)
 		pad = buf;
 
-	int8_t error = ds18x_read_pad(pin, pad);
-	if (!error) {
-		t->val = (pad[1] << 4) | (pad[0] >> 4);
-		if (t->val & 0x80)
-			t->val = -(t->val & 0x7F);
-		t->dec = ((pad[0] >> 3) & 0x01) * 5;
-	}
+	int8_t error = ds18x_read_pad(pin, NULL, pad);
+	if (!error)
+		ds18x_parse(t, pad, DS18x_FAMILY_B);
 
 	return error;
 }
@@ -202,3 +232,191 @@ int8_t ds18x_get_temp(uint8_t pin, ds_temp_t *t, uint8_t *buf)
 	}
 	return error;
 }
+
+// multi-drop bus support --------------------------------------------------
+
+static uint8_t ds18x_crc(const uint8_t *data, uint8_t len)
+{
+	uint8_t crc = 0;
+	for (uint8_t i = 0; i < len; i++)
+		crc = _crc_ibutton_update(crc, data[i]);
+	return crc;
+}
+
+// ROM search, see Maxim AN187 "1-Wire Search Algorithm"
+int8_t ds18x_search(uint8_t pin, uint8_t (*rom)[DS18x_ROM_LEN], uint8_t max)
+{
+	uint8_t id[DS18x_ROM_LEN];
+	uint8_t last = 0; // bit of the last discrepancy, 1 to 64
+	uint8_t ndev = 0;
+
+	memset(id, 0, sizeof(id));
+	do {
+		int8_t error = ds18x_reset(pin);
+		if (error)
+			return error;
+		ds18x_write(pin, DS18x_CMD_SEARCH_ROM);
+
+		uint8_t zero = 0; // last discrepancy where 0 path was taken
+		for(uint8_t bit = 1; bit <= 64; bit++) {
+			uint8_t idb = ds18x_rbit(pin);
+			uint8_t cmp = ds18x_rbit(pin);
+			if (idb && cmp)
+				return ndev ? ndev : DS18x_ENODEV;
+
+			uint8_t *byte = &id[(bit - 1) >> 3];
+			uint8_t mask = 1 << ((bit - 1) & 0x07);
+			uint8_t dir = idb;
+			if (idb == cmp) {
+				// both 0 and 1 present, take 1 path at the last discrepancy,
+				// previous path before it and 0 path after it
+				if (bit < last)
+					dir = (*byte & mask) ? 1 : 0;
+				else
+					dir = (bit == last);
+				if (!dir)
+					zero = bit;
+			}
+			if (dir)
+				*byte |= mask;
+			else
+				*byte &= ~mask;
+			ds18x_wbit(pin, dir);
+			_delay_us(DS_Trec);
+		}
+
+		if (ds18x_crc(id, DS18x_ROM_LEN) != 0)
+			return DS18x_ECRC;
+		memcpy(rom[ndev++], id, DS18x_ROM_LEN);
+		last = zero;
+	} while(last && ndev < max);
+
+	return ndev;
+}
+
+static ds_bus_t EEMEM em_ds_bus[DS18x_BUS_NUM];
+
+static int8_t ds18x_bus_check(ds_bus_t *bus)
+{
+	if (bus->ndev == 0 || bus->ndev > DS18x_BUS_DEV)
+		return -1;
+	for(uint8_t i = 0; i < bus->ndev; i++) {
+		if (ds18x_crc(bus->rom[i], DS18x_ROM_LEN) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+// 9 bit resolution for B devices, so all fit DS18x_CTIME. Config is copied
+// to the sensor EEPROM as it is loaded from there on power up
+static void ds18x_bus_config(ds_bus_t *bus)
+{
+	for(uint8_t i = 0; i < bus->ndev; i++) {
+		uint8_t pad[DS18x_PAD_LEN];
+		if (bus->rom[i][0] != DS18x_FAMILY_B)
+			continue;
+		if (ds18x_read_pad(bus->pin, bus->rom[i], pad) == 0 && pad[4] != DS_CFG_9BIT) {
+			pad[4] = DS_CFG_9BIT;
+			ds18x_rom_cmd(bus->pin, bus->rom[i], DS18x_CMD_WRITE_PAD);
+			ds18x_write(bus->pin, pad[2]);
+			ds18x_write(bus->pin, pad[3]);
+			ds18x_write(bus->pin, pad[4]);
+			ds18x_rom_cmd(bus->pin, bus->rom[i], DS18x_CMD_COPY_PAD);
+			_delay_ms(DS_Tcopy);
+		}
+	}
+}
+
+int8_t ds18x_bus_init(ds_bus_t *bus, uint8_t pin, uint8_t rescan)
+{
+	int8_t slot = -1, empty = -1;
+	for(uint8_t i = 0; i < DS18x_BUS_NUM; i++) {
+		uint8_t epin = eeprom_read_byte(&em_ds_bus[i].pin);
+		if (epin == pin) {
+			slot = i;
+			break;
+		}
+		if (epin == 0xFF && empty < 0)
+			empty = i;
+	}
+
+	if (!rescan && slot >= 0) {
+		eeprom_read_block(bus, &em_ds_bus[slot], sizeof(ds_bus_t));
+		if (ds18x_bus_check(bus) == 0) {
+			if (ds18x_reset(pin))
+				return DS18x_EPIN;
+			ds18x_bus_config(bus);
+			return bus->ndev;
+		}
+	}
+
+	bus->pin = pin;
+	bus->ndev = 0;
+	int8_t ndev = ds18x_search(pin, bus->rom, DS18x_BUS_DEV);
+	if (ndev < 0)
+		return ndev;
+	bus->ndev = ndev;
+
+	ds18x_bus_config(bus);
+
+	if (slot < 0)
+		slot = empty;
+	if (slot >= 0)
+		eeprom_update_block(bus, &em_ds_bus[slot], sizeof(ds_bus_t));
+	return ndev;
+}
+
+int8_t ds18x_bus_convert(ds_bus_t *bus)
+{
+	return ds18x_cmd(bus->pin, DS18x_CMD_COVERT);
+}
+
+int8_t ds18x_bus_wait(ds_bus_t *bus)
+{
+	// read slot returns 0 while any device is still converting
+	uint16_t ctime = DS18x_CTIME;
+	for(uint8_t i = 0; i < bus->ndev; i++) {
+		if (bus->rom[i][0] == DS18x_FAMILY_S)
+			ctime = DS18x_CTIME_S;
+	}
+
+	uint16_t i = 0;
+	while (ds18x_rbit(bus->pin) == 0 && i < ctime) {
+		_delay_ms(1);
+		i++;
+	}
+	if (i == ctime)
+		return DS18x_ETOUT;
+	return DS18x_EOK;
+}
+
+int8_t ds18x_bus_read(ds_bus_t *bus, uint8_t idx, ds_temp_t *t, uint8_t *buf)
+{
+	uint8_t local[DS18x_PAD_LEN];
+	uint8_t *pad = local;
+	if (buf)
+		pad = buf;
+
+	if (idx >= bus->ndev)
+		return DS18x_EPIN;
+	int8_t error = ds18x_read_pad(bus->pin, bus->rom[idx], pad);
+	if (!error)
+		ds18x_parse(t, pad, bus->rom[idx][0]);
+	return error;
+}
+
+int8_t ds18x_bus_get_temp(ds_bus_t *bus, ds_temp_t *t)
+{
+	int8_t error = ds18x_bus_convert(bus);
+	if (error == 0)
+		error = ds18x_bus_wait(bus);
+	if (error)
+		return error;
+
+	for(uint8_t i = 0; i < bus->ndev; i++) {
+		int8_t err = ds18x_bus_read(bus, i, &t[i], NULL);
+		if (err)
+			error = err;
+	}
+	return error;
+}
@@ -28,7 +28,13 @@
 #include <avr/io.h>
 
 #define DS18x_PAD_LEN 9
+#define DS18x_ROM_LEN 8
 #define DS18x_CTIME 150 // max conversion time, ms
+#define DS18x_CTIME_S 750 // DS18S20 has fixed 9 bit resolution and longer time
+
+// family codes, the first byte of ROM
+#define DS18x_FAMILY_S 0x10
+#define DS18x_FAMILY_B 0x28
 
 // DS18x20 commands
 #define DS18x_CMD_COVERT    0x44
@@ -36,6 +42,8 @@
 #define DS18x_CMD_READ_PAD  0xBE
 #define DS18x_CMD_WRITE_PAD 0x4E
 #define DS18x_CMD_COPY_PAD  0x48
+#define DS18x_CMD_MATCH_ROM  0x55
+#define DS18x_CMD_SEARCH_ROM 0xF0
 
 // DS18x20 errors
 #define DS18x_EOK     0
@@ -43,10 +51,12 @@
 #define DS18x_ESHORT -2 // short circuit detected
 #define DS18x_ETOUT  -3 // conversion timeout
 #define DS18x_ECRC   -4 // wrong crc
+#define DS18x_ENODEV -5 // no devices responded to ROM search
 
 typedef struct ds_temp_s {
 	int8_t  val;
 	uint8_t dec;
+	uint8_t neg; // negative temperature, val is 0 for -0.5
 } ds_temp_t;
 
 // checks is sensor is present, sets 9 bit precision
@@ -70,4 +80,35 @@ int8_t ds18x_read_temp(uint8_t pin, ds_temp_t *t, uint8_t *pad);
 int8_t ds18x_wite_data(uint8_t pin, uint16_t data);
 int8_t ds18x_read_data(uint8_t pin, uint16_t *data);
 
+// multi-drop bus support --------------------------------------------------
+
+// finds up to max devices on the pin, returns number of devices found
+int8_t ds18x_search(uint8_t pin, uint8_t (*rom)[DS18x_ROM_LEN], uint8_t max);
+
+#define DS18x_BUS_DEV 4 // devices per pin
+#define DS18x_BUS_NUM 2 // pins with device table cached in EEPROM
+
+typedef struct ds_bus_s {
+	uint8_t pin;
+	uint8_t ndev;
+	uint8_t rom[DS18x_BUS_DEV][DS18x_ROM_LEN];
+} ds_bus_t;
+
+// loads device table for the pin from EEPROM, searches the bus
+// if there is no valid table or rescan is set, returns number of devices
+int8_t ds18x_bus_init(ds_bus_t *bus, uint8_t pin, uint8_t rescan);
+
+// starts conversion on all devices at once
+int8_t ds18x_bus_convert(ds_bus_t *bus);
+
+// waits until all devices finished conversion
+int8_t ds18x_bus_wait(ds_bus_t *bus);
+
+// reads last converted temperature of device idx
+int8_t ds18x_bus_read(ds_bus_t *bus, uint8_t idx, ds_temp_t *t, uint8_t *pad);
+
+// converts and reads all devices, t must have bus->ndev entries,
+// returns the last error, temperatures of failed devices are not changed
+int8_t ds18x_bus_get_temp(ds_bus_t *bus, ds_temp_t *t);
+
 #endif
@@ -0,0 +1,159 @@
+/* Fast fixed-point numbers formatting for ATmega32
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <avr/pgmspace.h>
+
+#include "fmtnum.h"
+
+char *fmt_02u(char *dst, uint8_t val)
+{
+	char tens = '0';
+	while(val >= 10) {
+		val -= 10;
+		tens++;
+	}
+	dst[0] = tens;
+	dst[1] = '0' + val;
+	dst[2] = '\0';
+	return dst + 2;
+}
+
+// digits are generated in reverse order into digits[]
+static char *fmt_num(char *dst, uint16_t val, char sign, uint8_t width, uint8_t flags)
+{
+	char digits[5];
+	uint8_t n = 0;
+
+	do {
+		digits[n++] = '0' + (val % 10);
+		val /= 10;
+	} while(val);
+
+	uint8_t len = n + (sign ? 1 : 0);
+	if (sign && (flags & FMT_ZERO))
+		*dst++ = sign;
+	for(; width > len; width--)
+		*dst++ = (flags & FMT_ZERO) ? '0' : ' ';
+	if (sign && !(flags & FMT_ZERO))
+		*dst++ = sign;
+	while(n)
+		*dst++ = digits[--n];
+	*dst = '\0';
+	return dst;
+}
+
+static inline char fmt_sign(uint8_t neg, uint8_t flags)
+{
+	if (neg)
+		return '-';
+	if (flags & FMT_PLUS)
+		return '+';
+	if (flags & FMT_SPACE)
+		return ' ';
+	return 0;
+}
+
+char *fmt_u16(char *dst, uint16_t val, uint8_t width, uint8_t flags)
+{
+	return fmt_num(dst, val, 0, width, flags);
+}
+
+char *fmt_u32(char *dst, uint32_t val)
+{
+	if (val <= 0xFFFF)
+		return fmt_num(dst, (uint16_t)val, 0, 0, 0);
+
+	char digits[10];
+	uint8_t n = 0;
+	do {
+		digits[n++] = '0' + (val % 10);
+		val /= 10;
+	} while(val);
+	while(n)
+		*dst++ = digits[--n];
+	*dst = '\0';
+	return dst;
+}
+
+char *fmt_i16(char *dst, int16_t val, uint8_t width, uint8_t flags)
+{
+	uint8_t neg = val < 0;
+	uint16_t uval = neg ? 0 - (uint16_t)val : (uint16_t)val;
+	return fmt_num(dst, uval, fmt_sign(neg, flags), width, flags);
+}
+
+char *fmt_fixed(char *dst, uint8_t val, uint8_t dec, uint8_t width, uint8_t flags)
+{
+	// unlike "%d.%02d" this keeps sign of -0.xx values
+	dst = fmt_num(dst, val & 0x7F, fmt_sign(val & 0x80, flags), width, flags);
+	*dst++ = '.';
+	return fmt_02u(dst, dec);
+}
+
+char *fmt_cent(char *dst, uint16_t val)
+{
+	dst = fmt_num(dst, val / 100, 0, 0, 0);
+	*dst++ = '.';
+	return fmt_02u(dst, val % 100);
+}
+
+char *fmt_hms(char *dst, uint8_t hour, uint8_t min, uint8_t sec)
+{
+	dst = fmt_02u(dst, hour);
+	*dst++ = ':';
+	dst = fmt_02u(dst, min);
+	*dst++ = ':';
+	return fmt_02u(dst, sec);
+}
+
+char *fmt_pct(char *dst, uint8_t val, uint8_t width)
+{
+	dst = fmt_num(dst, val, 0, width, 0);
+	*dst++ = '%';
+	*dst = '\0';
+	return dst;
+}
+
+char *fmt_hex8(char *dst, uint8_t val)
+{
+	uint8_t nib = val >> 4;
+	dst[0] = nib + (nib < 10 ? '0' : 'A' - 10);
+	nib = val & 0x0F;
+	dst[1] = nib + (nib < 10 ? '0' : 'A' - 10);
+	dst[2] = '\0';
+	return dst + 2;
+}
+
+char *fmt_str(char *dst, const char *str, uint8_t width)
+{
+	for(; *str; width--)
+		*dst++ = *str++;
+	for(; (int8_t)width > 0; width--)
+		*dst++ = ' ';
+	*dst = '\0';
+	return dst;
+}
+
+char *fmt_str_P(char *dst, const char *str, uint8_t width)
+{
+	for(char ch; (ch = pgm_read_byte(str)) != '\0'; str++, width--)
+		*dst++ = ch;
+	for(; (int8_t)width > 0; width--)
+		*dst++ = ' ';
+	*dst = '\0';
+	return dst;
+}
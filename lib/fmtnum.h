@@ -0,0 +1,73 @@
+/* Fast fixed-point numbers formatting for ATmega32
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   Replacement for sprintf_P() on hot paths (display and RDS updates).
+   vfprintf() parses format string from flash and pushes every character
+   through a FILE stream callback, so formatting of "%02d:%02d:%02d"
+   costs a few thousands cycles. These helpers write digits directly
+   into the buffer, two digits values are converted by subtraction
+   without any division at all, so the same HH:MM:SS string takes
+   about a hundred cycles. As long as printf is still used by CLI
+   flash is not saved, but firmware without CLI can drop vfprintf
+   (about 1.5K of flash) completely.
+*/
+#ifndef FMT_NUMBERS_H
+#define FMT_NUMBERS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // to trick VisualAssist
+}
+#endif
+#endif
+
+// formatting flags
+#define FMT_PLUS  0x01 // print '+' for positive values, like "%+d"
+#define FMT_SPACE 0x02 // print ' ' for positive values, like "% d"
+#define FMT_ZERO  0x04 // pad with zeros instead of spaces, like "%02d"
+
+// all functions return pointer to the terminating '\0' of dst
+// so calls can be chained to build a string
+
+// two digits with leading zero, val must be < 100, "%02u"
+char *fmt_02u(char *dst, uint8_t val);
+// "%*u", width includes padding
+char *fmt_u16(char *dst, uint16_t val, uint8_t width, uint8_t flags);
+char *fmt_u32(char *dst, uint32_t val);
+// "%*d", width includes sign
+char *fmt_i16(char *dst, int16_t val, uint8_t width, uint8_t flags);
+// fixed point value with sign in high bit of val (u8val_t, dsens_data_t)
+// "%*d.%02u", width of integer part includes sign
+char *fmt_fixed(char *dst, uint8_t val, uint8_t dec, uint8_t width, uint8_t flags);
+// hundredths: val/100 "." val%100, "%u.%02u" (voltage, frequency)
+char *fmt_cent(char *dst, uint16_t val);
+// "HH:MM:SS"
+char *fmt_hms(char *dst, uint8_t hour, uint8_t min, uint8_t sec);
+// "%*u%%"
+char *fmt_pct(char *dst, uint8_t val, uint8_t width);
+// "%02X"
+char *fmt_hex8(char *dst, uint8_t val);
+// "%-*s", left justified string, padded with spaces up to width
+char *fmt_str(char *dst, const char *str, uint8_t width);
+char *fmt_str_P(char *dst, const char *str, uint8_t width);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,47 @@
+/* EEPROM access for the host build, see hal_host.h
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HAL_HOST_AVR_EEPROM_H
+#define HAL_HOST_AVR_EEPROM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// EEMEM variables are ordinary variables holding EEPROM content,
+// initializers are what .eep file would program
+#define EEMEM
+
+static inline uint8_t eeprom_read_byte(const uint8_t *p) { return *p; }
+static inline uint16_t eeprom_read_word(const uint16_t *p) { return *p; }
+static inline uint32_t eeprom_read_dword(const uint32_t *p) { return *p; }
+static inline void eeprom_read_block(void *dst, const void *src, size_t n) { memcpy(dst, src, n); }
+
+static inline void eeprom_write_byte(uint8_t *p, uint8_t val) { *p = val; }
+static inline void eeprom_write_word(uint16_t *p, uint16_t val) { *p = val; }
+static inline void eeprom_write_dword(uint32_t *p, uint32_t val) { *p = val; }
+static inline void eeprom_write_block(const void *src, void *dst, size_t n) { memcpy(dst, src, n); }
+
+#define eeprom_update_byte  eeprom_write_byte
+#define eeprom_update_word  eeprom_write_word
+#define eeprom_update_dword eeprom_write_dword
+#define eeprom_update_block eeprom_write_block
+
+#define eeprom_is_ready() 1
+#define eeprom_busy_wait() do {} while (0)
+
+#endif
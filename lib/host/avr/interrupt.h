@@ -0,0 +1,36 @@
+/* Interrupts for the host build, see hal_host.h
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HAL_HOST_AVR_INTERRUPT_H
+#define HAL_HOST_AVR_INTERRUPT_H
+
+#include <avr/io.h>
+
+// handlers are ordinary functions named after the vector,
+// they are called by device models or by hal_irq()
+#define ISR(vector, ...) void vector(void); void vector(void)
+#define EMPTY_INTERRUPT(vector) void vector(void); void vector(void) {}
+#define ISR_BLOCK
+#define ISR_NOBLOCK
+#define ISR_NAKED
+
+// pending interrupts are run as soon as they are enabled
+#define sei() hal_sreg(SREG | 0x80)
+#define cli() hal_sreg(SREG & ~0x80)
+#define reti() return
+
+#endif
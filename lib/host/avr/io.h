@@ -0,0 +1,293 @@
+/* ATmega32 I/O registers for the host build, see hal_host.h
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HAL_HOST_AVR_IO_H
+#define HAL_HOST_AVR_IO_H
+
+#include <stdint.h>
+#include "hal_host.h"
+
+#define _BV(bit) (1 << (bit))
+#define bit_is_set(sfr, bit)   ((sfr) & _BV(bit))
+#define bit_is_clear(sfr, bit) (!((sfr) & _BV(bit)))
+#define loop_until_bit_is_set(sfr, bit)   do {} while (bit_is_clear(sfr, bit))
+#define loop_until_bit_is_clear(sfr, bit) do {} while (bit_is_set(sfr, bit))
+
+// plain registers and registers with device models
+#define _SFR_IO8(addr)  (hal_io[addr])
+#define _SFR_IO16(addr) (*(volatile uint16_t *)&hal_io[addr])
+#define _SFR_HAL(addr)  (*hal_reg(addr))
+
+#define TWBR   _SFR_IO8(0x00)
+#define TWSR   _SFR_IO8(0x01)
+#define TWAR   _SFR_IO8(0x02)
+#define TWDR   _SFR_IO8(0x03)
+#define ADCW   _SFR_IO16(0x04)
+#define ADC    _SFR_IO16(0x04)
+#define ADCL   _SFR_IO8(0x04)
+#define ADCH   _SFR_IO8(0x05)
+#define ADCSRA _SFR_HAL(0x06)
+#define ADMUX  _SFR_IO8(0x07)
+#define ACSR   _SFR_IO8(0x08)
+#define UBRRL  _SFR_IO8(0x09)
+#define UCSRB  _SFR_HAL(0x0A)
+#define UCSRA  _SFR_HAL(0x0B)
+#define UDR    _SFR_IO8(0x0C)
+#define SPCR   _SFR_IO8(0x0D)
+#define SPSR   _SFR_HAL(0x0E)
+#define SPDR   _SFR_HAL(0x0F)
+#define PIND   _SFR_IO8(0x10)
+#define DDRD   _SFR_IO8(0x11)
+#define PORTD  _SFR_IO8(0x12)
+#define PINC   _SFR_IO8(0x13)
+#define DDRC   _SFR_IO8(0x14)
+#define PORTC  _SFR_IO8(0x15)
+#define PINB   _SFR_IO8(0x16)
+#define DDRB   _SFR_IO8(0x17)
+#define PORTB  _SFR_IO8(0x18)
+#define PINA   _SFR_IO8(0x19)
+#define DDRA   _SFR_IO8(0x1A)
+#define PORTA  _SFR_IO8(0x1B)
+#define EECR   _SFR_IO8(0x1C)
+#define EEDR   _SFR_IO8(0x1D)
+#define EEAR   _SFR_IO16(0x1E)
+#define UBRRH  _SFR_IO8(0x20)
+#define UCSRC  _SFR_IO8(0x20)
+#define WDTCR  _SFR_IO8(0x21)
+#define ASSR   _SFR_IO8(0x22)
+#define OCR2   _SFR_IO8(0x23)
+#define TCNT2  _SFR_IO8(0x24)
+#define TCCR2  _SFR_IO8(0x25)
+#define ICR1   _SFR_IO16(0x26)
+#define OCR1B  _SFR_IO16(0x28)
+#define OCR1A  _SFR_IO16(0x2A)
+#define TCNT1  _SFR_IO16(0x2C)
+#define TCCR1B _SFR_IO8(0x2E)
+#define TCCR1A _SFR_IO8(0x2F)
+#define SFIOR  _SFR_IO8(0x30)
+#define OSCCAL _SFR_IO8(0x31)
+#define TCNT0  _SFR_IO8(0x32)
+#define TCCR0  _SFR_IO8(0x33)
+#define MCUCSR _SFR_IO8(0x34)
+#define MCUCR  _SFR_IO8(0x35)
+#define TWCR   _SFR_HAL(0x36)
+#define SPMCR  _SFR_IO8(0x37)
+#define TIFR   _SFR_IO8(0x38)
+#define TIMSK  _SFR_IO8(0x39)
+#define GIFR   _SFR_IO8(0x3A)
+#define GICR   _SFR_IO8(0x3B)
+#define OCR0   _SFR_IO8(0x3C)
+#define SP     _SFR_IO16(0x3D)
+#define SPL    _SFR_IO8(0x3D)
+#define SPH    _SFR_IO8(0x3E)
+#define SREG   _SFR_HAL(0x3F)
+
+// port pins
+#define PA0 0
+#define PA1 1
+#define PA2 2
+#define PA3 3
+#define PA4 4
+#define PA5 5
+#define PA6 6
+#define PA7 7
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PB6 6
+#define PB7 7
+#define PC0 0
+#define PC1 1
+#define PC2 2
+#define PC3 3
+#define PC4 4
+#define PC5 5
+#define PC6 6
+#define PC7 7
+#define PD0 0
+#define PD1 1
+#define PD2 2
+#define PD3 3
+#define PD4 4
+#define PD5 5
+#define PD6 6
+#define PD7 7
+
+// TWCR
+#define TWINT 7
+#define TWEA  6
+#define TWSTA 5
+#define TWSTO 4
+#define TWWC  3
+#define TWEN  2
+#define TWIE  0
+// TWSR
+#define TWPS1 1
+#define TWPS0 0
+
+// ADMUX, ADCSRA
+#define REFS1 7
+#define REFS0 6
+#define ADLAR 5
+#define ADEN  7
+#define ADSC  6
+#define ADATE 5
+#define ADIF  4
+#define ADIE  3
+#define ADPS2 2
+#define ADPS1 1
+#define ADPS0 0
+
+// UCSRA, UCSRB, UCSRC
+#define RXC   7
+#define TXC   6
+#define UDRE  5
+#define FE    4
+#define DOR   3
+#define PE    2
+#define U2X   1
+#define MPCM  0
+#define RXCIE 7
+#define TXCIE 6
+#define UDRIE 5
+#define RXEN  4
+#define TXEN  3
+#define UCSZ2 2
+#define RXB8  1
+#define TXB8  0
+#define URSEL 7
+#define UMSEL 6
+#define UPM1  5
+#define UPM0  4
+#define USBS  3
+#define UCSZ1 2
+#define UCSZ0 1
+#define UCPOL 0
+
+// SPCR, SPSR
+#define SPIE 7
+#define SPE  6
+#define DORD 5
+#define MSTR 4
+#define CPOL 3
+#define CPHA 2
+#define SPR1 1
+#define SPR0 0
+#define SPIF 7
+#define WCOL 6
+#define SPI2X 0
+
+// EECR
+#define EERIE 3
+#define EEMWE 2
+#define EEWE  1
+#define EERE  0
+
+// timers
+#define FOC2  7
+#define WGM20 6
+#define COM21 5
+#define COM20 4
+#define WGM21 3
+#define CS22  2
+#define CS21  1
+#define CS20  0
+#define AS2    3
+#define TCN2UB 2
+#define OCR2UB 1
+#define TCR2UB 0
+#define COM1A1 7
+#define COM1A0 6
+#define COM1B1 5
+#define COM1B0 4
+#define FOC1A  3
+#define FOC1B  2
+#define WGM11  1
+#define WGM10  0
+#define ICNC1  7
+#define ICES1  6
+#define WGM13  4
+#define WGM12  3
+#define CS12   2
+#define CS11   1
+#define CS10   0
+#define FOC0  7
+#define WGM00 6
+#define COM01 5
+#define COM00 4
+#define WGM01 3
+#define CS02  2
+#define CS01  1
+#define CS00  0
+#define OCIE2  7
+#define TOIE2  6
+#define TICIE1 5
+#define OCIE1A 4
+#define OCIE1B 3
+#define TOIE1  2
+#define OCIE0  1
+#define TOIE0  0
+#define OCF2  7
+#define TOV2  6
+#define ICF1  5
+#define OCF1A 4
+#define OCF1B 3
+#define TOV1  2
+#define OCF0  1
+#define TOV0  0
+
+// MCUCR, MCUCSR, GICR, GIFR
+#define SE    7
+#define SM2   6
+#define SM1   5
+#define SM0   4
+#define ISC11 3
+#define ISC10 2
+#define ISC01 1
+#define ISC00 0
+#define JTD   7
+#define ISC2  6
+#define JTRF  4
+#define WDRF  3
+#define BORF  2
+#define EXTRF 1
+#define PORF  0
+#define INT1  7
+#define INT0  6
+#define INT2  5
+#define IVSEL 1
+#define IVCE  0
+#define INTF1 7
+#define INTF0 6
+#define INTF2 5
+
+// WDTCR
+#define WDTOE 4
+#define WDE   3
+#define WDP2  2
+#define WDP1  1
+#define WDP0  0
+
+#define RAMSTART 0x60
+#define RAMEND   0x85F
+#define E2END    0x3FF
+#define FLASHEND 0x7FFF
+
+#endif
@@ -0,0 +1,55 @@
+/* Program memory access for the host build, see hal_host.h
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HAL_HOST_AVR_PGMSPACE_H
+#define HAL_HOST_AVR_PGMSPACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+// flash data is ordinary read-only data on the host
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+
+#define pgm_read_byte(addr)  (*(const uint8_t *)(addr))
+// lib/ reads 16 bit pointers with pgm_read_word(), keep pointee type
+#define pgm_read_word(addr)  (*(addr))
+#define pgm_read_dword(addr) (*(addr))
+#define pgm_read_ptr(addr)   (*(void * const *)(addr))
+
+#define memcpy_P     memcpy
+#define memcmp_P     memcmp
+#define strcpy_P     strcpy
+#define strncpy_P    strncpy
+#define strcat_P     strcat
+#define strlen_P     strlen
+#define strcmp_P     strcmp
+#define strncmp_P    strncmp
+#define strcasecmp_P strcasecmp
+#define strchr_P     strchr
+#define strstr_P     strstr
+#define printf_P     printf
+#define sprintf_P    sprintf
+#define snprintf_P   snprintf
+#define fprintf_P    fprintf
+#define fputs_P      fputs
+#define puts_P       puts
+
+#endif
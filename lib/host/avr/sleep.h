@@ -0,0 +1,37 @@
+/* Sleep modes for the host build, see hal_host.h
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HAL_HOST_AVR_SLEEP_H
+#define HAL_HOST_AVR_SLEEP_H
+
+#include "hal_host.h"
+
+#define SLEEP_MODE_IDLE         0
+#define SLEEP_MODE_ADC          1
+#define SLEEP_MODE_PWR_DOWN     2
+#define SLEEP_MODE_PWR_SAVE     3
+#define SLEEP_MODE_STANDBY      6
+#define SLEEP_MODE_EXT_STANDBY  7
+
+#define set_sleep_mode(mode) do {} while (0)
+#define sleep_enable()  do {} while (0)
+#define sleep_disable() do {} while (0)
+// sleeps till the next millisecond tick
+#define sleep_cpu()     hal_delay_us(1000 - hal_usec % 1000)
+#define sleep_mode()    sleep_cpu()
+
+#endif
@@ -0,0 +1,44 @@
+/* Watchdog for the host build, see hal_host.h
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HAL_HOST_AVR_WDT_H
+#define HAL_HOST_AVR_WDT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define WDTO_15MS  0
+#define WDTO_30MS  1
+#define WDTO_60MS  2
+#define WDTO_120MS 3
+#define WDTO_250MS 4
+#define WDTO_500MS 5
+#define WDTO_1S    6
+#define WDTO_2S    7
+
+// firmware enables watchdog only to reset MCU
+static inline void wdt_enable(uint8_t timeout __attribute__((unused)))
+{
+	fprintf(stderr, "watchdog reset\n");
+	abort();
+}
+
+#define wdt_disable() do {} while (0)
+#define wdt_reset()   do {} while (0)
+
+#endif
@@ -0,0 +1,466 @@
+/* Display drivers check on host models of SSD1306 and ILI9225
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+   dispcheck ossd: draws node-like screens with ossd_putlx() and prints
+   SSD1306 framebuffer hash after every step. It is built twice, with and
+   without OSSD_CACHE, and `make check` compares both outputs, so text
+   cache invalidation bugs show up as the first different step.
+
+   dispcheck ili: draws text with ili9225_text() in built-in fonts and in
+   8x16 font converted to BMFONT_ROWS and BMFONT_RLE layouts, compares
+   ILI9225 GRAM with glyph pixels of built-in fonts, exits with 1 on
+   the first difference.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal_host.h"
+#include "pinio.h"
+#include "spi.h"
+#include "bmfont.h"
+#include "ossd_i2c.h"
+#include "ili9225.h"
+
+// SSD1306 model --------------------------------------------------------------
+
+// commands followed by arguments
+static uint8_t ssd_args(uint8_t cmd)
+{
+	switch(cmd) {
+	case 0x21: // column address
+	case 0x22: // page address
+		return 2;
+	case 0x20: // addressing mode
+	case 0x81: // contrast
+	case 0x8D: // charge pump
+	case 0xA8: // multiplex ratio
+	case 0xD3: // display offset
+	case 0xD5: // clock
+	case 0xD9: // pre-charge
+	case 0xDA: // COM pins
+	case 0xDB: // VCOMH
+		return 1;
+	}
+	return 0;
+}
+
+static struct ssd_s {
+	uint8_t fb[8][128];
+	uint8_t mode; // 0 - horizontal, 2 - page
+	uint8_t col, page;
+	uint8_t c0, c1, p0, p1;
+	uint8_t ctrl;   // 0xFF - control byte is next
+	uint8_t cmd[3]; // command with arguments
+	uint8_t ncmd;
+	uint32_t nbytes;
+} ssd;
+
+static uint8_t ssd_start(uint8_t sla)
+{
+	if (sla != (I2C_OSSD | 0))
+		return 1;
+	ssd.ctrl = 0xFF;
+	ssd.ncmd = 0;
+	return 0;
+}
+
+static void ssd_command(uint8_t data)
+{
+	ssd.cmd[ssd.ncmd++] = data;
+	if (ssd.ncmd <= ssd_args(ssd.cmd[0]))
+		return;
+	ssd.ncmd = 0;
+
+	uint8_t cmd = ssd.cmd[0];
+	if (cmd == 0x20) {
+		ssd.mode = ssd.cmd[1] & 0x03;
+		if (ssd.mode == 1) {
+			fprintf(stderr, "ssd1306: vertical mode is not modelled\n");
+			exit(2);
+		}
+	}
+	else if (cmd == 0x21) {
+		ssd.c0 = ssd.col = ssd.cmd[1] & 0x7F;
+		ssd.c1 = ssd.cmd[2] & 0x7F;
+	}
+	else if (cmd == 0x22) {
+		ssd.p0 = ssd.page = ssd.cmd[1] & 0x07;
+		ssd.p1 = ssd.cmd[2] & 0x07;
+	}
+	else {
+		// page and column start are applied in any addressing mode,
+		// ossd_goto() uses them with OSSD_ADDR_MODE_PAGE (0x10) set
+		if (cmd <= 0x0F)
+			ssd.col = (ssd.col & 0xF0) | cmd;
+		else if (cmd <= 0x1F)
+			ssd.col = (ssd.col & 0x0F) | ((cmd & 0x07) << 4);
+		else if ((cmd & 0xF8) == 0xB0)
+			ssd.page = cmd & 0x07;
+	}
+}
+
+static void ssd_data(uint8_t data)
+{
+	ssd.fb[ssd.page][ssd.col] = data;
+	if (ssd.mode == 2) {
+		// page mode wraps within the page
+		ssd.col = (ssd.col + 1) & 0x7F;
+		return;
+	}
+	if (ssd.col++ == ssd.c1) {
+		ssd.col = ssd.c0;
+		if (ssd.page++ == ssd.p1)
+			ssd.page = ssd.p0;
+	}
+}
+
+static uint8_t ssd_write(uint8_t data)
+{
+	ssd.nbytes++;
+	if (ssd.ctrl == 0xFF)
+		ssd.ctrl = data;
+	else if (ssd.ctrl & 0x40)
+		ssd_data(data);
+	else
+		ssd_command(data);
+	return 0;
+}
+
+static uint32_t ssd_hash(void)
+{
+	// FNV-1a
+	uint32_t h = 2166136261u;
+	for(uint8_t p = 0; p < 8; p++) {
+		for(uint8_t c = 0; c < 128; c++)
+			h = (h ^ ssd.fb[p][c]) * 16777619u;
+	}
+	return h;
+}
+
+// ILI9225 model, GRAM address goes left to right, then down ------------------
+
+static ili9225_t ili = { .flags = 0, .cs = PNC3, .rs = PND4, .rst = PNC4, .led = PNB3 };
+
+static struct ili_s {
+	uint16_t gram[ILI9225_LCD_HEIGHT][ILI9225_LCD_WIDTH];
+	uint16_t reg[256];
+	uint16_t idx;   // register index
+	uint16_t word;
+	uint8_t  phase; // high byte was received
+	uint8_t  rs;
+	uint16_t h, v;
+	uint32_t nbytes;
+} gm;
+
+static uint8_t ili_spi(uint8_t data)
+{
+	uint8_t rs = (PORTD & _BV(4)) ? 1 : 0;
+	if (PORTC & _BV(3)) // not selected
+		return 0xFF;
+	gm.nbytes++;
+	if (rs != gm.rs) {
+		gm.rs = rs;
+		gm.phase = 0;
+	}
+	if (!gm.phase) {
+		gm.word = data << 8;
+		gm.phase = 1;
+		return 0;
+	}
+	gm.word |= data;
+	gm.phase = 0;
+
+	if (!rs) {
+		gm.idx = gm.word;
+		return 0;
+	}
+	if (gm.idx != ILI9225_GRAM_DATA_REG) {
+		gm.reg[gm.idx & 0xFF] = gm.word;
+		if (gm.idx == ILI9225_RAM_HADDR)
+			gm.h = gm.word;
+		if (gm.idx == ILI9225_RAM_VADDR)
+			gm.v = gm.word;
+		return 0;
+	}
+
+	if (gm.reg[ILI9225_ENTRY_MODE] != 0x1030) {
+		fprintf(stderr, "ili9225: entry mode %04X is not modelled\n", gm.reg[ILI9225_ENTRY_MODE]);
+		exit(2);
+	}
+	if (gm.h < ILI9225_LCD_WIDTH && gm.v < ILI9225_LCD_HEIGHT)
+		gm.gram[gm.v][gm.h] = gm.word;
+	if (gm.h++ == gm.reg[ILI9225_HORIZONTAL_WINDOW_ADDR1]) {
+		gm.h = gm.reg[ILI9225_HORIZONTAL_WINDOW_ADDR2];
+		if (gm.v++ == gm.reg[ILI9225_VERTICAL_WINDOW_ADDR1])
+			gm.v = gm.reg[ILI9225_VERTICAL_WINDOW_ADDR2];
+	}
+	return 0;
+}
+
+// fonts converted to other layouts -------------------------------------------
+
+// PackBits, as tools/bmfont.py -c makes
+static uint16_t rle_pack(const uint8_t *src, uint8_t len, uint8_t *dst)
+{
+	uint16_t n = 0;
+	for(uint8_t i = 0; i < len;) {
+		uint8_t r = 1;
+		while((i + r) < len && r < 129 && src[i + r] == src[i])
+			r++;
+		if (r >= 2) {
+			dst[n++] = 0x80 | (r - 2);
+			dst[n++] = src[i];
+			i += r;
+			continue;
+		}
+		uint8_t l = 1;
+		while((i + l) < len && l < 128 && !((i + l + 1) < len && src[i + l] == src[i + l + 1]))
+			l++;
+		dst[n++] = l - 1;
+		memcpy(&dst[n], &src[i], l);
+		n += l;
+		i += l;
+	}
+	return n;
+}
+
+static uint8_t user_data[95*(2 + 2*BMFONT_GLYPH_MAX)];
+
+// converts built-in font to the layout, sets it as BMFONT_USER
+static bmfont_t *user_font(uint8_t font, uint8_t flags)
+{
+	static bmfont_t user;
+	bmfont_select(font);
+	user = *bmfont_get();
+	user.font = user_data;
+	user.flags = flags;
+
+	uint8_t glyph[BMFONT_GLYPH_MAX];
+	uint8_t gb = bmfont_glyph_size(&user, flags);
+	uint16_t off = (flags & BMFONT_RLE) ? user.gn*2 : 0;
+	for(uint8_t i = 0; i < user.gn; i++) {
+		bmfont_glyph(bmfont_get(), user.go + i, glyph, flags & BMFONT_ROWS);
+		if (flags & BMFONT_RLE) {
+			user_data[i*2] = off & 0xFF;
+			user_data[i*2 + 1] = off >> 8;
+			off += rle_pack(glyph, gb, &user_data[off]);
+		}
+		else {
+			memcpy(&user_data[off], glyph, gb);
+			off += gb;
+		}
+	}
+	bmfont_set(&user, NULL);
+	bmfont_select(BMFONT_USER);
+	return &user;
+}
+
+// ossd -----------------------------------------------------------------------
+
+static uint16_t ossd_step;
+
+static void ossd_show(void)
+{
+	printf("%4u %08x\n", ossd_step++, ssd_hash());
+}
+
+static void ossd_put(uint8_t line, int8_t x, const char *str, uint8_t atr)
+{
+	ossd_putlx(line, x, str, atr);
+	ossd_show();
+}
+
+static int ossd_check(void)
+{
+	char buf[32];
+	hal_dev.i2c_start = ssd_start;
+	hal_dev.i2c_write = ssd_write;
+	memset(&ssd, 0xAA, sizeof(ssd.fb));
+
+	if (ossd_init(OSSD_UPDOWN) != 0)
+		return 1;
+	ossd_show();
+	bmfont_select(BMFONT_8x16);
+	ossd_put(0, -1, "Node 3", 0);
+
+	// node clock, temperature and Vbat redrawn every second
+	for(uint16_t t = 3590; t < 3660; t++) {
+		bmfont_select(BMFONT_8x16);
+		sprintf(buf, "%02u:%02u:%02u", t/3600, (t/60) % 60, t % 60);
+		ossd_put(2, -1, buf, TEXT_OVERLINE | TEXT_UNDERLINE);
+		sprintf(buf, "T %u.%u", 20 + (t/20) % 3, t % 7);
+		ossd_put(4, 8, buf, TEXT_UNDERLINE);
+		// centred text changes its length
+		sprintf(buf, "Vbat %u.%u%s", 3, (t/15) % 2 ? 5 : 10, (t/25) % 2 ? "V" : "");
+		ossd_put(6, -1, buf, 0);
+
+		// writes overlapping cached lines
+		bmfont_select(BMFONT_6x8);
+		switch(t % 10) {
+		case 1: // second page of 8x16 clock
+			ossd_put(3, 100, "ov", 0);
+			break;
+		case 3: // over the 8x16 T, one page up
+			ossd_put(3, 0, "abcdefghijklmnopqrst", TEXT_REVERSE);
+			break;
+		case 5: // 8x16 text starting on odd line over two cached lines
+			bmfont_select(BMFONT_8x16);
+			ossd_put(5, 0, "Line 5", 0);
+			break;
+		case 7: // long text wraps to the next line, not cached
+			ossd_put(7, 64, "wrapping text 0123456789", TEXT_UNDERLINE);
+			break;
+		case 9: // same text, other attribute and font
+			bmfont_select(BMFONT_8x8);
+			ossd_put(4, 8, buf, 0);
+			ossd_put(4, 8, buf, TEXT_REVERSE);
+			break;
+		}
+		if (t == 3620) {
+			ossd_cls();
+			ossd_show();
+		}
+		if (t == 3640) {
+			ossd_fill_screen(0x81);
+			ossd_show();
+		}
+	}
+
+	// the same with compressed row-major user font
+	user_font(BMFONT_8x16, BMFONT_ROWS | BMFONT_RLE);
+	ossd_put(2, -1, "12:34:56", TEXT_OVERLINE);
+	ossd_put(2, -1, "12:34:57", TEXT_OVERLINE);
+	ossd_put(4, 8, "T 22.5", 0);
+	bmfont_select(BMFONT_8x16);
+	ossd_put(4, 8, "T 22.5", 0);
+	fprintf(stderr, "ossd: %u steps, %u i2c bytes\n", ossd_step, ssd.nbytes);
+	return 0;
+}
+
+// ili ------------------------------------------------------------------------
+
+#define ILI9225_LCD_SIZE (ILI9225_LCD_WIDTH*ILI9225_LCD_HEIGHT)
+
+static uint16_t ref[ILI9225_LCD_HEIGHT][ILI9225_LCD_WIDTH];
+
+// draws str in reference GRAM with glyphs of built-in font
+static void ili_ref(uint8_t font, uint8_t x, uint8_t y, const char *str, uint8_t atr)
+{
+	bmfont_select(font);
+	bmfont_t *pfont = bmfont_get();
+	uint8_t gw = pfont->gw;
+	uint8_t gh = pfont->gh;
+	uint8_t glyph[BMFONT_GLYPH_MAX];
+
+	for(; *str != '\0'; str++, x += gw) {
+		if (!bmfont_glyph(pfont, *str, glyph, BMFONT_PAGES))
+			continue;
+		for(uint8_t r = 0; r < gh; r++) {
+			for(uint8_t n = 0; n < gw; n++) {
+				uint8_t px = (glyph[(r/8)*gw + n] >> (r & 7)) & 0x01;
+				if (atr & TEXT_REVERSE)
+					px ^= 1;
+				if ((atr & TEXT_OVERLINE) && r == 0)
+					px ^= 1;
+				if ((atr & TEXT_UNDERLINE) && r == gh - 1)
+					px ^= 1;
+				if ((x + n) < ILI9225_LCD_WIDTH && (y + r) < ILI9225_LCD_HEIGHT)
+					ref[y + r][x + n] = px ? ili.fcolor : ili.bcolor;
+			}
+		}
+	}
+}
+
+static const struct ili_text_s {
+	uint8_t x, y;
+	const char *str;
+	uint8_t atr;
+} ili_text[] = {
+	{   4,  10, "Hello 12:34", TEXT_UNDERLINE | TEXT_OVERLINE },
+	{   0,  40, "Rev~ \x7F\x80!", TEXT_REVERSE },
+	{ 100, 100, "small {}", TEXT_UNDERLINE },
+	{ 160, 200, "edge", TEXT_OVERLINE | TEXT_REVERSE }
+};
+
+// font to draw with, font of reference glyphs
+static const struct ili_font_s {
+	uint8_t font;
+	uint8_t flags; // user font layout
+	const char *name;
+} ili_font[] = {
+	{ BMFONT_6x8,  0xFF, "6x8" },
+	{ BMFONT_8x8,  0xFF, "8x8" },
+	{ BMFONT_8x16, 0xFF, "8x16" },
+	{ BMFONT_8x16, BMFONT_ROWS, "8x16 rows" },
+	{ BMFONT_8x16, BMFONT_ROWS | BMFONT_RLE, "8x16 rows rle" },
+	{ BMFONT_8x16, BMFONT_PAGES | BMFONT_RLE, "8x16 pages rle" },
+	{ BMFONT_6x8,  BMFONT_ROWS | BMFONT_RLE, "6x8 rows rle" }
+};
+
+static int ili_check(void)
+{
+	hal_dev.spi = ili_spi;
+	spi_init(SPI_CLOCK_DIV4);
+	ili9225_init(&ili);
+	ili.fcolor = RGB16_WHITE;
+	ili.bcolor = RGB16_BLUE;
+
+	uint16_t *gram = &gm.gram[0][0];
+	uint16_t *pref = &ref[0][0];
+	int ret = 0;
+	for(uint8_t f = 0; f < sizeof(ili_font)/sizeof(ili_font[0]); f++) {
+		const struct ili_font_s *pf = &ili_font[f];
+		for(uint8_t i = 0; i < sizeof(ili_text)/sizeof(ili_text[0]); i++) {
+			const struct ili_text_s *pt = &ili_text[i];
+			for(uint16_t n = 0; n < ILI9225_LCD_SIZE; n++)
+				gram[n] = 0x5555 + n;
+			memcpy(ref, gm.gram, sizeof(ref));
+			ili_ref(pf->font, pt->x, pt->y, pt->str, pt->atr);
+
+			if (pf->flags == 0xFF)
+				bmfont_select(pf->font);
+			else
+				user_font(pf->font, pf->flags);
+			ili9225_text(&ili, pt->x, pt->y, pt->str, pt->atr);
+
+			for(uint16_t n = 0; n < ILI9225_LCD_SIZE; n++) {
+				if (gram[n] != pref[n]) {
+					printf("ili: %s '%s' x %u y %u: %04X instead of %04X\n", pf->name, pt->str,
+						n % ILI9225_LCD_WIDTH, n / ILI9225_LCD_WIDTH, gram[n], pref[n]);
+					ret = 1;
+					break;
+				}
+			}
+		}
+	}
+	printf("ili: %s, %u spi bytes\n", ret ? "FAILED" : "ok", gm.nbytes);
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc == 2 && strcmp(argv[1], "ossd") == 0)
+		return ossd_check();
+	if (argc == 2 && strcmp(argv[1], "ili") == 0)
+		return ili_check();
+	fprintf(stderr, "usage: %s ossd|ili\n", argv[0]);
+	return 2;
+}
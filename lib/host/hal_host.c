@@ -0,0 +1,242 @@
+/* Host (Linux) backend for avr-libc API used by lib/
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <util/twi.h>
+#include <avr/interrupt.h>
+
+#include "hal_host.h"
+
+// reserved TWCR bit, marks TWI command as processed by the model
+#define HAL_TWI_DONE 0x02
+#define HAL_SREG_I   0x80
+#define HAL_IRQ_LOOP 1000 // max handler calls per dispatch
+
+// register addresses, avr/io.h macros would call hal_reg()
+#define IO_TWSR   0x01
+#define IO_TWDR   0x03
+#define IO_ADCL   0x04
+#define IO_ADCSRA 0x06
+#define IO_ADMUX  0x07
+#define IO_UCSRB  0x0A
+#define IO_UCSRA  0x0B
+#define IO_UDR    0x0C
+#define IO_SPCR   0x0D
+#define IO_SPSR   0x0E
+#define IO_SPDR   0x0F
+#define IO_TWCR   0x36
+#define IO_TIMSK  0x39
+#define IO_SREG   0x3F
+
+// I2C master states
+#define TWI_IDLE 0
+#define TWI_SLA  1 // START sent, SLA+R/W is next
+#define TWI_MT   2
+#define TWI_MR   3
+
+volatile uint8_t hal_io[HAL_IO_SIZE];
+uint32_t hal_usec;
+hal_dev_t hal_dev;
+
+// avr-libc heap pointers used by free_mem()
+int __heap_start, *__brkval;
+
+// handlers are linked in only if lib/ modules using them are
+void TIMER1_COMPA_vect(void) __attribute__((weak));
+void TIMER2_COMP_vect(void) __attribute__((weak));
+void TWI_vect(void) __attribute__((weak));
+void USART_RXC_vect(void) __attribute__((weak));
+void USART_UDRE_vect(void) __attribute__((weak));
+
+static uint8_t  in_isr;
+static uint8_t  spi_busy; // SPDR was accessed, SPSR will complete transfer
+static uint8_t  twi_state;
+static uint32_t ms_usec;  // virtual time of the next timer ticks
+static uint32_t rtc_usec;
+
+static void hal_spi(void)
+{
+	if (!spi_busy || !(hal_io[IO_SPCR] & _BV(SPE)))
+		return;
+	spi_busy = 0;
+	uint8_t data = hal_io[IO_SPDR];
+	hal_io[IO_SPDR] = hal_dev.spi ? hal_dev.spi(data) : 0xFF;
+	hal_io[IO_SPSR] |= _BV(SPIF);
+}
+
+static void hal_twi(void)
+{
+	uint8_t cr = hal_io[IO_TWCR];
+	if ((cr & (_BV(TWINT) | _BV(TWEN) | HAL_TWI_DONE)) != (_BV(TWINT) | _BV(TWEN)))
+		return;
+
+	if (cr & _BV(TWSTO)) {
+		// TWINT is not set after STOP
+		if ((twi_state != TWI_IDLE) && hal_dev.i2c_stop)
+			hal_dev.i2c_stop();
+		twi_state = TWI_IDLE;
+		hal_io[IO_TWCR] = cr & ~(_BV(TWSTO) | _BV(TWINT));
+		hal_io[IO_TWSR] = (hal_io[IO_TWSR] & 0x03) | TW_NO_INFO;
+		return;
+	}
+
+	uint8_t sr, nack;
+	if (cr & _BV(TWSTA)) {
+		sr = (twi_state == TWI_IDLE) ? TW_START : TW_REP_START;
+		twi_state = TWI_SLA;
+	}
+	else if (twi_state == TWI_SLA) {
+		uint8_t sla = hal_io[IO_TWDR];
+		nack = hal_dev.i2c_start ? hal_dev.i2c_start(sla) : 0;
+		if (sla & TW_READ) {
+			sr = nack ? TW_MR_SLA_NACK : TW_MR_SLA_ACK;
+			twi_state = TWI_MR;
+		}
+		else {
+			sr = nack ? TW_MT_SLA_NACK : TW_MT_SLA_ACK;
+			twi_state = TWI_MT;
+		}
+	}
+	else if (twi_state == TWI_MT) {
+		nack = hal_dev.i2c_write ? hal_dev.i2c_write(hal_io[IO_TWDR]) : 0;
+		sr = nack ? TW_MT_DATA_NACK : TW_MT_DATA_ACK;
+	}
+	else if (twi_state == TWI_MR) {
+		uint8_t ack = cr & _BV(TWEA);
+		hal_io[IO_TWDR] = hal_dev.i2c_read ? hal_dev.i2c_read(ack) : 0xFF;
+		sr = ack ? TW_MR_DATA_ACK : TW_MR_DATA_NACK;
+	}
+	else
+		sr = TW_BUS_ERROR;
+
+	hal_io[IO_TWSR] = (hal_io[IO_TWSR] & 0x03) | sr;
+	hal_io[IO_TWCR] = cr | HAL_TWI_DONE;
+}
+
+static void hal_adc(void)
+{
+	uint8_t sra = hal_io[IO_ADCSRA];
+	if ((sra & (_BV(ADEN) | _BV(ADSC))) != (_BV(ADEN) | _BV(ADSC)))
+		return;
+	uint16_t val = hal_dev.adc ? hal_dev.adc(hal_io[IO_ADMUX] & 0x07) : 0;
+	*(volatile uint16_t *)&hal_io[IO_ADCL] = val & 0x3FF;
+	hal_io[IO_ADCSRA] = (sra & ~_BV(ADSC)) | _BV(ADIF);
+}
+
+static inline void hal_call(void (*vect)(void))
+{
+	in_isr = 1;
+	hal_io[IO_SREG] &= ~HAL_SREG_I;
+	vect();
+	hal_io[IO_SREG] |= HAL_SREG_I;
+	in_isr = 0;
+}
+
+// level triggered interrupts of TWI and UART
+static void hal_dispatch(void)
+{
+	if (in_isr || !(hal_io[IO_SREG] & HAL_SREG_I))
+		return;
+
+	for(uint16_t i = 0; i < HAL_IRQ_LOOP; i++) {
+		hal_twi();
+		uint8_t cr = hal_io[IO_TWCR];
+		if (TWI_vect && (cr & _BV(TWIE)) && (cr & _BV(TWINT)) && (cr & HAL_TWI_DONE)) {
+			hal_call(TWI_vect);
+			continue;
+		}
+		if (USART_UDRE_vect && (hal_io[IO_UCSRB] & _BV(UDRIE))) {
+			hal_call(USART_UDRE_vect);
+			// the handler either wrote UDR or disabled UDRIE
+			if (hal_io[IO_UCSRB] & _BV(UDRIE)) {
+				if (hal_dev.uart_tx)
+					hal_dev.uart_tx(hal_io[IO_UDR]);
+				else
+					putchar(hal_io[IO_UDR]);
+			}
+			continue;
+		}
+		break;
+	}
+}
+
+void hal_delay_us(uint32_t usec)
+{
+	hal_usec += usec;
+	if (in_isr)
+		return;
+
+	// timers run only with interrupts enabled, as the handlers
+	while((int32_t)(hal_usec - ms_usec) >= 0) {
+		ms_usec += 1000;
+		if (TIMER1_COMPA_vect && (hal_io[IO_TIMSK] & _BV(OCIE1A)))
+			hal_irq(TIMER1_COMPA_vect);
+	}
+	while((int32_t)(hal_usec - rtc_usec) >= 0) {
+		rtc_usec += 1000000;
+		if (TIMER2_COMP_vect && (hal_io[IO_TIMSK] & _BV(OCIE2)))
+			hal_irq(TIMER2_COMP_vect);
+	}
+	hal_dispatch();
+}
+
+volatile uint8_t *hal_reg(uint8_t addr)
+{
+	switch(addr) {
+	case IO_SPSR:
+		hal_spi();
+		break;
+	case IO_SPDR:
+		// SPIF is cleared by SPDR access, new transfer is started
+		hal_io[IO_SPSR] &= ~_BV(SPIF);
+		spi_busy = 1;
+		break;
+	case IO_TWCR:
+		hal_twi();
+		break;
+	case IO_ADCSRA:
+		hal_adc();
+		break;
+	case IO_UCSRA:
+		// transmitter is always ready
+		hal_io[IO_UCSRA] |= _BV(UDRE) | _BV(TXC);
+		break;
+	}
+	hal_delay_us(HAL_IO_USEC);
+	return &hal_io[addr];
+}
+
+void hal_sreg(uint8_t sreg)
+{
+	hal_io[IO_SREG] = sreg;
+	hal_dispatch();
+}
+
+void hal_irq(void (*vect)(void))
+{
+	if (in_isr || !(hal_io[IO_SREG] & HAL_SREG_I))
+		return;
+	hal_call(vect);
+}
+
+void hal_uart_rx(uint8_t data)
+{
+	hal_io[IO_UDR] = data;
+	hal_io[IO_UCSRA] |= _BV(RXC);
+	if (USART_RXC_vect && (hal_io[IO_UCSRB] & _BV(RXCIE)))
+		hal_irq(USART_RXC_vect);
+}
@@ -0,0 +1,80 @@
+/* Host (Linux) backend for avr-libc API used by lib/
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HAL_HOST_H
+#define HAL_HOST_H
+
+/**
+   avr-libc headers are the hardware abstraction layer: on AVR they are
+   used as is, for the host build lib/host is first in the include path
+   and provides the same API backed by this module:
+
+   - I/O registers are bytes in hal_io[], so port pointer arithmetic works
+   - registers polled in busy-wait loops (SPSR, SPDR, TWCR, ADCSRA, UCSRA,
+     UCSRB, SREG) are accessed through hal_reg() which runs device models
+     and advances virtual time by HAL_IO_USEC
+   - PROGMEM and EEMEM data are ordinary variables
+   - _delay_*() advance virtual time, timer 1 and timer 2 compare
+     interrupts run every 1 ms and 1 s of virtual time
+*/
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // to trick VisualAssist
+}
+#endif
+#endif
+
+#define HAL_IO_SIZE 0x40 // ATmega32 I/O space
+#define HAL_IO_USEC 1    // virtual time per hal_reg() access
+
+// device models, NULL callbacks: SPI and I2C reads return 0xFF,
+// all I2C addresses and data bytes are ACKed, UART output goes to stdout
+typedef struct hal_dev_s {
+	uint8_t  (*spi)(uint8_t data);     // returns received byte
+	uint8_t  (*i2c_start)(uint8_t sla); // SLA+R/W, returns 0 for ACK
+	uint8_t  (*i2c_write)(uint8_t data); // returns 0 for ACK
+	uint8_t  (*i2c_read)(uint8_t ack);
+	void     (*i2c_stop)(void);
+	uint16_t (*adc)(uint8_t channel);
+	void     (*uart_tx)(uint8_t data);
+} hal_dev_t;
+
+extern hal_dev_t hal_dev;
+extern volatile uint8_t hal_io[HAL_IO_SIZE];
+extern uint32_t hal_usec; // virtual time since start
+
+volatile uint8_t *hal_reg(uint8_t addr);
+
+// advances virtual time, runs due timer interrupts
+void hal_delay_us(uint32_t usec);
+
+// sets SREG, runs pending interrupts if they are enabled
+void hal_sreg(uint8_t sreg);
+
+// runs interrupt handler if interrupts are enabled
+void hal_irq(void (*vect)(void));
+
+// feeds received byte to UART RX interrupt
+void hal_uart_rx(uint8_t data);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
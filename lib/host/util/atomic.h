@@ -0,0 +1,52 @@
+/* Atomic blocks for the host build, see hal_host.h
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HAL_HOST_UTIL_ATOMIC_H
+#define HAL_HOST_UTIL_ATOMIC_H
+
+#include <avr/interrupt.h>
+
+// same implementation as in avr-libc, SREG is restored or
+// interrupts enabled by cleanup function on block exit
+static inline uint8_t __hal_atomic_enter(void)
+{
+	uint8_t sreg = SREG;
+	cli();
+	return sreg;
+}
+
+static inline void __hal_exit_ATOMIC_RESTORESTATE(const uint8_t *sreg) { hal_sreg(*sreg); }
+static inline void __hal_exit_ATOMIC_FORCEON(const uint8_t *sreg __attribute__((unused))) { sei(); }
+static inline void __hal_exit_NONATOMIC_RESTORESTATE(const uint8_t *sreg) { hal_sreg(*sreg); }
+static inline void __hal_exit_NONATOMIC_FORCEOFF(const uint8_t *sreg __attribute__((unused))) { cli(); }
+
+static inline uint8_t __hal_nonatomic_enter(void)
+{
+	uint8_t sreg = SREG;
+	sei();
+	return sreg;
+}
+
+#define ATOMIC_BLOCK(type) \
+	for(uint8_t __sreg __attribute__((__cleanup__(__hal_exit_##type))) = __hal_atomic_enter(), \
+		__todo = 1; __todo; __todo = 0)
+
+#define NONATOMIC_BLOCK(type) \
+	for(uint8_t __sreg __attribute__((__cleanup__(__hal_exit_##type))) = __hal_nonatomic_enter(), \
+		__todo = 1; __todo; __todo = 0)
+
+#endif
@@ -0,0 +1,27 @@
+/* Busy-wait delays for the host build, see hal_host.h
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HAL_HOST_UTIL_DELAY_H
+#define HAL_HOST_UTIL_DELAY_H
+
+#include "hal_host.h"
+
+// delays advance virtual time only
+static inline void _delay_us(double us) { hal_delay_us((uint32_t)us); }
+static inline void _delay_ms(double ms) { hal_delay_us((uint32_t)(ms * 1000)); }
+
+#endif
@@ -177,6 +177,73 @@ extern unsigned char i2c_readNak(void);
 extern unsigned char i2c_read(unsigned char ack);
 #define i2c_read(ack)  (ack) ? i2c_readAck() : i2c_readNak(); 
 
+/** i2c_set_speed() address for the default bus speed */
+#define I2C_ANY 0
+
+#define I2C_SPEED_STD  100 /**< Standard-mode, kHz */
+#define I2C_SPEED_FAST 400 /**< Fast-mode, kHz */
+
+/**
+ @brief Set SCL clock used for the device, hardware TWI only
+
+ Clock is switched before start condition, so slow devices can share
+ the bus with fast ones. Not to be called between i2c_start() and i2c_stop()
+ @param    addr device address or I2C_ANY to set default clock
+ @param    khz  clock in kHz, I2C_SPEED_STD or I2C_SPEED_FAST
+ @retval   0 ok
+ @retval   1 no free device slots
+ */
+extern unsigned char i2c_set_speed(unsigned char addr, uint16_t khz);
+
+/** @brief SCL clock of the device in kHz */
+extern uint16_t i2c_get_speed(unsigned char addr);
+
+/** Interrupt driven transactions, hardware TWI only.
+    Synchronous functions above take the bus when all queued
+    transactions are done, queued ones wait for i2c_stop() */
+
+#define I2C_URGENT 0x01 /**< i2c_submit() flag, put in front of the queue */
+
+#define I2C_XFER_IDLE   0
+#define I2C_XFER_QUEUED 1
+#define I2C_XFER_DONE   2
+#define I2C_XFER_ERROR  3
+
+struct i2c_xfer_s;
+/** completion callback, called from TWI interrupt */
+typedef void i2c_done_cb(struct i2c_xfer_s *xfer);
+
+typedef struct i2c_xfer_s {
+	struct i2c_xfer_s *next;
+	unsigned char addr;  /**< device address without R/W bit */
+	unsigned char wlen;  /**< bytes to write, then repeated start if rlen */
+	unsigned char rlen;  /**< bytes to read */
+	unsigned char retry; /**< restarts if address is not acknowledged */
+	const unsigned char *wbuf;
+	unsigned char *rbuf;
+	i2c_done_cb *done;   /**< optional */
+	volatile unsigned char status;
+} i2c_xfer_t;
+
+/**
+ @brief Queue transaction, can be called from interrupt handlers
+
+ Transaction and buffers must stay valid until status is not I2C_XFER_QUEUED
+ @param    xfer  transaction
+ @param    flags I2C_URGENT or 0
+ */
+extern void i2c_submit(i2c_xfer_t *xfer, unsigned char flags);
+
+/**
+ @brief Wait for queued transaction, not to be used between i2c_start() and i2c_stop()
+ @retval   0 transaction completed
+ @retval   1 device did not respond
+ */
+extern unsigned char i2c_wait(i2c_xfer_t *xfer);
+
+/** @brief Queue transaction and wait for it */
+extern unsigned char i2c_xfer(i2c_xfer_t *xfer);
+
 #ifdef __cplusplus
 }
 #endif
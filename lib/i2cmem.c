@@ -14,6 +14,7 @@
     You should have received a copy of the GNU General Public License
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
+#include <string.h>
 
 #include "timer.h"
 #include "i2cmem.h"
@@ -24,6 +25,9 @@
 #define I2C_MEM_WRITE_CYCLE   10
 #define I2C_MEM_WRITE_CYCLE_B 5
 #define I2C_MEM_TIMEOUT I2C_MEM_WRITE_CYCLE_B
+// address NACKs while previous write cycle is in progress,
+// about 35us each at 400kHz, so covers 5ms write cycle
+#define I2C_MEM_RETRY 0xFF
 
 static i2cmem_idle_callback *pidle;
 
@@ -116,3 +120,34 @@ int8_t i2cmem_write_data(uint16_t addr, void *src, uint8_t len)
 
 	return 0;
 }
+
+int8_t i2cmem_wait(i2cmem_xfer_t *mx)
+{
+	while(mx->xfer.status == I2C_XFER_QUEUED) {
+		if (pidle)
+			pidle();
+	}
+	return (mx->xfer.status == I2C_XFER_ERROR) ? -1 : 0;
+}
+
+int8_t i2cmem_write_async(i2cmem_xfer_t *mx, uint16_t addr, const void *src, uint8_t len)
+{
+	// page write wraps around the page, so split writes are synchronous
+	uint8_t offset = addr & (I2C_MEM_PAGE_SIZE - 1);
+	if (len > I2C_MEM_ASYNC_LEN || (offset + len) > I2C_MEM_PAGE_SIZE)
+		return i2cmem_write_data(addr, (void *)src, len);
+
+	i2cmem_wait(mx);
+	mx->buf[0] = addr >> 8;
+	mx->buf[1] = addr;
+	memcpy(&mx->buf[2], src, len);
+	mx->xfer.addr = I2C_MEM;
+	mx->xfer.wbuf = mx->buf;
+	mx->xfer.wlen = 2 + len;
+	mx->xfer.rlen = 0;
+	mx->xfer.retry = I2C_MEM_RETRY;
+	mx->xfer.done = NULL;
+	i2c_submit(&mx->xfer, 0);
+
+	return 0;
+}
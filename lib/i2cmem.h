@@ -20,6 +20,8 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include "i2cmaster.h"
+
 #ifdef __cplusplus
 extern "C" {
 #if 0 // to trick Visual Assist
@@ -49,6 +51,21 @@ int8_t i2cmem_write_byte(uint16_t addr, uint8_t data);
 int8_t i2cmem_write_data(uint16_t addr, void *src, uint8_t len);
 int8_t i2cmem_write_page(uint16_t page, uint8_t offset, void *src, int8_t len);
 
+// interrupt driven write of a short record, hardware TWI only
+#ifndef I2C_MEM_ASYNC_LEN
+#define I2C_MEM_ASYNC_LEN 8
+#endif
+
+typedef struct i2cmem_xfer_s {
+	i2c_xfer_t xfer;
+	uint8_t buf[2 + I2C_MEM_ASYNC_LEN]; // address + data
+} i2cmem_xfer_t;
+
+// returns as soon as data is queued, mx can be reused after i2cmem_wait()
+int8_t i2cmem_write_async(i2cmem_xfer_t *mx, uint16_t addr, const void *src, uint8_t len);
+// waits for queued write, -1 if memory did not respond
+int8_t i2cmem_wait(i2cmem_xfer_t *mx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -271,42 +271,44 @@ void ili9225_text(ili9225_t *ili, uint8_t x, uint8_t y, const char *str, uint8_t
 	bmfont_t *pfont = bmfont_get();
 	uint8_t gw = pfont->gw;
 	uint8_t gh = pfont->gh;
-	uint8_t go = pfont->go;
-	uint8_t gb = gw*(gh / 8); // bytes per glyph
-	uint8_t glines = gh / 8;  // lines per glyph
-	const uint8_t *font = pfont->font;
+	uint8_t rows = pfont->flags & BMFONT_ROWS;
+	uint8_t rb = (gw + 7) / 8; // bytes per row in BMFONT_ROWS layout
+	uint8_t glyph[BMFONT_GLYPH_MAX];
 	uint16_t color[2];
 	color[0] = ili->bcolor;
 	color[1] = ili->fcolor;
 
-	uint8_t rev = 0;
-	if (atr & TEXT_REVERSE) rev = ~rev;
-	uint8_t over = 0;
-	if (atr & TEXT_OVERLINE)
-		over = 0x01;
-	uint8_t under = 0;
-	if (atr & TEXT_UNDERLINE)
-		under = 0x80;
+	uint8_t rev = (atr & TEXT_REVERSE) ? 1 : 0;
+	uint8_t over = (atr & TEXT_OVERLINE) ? 1 : 0;
+	uint8_t under = (atr & TEXT_UNDERLINE) ? 1 : 0;
 
+	// one window per glyph, GRAM address goes left to right, then down,
+	// so glyph is sent row by row in its own layout, no conversion
 	for(; *str != '\0'; str++, x += gw) {
-		uint16_t idx = (*str - go) * gb;
-		for(uint8_t l = 0; l < glines; l++) {
-			for(uint8_t n = 0; n < gw; n++) {
-				uint8_t d = pgm_read_byte(&font[idx+n +l*gw]);
-				d ^= rev;
-				if (l == (glines - 1))
-					d ^= under;
-				if (l == 0)
-					d ^= over;
-				ili_set_wndow(ili, x+n, y+8*l, x+n, y+8+8*l);
-				ili_spi_select(ili);
-				ili_write_mode(ili, ILI_WRDATA);
-				for(uint8_t i = 0; i < 8; i++) {
-					spi_write_word(color[d & 0x01]);
-					d >>= 1;
-				}
+		if (!bmfont_glyph(pfont, *str, glyph, rows))
+			continue;
+		ili_set_wndow(ili, x, y, x + gw - 1, y + gh - 1);
+		ili_spi_select(ili);
+		ili_write_mode(ili, ILI_WRDATA);
+		for(uint8_t r = 0; r < gh; r++) {
+			uint8_t line = rev;
+			if (r == 0)
+				line ^= over;
+			if (r == gh - 1)
+				line ^= under;
+			if (rows) {
+				const uint8_t *prow = &glyph[r*rb];
+				for(uint8_t n = 0; n < gw; n++)
+					spi_write_word(color[((prow[n/8] >> (n & 7)) & 0x01) ^ line]);
+			}
+			else {
+				const uint8_t *ppage = &glyph[(r/8)*gw];
+				uint8_t shift = r & 7;
+				for(uint8_t n = 0; n < gw; n++)
+					spi_write_word(color[((ppage[n] >> shift) & 0x01) ^ line]);
 			}
 		}
+		ili_spi_unselect(ili);
 	}
 
 	ili_set_wndow(ili, 0, 0, ILI9225_LCD_WIDTH, ILI9225_LCD_HEIGHT);
@@ -18,61 +18,96 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <stdio.h>
+#include <string.h>
 #include <avr/io.h>
 #include <util/atomic.h>
+#include <avr/interrupt.h>
 #include <avr/pgmspace.h>
 
 #include "rds.h"
+#include "mmrio.h"
+#include "timer.h"
 #include "ns741.h"
 #include "i2cmaster.h"
 
 // I2C address of MMR-70
 #define I2C_MMR70 ((0x66 << 1) | I2C_WRITE) // We do not read MMR-70
+// NS741 is not rated for Fast-mode, keep it on Standard-mode
+// while other devices on the bus run at 400kHz
+#define NS741_SCL_KHZ I2C_SPEED_STD
 
 #define NS741_DEFAULT_F 9700 // default F=97.00MHz
 
 // Calculates value of P for 0A/0B registers
 #define NS741_FREQ(F) ((uint16_t)((uint32_t)F*10000ULL/8192ULL))
 
-// Program Service name
-static char ps_name[8];
-// Radiotext message
-static uint8_t text_len = 64;
-//                          "----------------------------64----------------------------------"
-static char radiotext[64] = "MMR-70 as Temperature and Humidity sensor station               ";
-
 uint8_t rds_register[4] = {0x03, 0x05, 0x05, 0x05};
 
-static uint8_t group_index = 0; // group to be transmitted
-static uint8_t block_index = 0; // block index within the group
+#define RDS_MAX_GROUPS 20 // 4 groups - Program Service name, up to 16 - Radiotext
+#define RDS_PS_GROUPS   4
+
+// Precompiled RDS cycle: 0A groups with Program Service name
+// followed by 2A groups with Radiotext, blocks B, C and D.
+// Block A is always PI, A/B flag is added to 2A groups on transmission
+typedef struct rds_table_s {
+	uint8_t  ngroups;
+	uint16_t blk[RDS_MAX_GROUPS][3];
+} rds_table_t;
+
+// front table is transmitted, back one is updated by ns741_rds_set_*()
+// and swapped at the group boundary, so groups are never mixed
+static rds_table_t rds_tab[2];
+static volatile uint8_t rds_front; // table being transmitted
+static volatile uint8_t rds_swap;  // back table is ready to be swapped
+static volatile uint8_t rds_flip;  // toggle A/B flag at the next swap
+static uint8_t rds_pend; // back table differs from the front one
+
+// groups changed in the back table are sent out of the cycle order
+// right after the swap, so receivers get updated text in a few groups
+static uint32_t rds_dirty_next; // changed in the back table
+static uint32_t rds_dirty;      // to be sent before the next cycle group
+
+// 4A Clock-Time group, blocks B, C and D, sent once out of the cycle
+static uint16_t rds_ct[3];
+static volatile uint8_t rds_ct_req;
 
-// RDS 2A Group containing Radiotext chars
 // It is better not to use CC of your country
 // to avoid collision with any local radio stations
-static uint16_t rds_text[4] =
-{
-	RDS_PI(RDS_RUSSIA,CAC_LOCAL,0),
-	RDS_GT(2,0) | RDS_PTY(PTY_WEATHER),
-	0, 0
-};
+static uint16_t rds_pi = RDS_PI(RDS_RUSSIA,CAC_LOCAL,0);
+static uint16_t rds_pty = RDS_PTY(PTY_WEATHER);
+// E0 - No AF exists, CD - Filler code, see Table 11 of RBDS Standard
+static uint16_t rds_af = 0xE0CD;
+static uint16_t rds_ab; // Radiotext A/B flag
+
+static uint16_t rds_grp[4]; // group being transmitted
+static uint8_t rds_grp_idx; // its index, RDS_MAX_GROUPS for CT group
+static uint8_t rds_grp_set; // rds_grp is ready, not changed on retries
+static uint8_t group_index = 0; // cycle group to be transmitted
+static uint8_t block_index = 0; // block index within the group
 
-// RDS 0B Group containing Program Service name
-// It is better not to use CC of your country
-// to avoid collision with any local radio stations
-static uint16_t rds_ps[4] =
-{
-	RDS_PI(RDS_RUSSIA,CAC_LOCAL,0),
-	RDS_GT(0,0) | RDS_PTY(PTY_WEATHER) | RDS_MS,
-	0xE0CD, // E0 - No AF exists, CD - Filler code, see Table 11 of RBDS Standard
-	0
+static void rds_done(i2c_xfer_t *xfer);
+
+// RDS block is queued from INT0 handler as interrupt driven TWI write
+static uint8_t rds_data[3]; // register, MSB, LSB
+static i2c_xfer_t rds_xfer = {
+	.addr = I2C_MMR70,
+	.wbuf = rds_data,
+	.wlen = sizeof(rds_data),
+	.done = rds_done
 };
+static volatile uint8_t rds_req;  // NS741 requested next block
+static volatile uint8_t rds_busy; // block transfer in progress
+static volatile uint8_t rds_ts;   // mill8() of the last completed transfer
 
-#define RDS_MAX_GROUPS 20 // 4 groups - Program Service name, up to 16 - Radiotext
-#define RDS_MAX_BLOCKS (RDS_MAX_GROUPS << 2)
+// restart feeder if RDSINT is low and nothing was sent for a while,
+// block period is about 22 msec
+#define RDS_TIMEOUT 50
 
-// set to 0 to print groups
-static uint8_t rds_debug = RDS_MAX_BLOCKS;
-static uint8_t rds_debug_max = RDS_MAX_BLOCKS;
+// 0x80 to print the next cycle, or number of groups left to print
+static volatile uint8_t rds_debug;
+// copy of the last transmitted group to be printed from ns741_rds_poll()
+static uint16_t rds_dbg[4];
+static volatile uint8_t rds_dbg_group = 0xFF;
 
 // I2C wrappers
 // Send 8 bit
@@ -84,16 +119,6 @@ static void i2c_send_byte(uint8_t addr, uint8_t data)
 	i2c_stop();
 }
 
-// Send 16 bit, MSB first
-static void i2c_send_word(uint8_t addr, uint8_t *data)
-{
-	i2c_start(I2C_MMR70);
-	i2c_write(addr);
-	i2c_write(data[1]);
-	i2c_write(data[0]);
-	i2c_stop();
-}
-
 // Send stream of bytes
 static void i2c_send_data(uint8_t addr, const void *data, uint8_t len)
 {
@@ -138,8 +163,10 @@ static uint8_t ns741_reg[] =
 int ns741_init(void)
 {
 	// make sure that I2C is initialized before calling ns741_init()
+	i2c_set_speed(I2C_MMR70, NS741_SCL_KHZ);
 	// reset registers to default values
 	i2c_send_data(0x00, ns741_reg, sizeof(ns741_reg));
+	ns741_rds_set_radiotext("MMR-70 as Temperature and Humidity sensor station");
 
 	return 0;
 }
@@ -301,47 +328,123 @@ void ns741_rds_cp(uint8_t cp)
 	return;
 }
 
+// Start update of the back table. If it was not swapped yet
+// keep updating it, otherwise start from a copy of the front one
+static rds_table_t *rds_begin(void)
+{
+	uint8_t pending, front;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		pending = rds_swap;
+		rds_swap = 0;
+		front = rds_front;
+	}
+
+	rds_table_t *back = &rds_tab[front ^ 1];
+	if (!pending)
+		memcpy(back, &rds_tab[front], sizeof(rds_table_t));
+	rds_pend = pending;
+	return back;
+}
+
+// dirty - mask of changed groups, table is not swapped if nothing changed
+static void rds_commit(uint32_t dirty)
+{
+	rds_dirty_next |= dirty;
+	if (dirty)
+		rds_pend = 1;
+	if (rds_pend)
+		rds_swap = 1;
+}
+
+// update group in the back table, returns mask of the group if changed
+static uint32_t rds_update(rds_table_t *tab, uint8_t g, uint16_t b, uint16_t c, uint16_t d)
+{
+	uint16_t *blk = tab->blk[g];
+	if ((g < tab->ngroups) && (blk[0] == b) && (blk[1] == c) && (blk[2] == d))
+		return 0;
+	blk[0] = b;
+	blk[1] = c;
+	blk[2] = d;
+	return 1ul << g;
+}
+
+static inline uint16_t rds_chars(uint8_t c0, uint8_t c1)
+{
+	return ((uint16_t)c0 << 8) | c1;
+}
+
+// text - up to 64 characters, shorter text is terminated with '\r'
+// and only groups containing text are transmitted
 void ns741_rds_set_radiotext(const char *text)
 {
-	uint8_t i;
-
-	// first copy text to our buffer
-	for (i = 0; *text && (i < 64); i++, text++)
-		radiotext[i] = *text;
-	text_len = i;
-	if (i < 64) {
-		text_len++;
-		radiotext[i++] = '\r';
-		// pad buffer with spaces
-		for (; i < 64; i++)
-			radiotext[i] = ' ';
+	rds_table_t *tab = rds_begin();
+	uint32_t dirty = 0;
+	uint8_t g, end = 0;
+
+	for(g = RDS_PS_GROUPS; (g < RDS_MAX_GROUPS) && !end; g++) {
+		uint8_t ch[4];
+		for(uint8_t i = 0; i < 4; i++) {
+			if (end)
+				ch[i] = ' ';
+			else if (*text)
+				ch[i] = *text++;
+			else {
+				ch[i] = '\r';
+				end = 1;
+			}
+		}
+		dirty |= rds_update(tab, g, RDS_GT(2,0) | rds_pty | (g - RDS_PS_GROUPS),
+			rds_chars(ch[0], ch[1]), rds_chars(ch[2], ch[3]));
 	}
+	if (g < tab->ngroups)
+		rds_pend = 1; // text is shorter now
+	tab->ngroups = g;
+	rds_commit(dirty);
 }
 
+// receivers clear Radiotext on A/B flag change,
+// so all text groups are sent out of the cycle order
 void ns741_rds_reset_radiotext(void)
 {
-	rds_text[1] ^= RDS_AB;
+	rds_table_t *tab = rds_begin();
+	uint32_t dirty = 0;
+	for(uint8_t g = RDS_PS_GROUPS; g < tab->ngroups; g++)
+		dirty |= 1ul << g;
+	rds_flip = 1;
+	rds_pend = 1;
+	rds_commit(dirty);
 }
 
 void ns741_rds_set_rds_pi(uint16_t rdspi)
 {
-	rds_ps[0] = rdspi;
-	rds_ps[2] = rdspi;
-	rds_text[0] = rdspi;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		rds_pi = rdspi;
+	}
+	// PS groups carry PI in block C instead of AF codes
+	rds_af = rdspi;
+	rds_table_t *tab = rds_begin();
+	for(uint8_t g = 0; g < RDS_PS_GROUPS; g++)
+		tab->blk[g][1] = rds_af;
+	rds_pend = 1;
+	rds_commit(0);
 }
 
 void ns741_rds_set_rds_pty(uint8_t rdspty)
 {
-	uint16_t pty = RDS_PTY(rdspty);
-	rds_ps[1]   &= ~RDS_PTYM;
-	rds_ps[1]   |= pty;
-	rds_text[1] &= ~RDS_PTYM;
-	rds_text[1] |= pty;
+	rds_pty = RDS_PTY(rdspty);
+	rds_table_t *tab = rds_begin();
+	for(uint8_t g = 0; g < RDS_MAX_GROUPS; g++) {
+		tab->blk[g][0] &= ~RDS_PTYM;
+		tab->blk[g][0] |= rds_pty;
+	}
+	rds_pend = 1;
+	rds_commit(0);
 }
 
 void ns741_rds_debug(uint8_t on)
 {
-	rds_debug = on ? 0x80 : RDS_MAX_BLOCKS;
+	rds_debug = on ? 0x80 : 0;
 }
 
 // text - up to 8 characters
@@ -349,69 +452,175 @@ void ns741_rds_debug(uint8_t on)
 // so exactly 8 chars will be transmitted
 void ns741_rds_set_progname(const char *text)
 {
-	uint8_t i;
-	// first copy text to our buffer
-	for (i = 0; *text && (i < 8); i++, text++)
-		ps_name[i] = *text;
-	// pad buffer with spaces
-	for (; i < 8; i++)
-		ps_name[i] = ' ';
+	rds_table_t *tab = rds_begin();
+	uint32_t dirty = 0;
+
+	for(uint8_t g = 0; g < RDS_PS_GROUPS; g++) {
+		uint8_t c0 = *text ? *text++ : ' ';
+		uint8_t c1 = *text ? *text++ : ' ';
+		dirty |= rds_update(tab, g, RDS_GT(0,0) | rds_pty | RDS_MS | g,
+			rds_af, rds_chars(c0, c1));
+	}
+	if (tab->ngroups < RDS_PS_GROUPS)
+		tab->ngroups = RDS_PS_GROUPS;
+	rds_commit(dirty);
+}
+
+// 4A Clock-Time group, RTC keeps local time so it is sent
+// as UTC with zero local offset, receivers display it as is
+void ns741_rds_set_ct(uint8_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t min)
+{
+	// Modified Julian Day, RBDS Standard Annex G
+	uint8_t  l = (month <= 2) ? 1 : 0;
+	uint16_t y = 100 + year - l; // years since 1900
+	uint32_t mjd = 14956 + day; // 17 bits after 2038-04-22
+	mjd += ((uint32_t)y * 36525) / 100;
+	mjd += ((uint32_t)(month + 1 + l * 12) * 306001) / 10000;
+
+	rds_ct_req = 0;
+	rds_ct[0] = RDS_GT(4,0) | rds_pty | ((mjd >> 15) & 0x03);
+	rds_ct[1] = ((uint16_t)mjd << 1) | ((hour >> 4) & 0x01);
+	rds_ct[2] = ((uint16_t)(hour & 0x0F) << 12) | ((uint16_t)min << 6);
+	rds_ct_req = 1;
 }
 
-// in total we can send 20 groups:
-// 4 groups with Program Service Name and 16 with Radiotext
-uint8_t ns741_rds_isr(void)
+// called from INT0 at the group boundary, swaps tables if
+// the back one is ready and copies next group to be sent
+static void rds_next_group(void)
 {
-	uint8_t *data;
-	static uint16_t *block;
-
-	if (block_index == 0) {
-		if (group_index > 3) {
-			uint8_t i = (group_index - 4) << 2;
-			if (i < text_len) {
-				block = rds_text;
-				block[1] &= ~RDS_RTIM;
-				block[1] |= group_index - 4;
-				data = (uint8_t *)&block[2];
-				data[1] = radiotext[i];
-				data[0] = radiotext[i+1];
-				data[3] = radiotext[i+2];
-				data[2] = radiotext[i+3];
-			}
-			else {
-				rds_debug_max = group_index << 2;
-				group_index = 0; // switch back to PS
-			}
+	if (rds_swap) {
+		rds_front ^= 1;
+		rds_swap = 0;
+		rds_dirty |= rds_dirty_next;
+		rds_dirty_next = 0;
+		if (rds_flip) {
+			rds_ab ^= RDS_AB;
+			rds_flip = 0;
 		}
+	}
 
-		if (group_index < 4) {
-			if ((group_index == 0) && (rds_debug & 0x80))
-				rds_debug = 0;
-			block = rds_ps;
-			block[1] &= ~RDS_PSIM;
-			block[1] |= group_index;
-			data = (uint8_t *)&block[3];
-			uint8_t i = group_index << 1; // 0,2,4,6
-			data[1] = ps_name[i];
-			data[0] = ps_name[i+1];
+	rds_grp[0] = rds_pi;
+	if (rds_ct_req) {
+		rds_ct_req = 0;
+		rds_grp_idx = RDS_MAX_GROUPS;
+		rds_grp[1] = rds_ct[0];
+		rds_grp[2] = rds_ct[1];
+		rds_grp[3] = rds_ct[2];
+		return;
+	}
+
+	const rds_table_t *tab = &rds_tab[rds_front];
+	if (group_index >= tab->ngroups)
+		group_index = 0;
+	rds_grp_idx = group_index;
+
+	// changed groups first
+	for(uint8_t g = 0; rds_dirty && (g < RDS_MAX_GROUPS); g++) {
+		uint32_t mask = 1ul << g;
+		if (rds_dirty & mask) {
+			rds_dirty &= ~mask;
+			if (g < tab->ngroups) {
+				rds_grp_idx = g;
+				break;
+			}
 		}
-		// uncomment following line if Group type B is used
-		// ns741_rds_cp((block[1] & 0x0800) >> 8);
 	}
 
-	if (rds_debug < rds_debug_max) {
-		data = (uint8_t *)&block[block_index];
-		if (block_index == 0)
-			printf_P(PSTR("%2d"), group_index);
-		printf_P(PSTR(" %02X%02X"), data[1], data[0]);
-		if (block_index == 3)
-			printf("\n");
-		rds_debug++;
+	if ((rds_grp_idx == 0) && (rds_debug & 0x80))
+		rds_debug = tab->ngroups;
+
+	const uint16_t *blk = tab->blk[rds_grp_idx];
+	rds_grp[1] = blk[0];
+	rds_grp[2] = blk[1];
+	rds_grp[3] = blk[2];
+	if (rds_grp_idx >= RDS_PS_GROUPS)
+		rds_grp[1] |= rds_ab;
+	// uncomment following line if Group type B is used
+	// ns741_rds_cp((rds_grp[1] & 0x0800) >> 8);
+}
+
+static void rds_done(i2c_xfer_t *xfer)
+{
+	rds_busy = 0;
+	rds_ts = mill8();
+	if (xfer->status != I2C_XFER_DONE)
+		return; // will be resent by ns741_rds_poll()
+
+	if (block_index == 3 && rds_debug && !(rds_debug & 0x80)) {
+		for(uint8_t i = 0; i < 4; i++)
+			rds_dbg[i] = rds_grp[i];
+		rds_dbg_group = rds_grp_idx;
+		rds_debug--;
 	}
 
-	i2c_send_word(rds_register[block_index], (uint8_t *)&block[block_index]);
 	block_index = (block_index + 1) & 0x03;
-	if (!block_index)
-		group_index = (group_index + 1) % RDS_MAX_GROUPS;
-	return group_index;
+	if (!block_index) {
+		rds_grp_set = 0;
+		// out of order groups do not advance the cycle
+		if (rds_grp_idx == group_index)
+			group_index++;
+	}
+}
+
+// interrupts must be disabled
+static void rds_feed(void)
+{
+	if (!rds_req || rds_busy)
+		return;
+
+	if (!rds_grp_set) {
+		rds_next_group();
+		rds_grp_set = 1;
+	}
+
+	rds_data[0] = rds_register[block_index];
+	rds_data[1] = rds_grp[block_index] >> 8;
+	rds_data[2] = rds_grp[block_index];
+
+	// if the bus is taken by synchronous transaction
+	// the block is sent as soon as it is released
+	rds_req = 0;
+	rds_busy = 1;
+	i2c_submit(&rds_xfer, I2C_URGENT);
+}
+
+// RDSINT goes low when NS741 is ready to transmit next RDS block
+ISR(INT0_vect)
+{
+	rds_req = 1;
+	rds_feed();
+}
+
+void ns741_rds_irq(uint8_t on)
+{
+	if (on) {
+		// falling edge of RDSINT
+		MCUCR = (MCUCR & ~_BV(ISC00)) | _BV(ISC01);
+		GIFR  = _BV(INTF0);
+		GICR |= _BV(INT0);
+	}
+	else
+		GICR &= ~_BV(INT0);
+}
+
+void ns741_rds_poll(void)
+{
+	if (rds_dbg_group != 0xFF) {
+		printf_P(PSTR("%2d"), rds_dbg_group);
+		for(uint8_t i = 0; i < 4; i++)
+			printf_P(PSTR(" %04X"), rds_dbg[i]);
+		printf("\n");
+		rds_dbg_group = 0xFF;
+	}
+
+	// missed falling edge or failed transfer
+	if (mmr_rdsint_get() == LOW) {
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+			if (!rds_busy && (uint8_t)(mill8() - rds_ts) > RDS_TIMEOUT) {
+				rds_ts = mill8();
+				rds_req = 1;
+				rds_feed();
+			}
+		}
+	}
 }
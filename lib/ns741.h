@@ -52,11 +52,17 @@ void ns741_rds_set_rds_pi(uint16_t rdspi);
 void ns741_rds_set_rds_pty(uint8_t rdspty);
 void ns741_rds_set_radiotext(const char *text);
 void ns741_rds_reset_radiotext(void); // toggle Reset flag
+// send 4A Clock-Time group once, year 0-99 for 2000-2099
+void ns741_rds_set_ct(uint8_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t min);
 
 void ns741_rds_debug(uint8_t on);
 
-// RDSINT handler
-uint8_t ns741_rds_isr(void);
+// RDSINT (PD2) is handled by INT0 interrupt, blocks are sent by
+// interrupt driven TWI, so main loop timing does not affect RDS
+void ns741_rds_irq(uint8_t on);
+// to be called from main loop: prints RDS debug output and
+// restarts RDS feeder if RDSINT edge was missed
+void ns741_rds_poll(void);
 #endif
 
 #ifdef __cplusplus
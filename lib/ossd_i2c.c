@@ -23,6 +23,7 @@
 */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "ossd_i2c.h"
 
@@ -122,22 +123,29 @@ static int8_t ossd_cmd_arg(uint8_t cmd, uint8_t arg)
 	return 0;
 }
 
-static void ossd_cmd_arg2(uint8_t cmd, uint8_t arg1, uint8_t arg2)
+static void ossd_fill_line(uint8_t data, uint8_t num)
 {
 	i2c_start(I2C_OSSD | I2C_WRITE);
-	i2c_write(OSSD_CMD);
-	i2c_write(cmd);
-	i2c_write(arg1);
-	i2c_write(arg2);
+	i2c_write(OSSD_DATA);
+	for(uint8_t i = 0; i < num; i++)
+		i2c_write(data);
 	i2c_stop();
 }
 
-static void ossd_fill_line(uint8_t data, uint8_t num)
+// one transaction for a run of commands or data bytes
+static inline void ossd_begin(uint8_t dc)
 {
 	i2c_start(I2C_OSSD | I2C_WRITE);
-	i2c_write(OSSD_DATA);
-	for(uint8_t i = 0; i < num; i++)
-		i2c_write(data);
+	i2c_write(dc);
+}
+
+static inline void ossd_put(uint8_t data)
+{
+	i2c_write(data);
+}
+
+static inline void ossd_end(void)
+{
 	i2c_stop();
 }
 
@@ -163,16 +171,6 @@ static int8_t ossd_cmd_arg(uint8_t cmd, uint8_t arg)
 	return 0;
 }
 
-static void ossd_cmd_arg2(uint8_t cmd, uint8_t arg1, uint8_t arg2)
-{
-	uint8_t data[4];
-	data[0] = OSSD_CMD;
-	data[1] = cmd;
-	data[2] = arg1;
-	data[3] = arg2;
-	pi2c_write(PI2C_BUS, data, 4);
-}
-
 static void ossd_fill_line(uint8_t data, uint8_t num)
 {
 	uint8_t *buf = (uint8_t *)alloca(num+1);
@@ -181,6 +179,31 @@ static void ossd_fill_line(uint8_t data, uint8_t num)
 	pi2c_write(PI2C_BUS, buf, num+1);
 }
 
+// data runs are buffered, long ones are split as
+// address is incremented by the controller anyway
+static uint8_t _buf[129];
+static uint8_t _blen;
+
+static void ossd_begin(uint8_t dc)
+{
+	_buf[0] = dc;
+	_blen = 1;
+}
+
+static void ossd_end(void)
+{
+	if (_blen > 1)
+		pi2c_write(PI2C_BUS, _buf, _blen);
+	_blen = 1;
+}
+
+static void ossd_put(uint8_t data)
+{
+	if (_blen == sizeof(_buf))
+		ossd_end();
+	_buf[_blen++] = data;
+}
+
 #endif
 
 static inline int8_t ossd_cmd(uint8_t cmd)
@@ -188,9 +211,17 @@ static inline int8_t ossd_cmd(uint8_t cmd)
 	return ossd_send_byte(OSSD_CMD, cmd);
 }
 
-static inline int8_t ossd_data(uint8_t data)
+// in OSSD_ADDR_MODE_HOR/VER mode set output region (width x pages)
+static void ossd_set_region(uint8_t line, uint8_t x, uint8_t width, uint8_t pages)
 {
-	return ossd_send_byte(OSSD_DATA, data);
+	ossd_begin(OSSD_CMD);
+	ossd_put(OSSD_SET_COL_ADDR);
+	ossd_put(x);
+	ossd_put(x + width - 1);
+	ossd_put(OSSD_SET_PAGE_ADDR);
+	ossd_put(line);
+	ossd_put(line + pages - 1);
+	ossd_end();
 }
 
 static uint8_t ossd_set_addr_mode(uint8_t set_mode)
@@ -200,10 +231,8 @@ static uint8_t ossd_set_addr_mode(uint8_t set_mode)
 		ossd_cmd_arg(OSSD_SET_ADDR_MODE, set_mode);
 		// if switching back to page mode
 		// set full screen as output region
-		if (set_mode == OSSD_ADDR_MODE_PAGE) {
-			ossd_cmd_arg2(OSSD_SET_PAGE_ADDR, 0, 7);
-			ossd_cmd_arg2(OSSD_SET_COL_ADDR, 0, 127);
-		}
+		if (set_mode == OSSD_ADDR_MODE_PAGE)
+			ossd_set_region(0, 0, 128, 8);
 		_mode = set_mode;
 	}
 	return ret;
@@ -212,20 +241,49 @@ static uint8_t ossd_set_addr_mode(uint8_t set_mode)
 void ossd_goto(uint8_t line, uint8_t x)
 {
 	if (_mode == OSSD_ADDR_MODE_PAGE) {
-		ossd_cmd(OSSD_SET_START_PAGE | (line & 0x07));
-		ossd_cmd(OSSD_SET_START_LCOL | (x & 0x0F));
-		ossd_cmd(OSSD_SET_START_HCOL | (x >> 4));
+		ossd_begin(OSSD_CMD);
+		ossd_put(OSSD_SET_START_PAGE | (line & 0x07));
+		ossd_put(OSSD_SET_START_LCOL | (x & 0x0F));
+		ossd_put(OSSD_SET_START_HCOL | (x >> 4));
+		ossd_end();
 	}
-	else {
-		uint8_t gw = bmfont_get()->gw;
-		// in OSSD_ADDR_MODE_HOR/VER mode we set output region (gw x 16)
-		ossd_cmd_arg2(OSSD_SET_COL_ADDR, x, x + gw - 1);
-		ossd_cmd_arg2(OSSD_SET_PAGE_ADDR, line, line+1);
+	else
+		ossd_set_region(line, x, bmfont_get()->gw, 2);
+}
+
+#if OSSD_CACHE
+// text put on every line, unchanged glyphs are not sent again
+typedef struct ossd_line_s {
+	const uint8_t *font; // NULL - not valid
+	uint8_t x;
+	uint8_t atr;
+	uint8_t pages;
+	uint8_t len;
+	char str[OSSD_CACHE_LEN];
+} ossd_line_t;
+
+static ossd_line_t _cache[8];
+
+static void ossd_cache_drop(uint8_t line, uint8_t pages)
+{
+	for(uint8_t i = 0; i < 8; i++) {
+		ossd_line_t *pc = &_cache[i];
+		if (pc->font && (i < line + pages) && (i + pc->pages > line))
+			pc->font = NULL;
 	}
 }
 
+static ossd_line_t *ossd_cache_get(uint8_t line)
+{
+	return &_cache[line];
+}
+#else
+#define ossd_cache_drop(line, pages)
+#endif
+
 void ossd_fill_screen(uint8_t data)
 {
+	ossd_cache_drop(0, 8);
 	// fill full screen line by line
 	for(uint8_t line = 0; line < 8; line++) {
 		ossd_goto(line, 0);
@@ -246,6 +304,9 @@ void ossd_set_contrast(uint8_t val)
 	ossd_cmd_arg(OSSD_SET_CONTRAST, val);
 }
 
+// put by ossd_put_centre(), so margins are clean
+#define OSSD_CENTRE 0x80
+
 static void ossd_put_centre(uint8_t line, const char *str, uint8_t atr)
 {
 	uint16_t len;
@@ -259,6 +320,15 @@ static void ossd_put_centre(uint8_t line, const char *str, uint8_t atr)
 	else
 		x = (128 - len) / 2;
 
+#if OSSD_CACHE
+	// same position and length, margins are clean already
+	ossd_line_t *pc = ossd_cache_get(line);
+	if (pc->font == font->font && pc->x == x && (pc->atr & OSSD_CENTRE) && pc->len*gw == len) {
+		ossd_putlx(line, x, str, atr | OSSD_CENTRE);
+		return;
+	}
+#endif
+
 	// in case if new text is shorter than previous one
 	// we clean line up to x position
 	if (x) {
@@ -269,7 +339,7 @@ static void ossd_put_centre(uint8_t line, const char *str, uint8_t atr)
 	}
 
 	// recursive call of ossd_putlx()
-	ossd_putlx(line, x, str, atr);
+	ossd_putlx(line, x, str, atr | OSSD_CENTRE);
 
 	// in case if new text is shorter than previous one
 	// we clean to the end of the line
@@ -281,17 +351,9 @@ static void ossd_put_centre(uint8_t line, const char *str, uint8_t atr)
 	}
 }
 
-void ossd_putlx(uint8_t line, int8_t x, const char *str, uint8_t atr)
+// n glyphs in one transaction, horizontal mode fills the region page by page
+static void ossd_put_glyphs(uint8_t line, uint8_t x, const char *str, uint8_t n, uint8_t atr)
 {
-	line &= 0x07;
-
-	// try to put this text in the middle of the line:
-	// ossd_put_centre() will calculate proper x coordinate
-	if (x < 0) {
-		ossd_put_centre(line, str, atr);
-		return;
-	}
-
 	uint8_t rev = 0;
 	uint8_t over = 0;
 	uint8_t under = 0;
@@ -306,25 +368,112 @@ void ossd_putlx(uint8_t line, int8_t x, const char *str, uint8_t atr)
 	uint8_t gw = pfont->gw;
 	uint8_t gh = pfont->gh;
 	uint8_t go = pfont->go;
-	uint8_t gb = gw*(gh / 8); // bytes per glyph
+	uint8_t gp = gh / 8; // pages per glyph
+	uint8_t gb = gw*gp;  // bytes per glyph
 	const uint8_t *font = pfont->font;
+
+	// compressed or row-major fonts are unpacked to RAM
+	uint8_t ram = pfont->flags;
+	uint8_t gbuf[BMFONT_GLYPH_MAX];
+
+	ossd_set_region(line, x, n*gw, gp);
+	ossd_begin(OSSD_DATA);
+	for(uint8_t p = 0; p < gp; p++) {
+		for(uint8_t c = 0; c < n; c++) {
+			const uint8_t *glyph = &font[(str[c] - go) * gb + p*gw];
+			if (ram) {
+				bmfont_glyph(pfont, str[c], gbuf, BMFONT_PAGES);
+				glyph = &gbuf[p*gw];
+			}
+			for(uint8_t i = 0; i < gw; i++) {
+				uint8_t d = ram ? glyph[i] : pgm_read_byte(&glyph[i]);
+				d ^= rev;
+				if (under && (gh == 8 || p > 0))
+					d ^= under;
+				if (p == 0)
+					d ^= over;
+				ossd_put(d);
+			}
+		}
+	}
+	ossd_end();
+}
+
+#if OSSD_CACHE
+// only runs of changed glyphs are sent, text must fit the line
+static void ossd_put_cached(uint8_t line, uint8_t x, const char *str, uint8_t len, uint8_t atr)
+{
+	bmfont_t *pfont = bmfont_get();
+	uint8_t gw = pfont->gw;
+	uint8_t gp = pfont->gh / 8;
+	ossd_line_t *pc = ossd_cache_get(line);
+	uint8_t hit = (pc->font == pfont->font) && (pc->x == x) && (pc->atr == atr);
+
+	// overlapped text on other lines is not valid anymore
+	ossd_cache_drop(line, gp);
+	if (!hit)
+		pc->len = 0;
+
+	for(uint8_t i = 0; i < len;) {
+		if (i < pc->len && pc->str[i] == str[i]) {
+			i++;
+			continue;
+		}
+		uint8_t n = 1;
+		while((i + n) < len && !((i + n) < pc->len && pc->str[i + n] == str[i + n]))
+			n++;
+		ossd_put_glyphs(line, x + i*gw, str + i, n, atr);
+		i += n;
+	}
+
+	memcpy(pc->str, str, len);
+	pc->len = len;
+	pc->font = pfont->font;
+	pc->x = x;
+	pc->atr = atr;
+	pc->pages = gp;
+}
+#endif
+
+void ossd_putlx(uint8_t line, int8_t x, const char *str, uint8_t atr)
+{
+	line &= 0x07;
+
+	// try to put this text in the middle of the line:
+	// ossd_put_centre() will calculate proper x coordinate
+	if (x < 0) {
+		ossd_put_centre(line, str, atr);
+		return;
+	}
+
+	bmfont_t *pfont = bmfont_get();
+	uint8_t gw = pfont->gw;
+	uint8_t gh = pfont->gh;
+	uint8_t ux = x;
 	uint8_t cmode = ossd_set_addr_mode(OSSD_ADDR_MODE_HOR);
-	for(; *str != '\0'; str++, x += gw) {
-		uint16_t idx = (*str - go) * gb;
-		if ((uint8_t)x > (128 - gw)) {
-			x = 0;
+
+#if OSSD_CACHE
+	uint8_t len = strlen(str);
+	if (len <= OSSD_CACHE_LEN && (ux + len*gw) <= 128) {
+		ossd_put_cached(line, ux, str, len, atr);
+		ossd_set_addr_mode(cmode);
+		return;
+	}
+#endif
+
+	while(*str != '\0') {
+		if (ux > (128 - gw)) {
+			ux = 0;
 			line = (line + (gh+7)/8) & 0x07;
 		}
-		ossd_goto(line, x);    
-		for(uint8_t i = 0; i < gb; i++) {
-			uint8_t d = pgm_read_byte(&font[idx+i]);
-			d ^= rev;
-			if (under && (gh == 8 || i > (gw - 1)))
-				d ^= under;
-			if (i < gw)
-				d ^= over;
-			ossd_data(d);
-		}
+		// glyphs up to the end of the line are sent in one transaction
+		uint8_t n = 1;
+		while(str[n] != '\0' && (ux + (n + 1)*gw) <= 128)
+			n++;
+		ossd_cache_drop(line, gh / 8);
+		ossd_put_glyphs(line, ux, str, n, atr);
+		str += n;
+		ux += n*gw;
 	}
 	ossd_set_addr_mode(cmode);
 }
@@ -35,16 +35,30 @@ extern "C" {
 #define OSSD_RPI	 2 /*< Raspberry Pi */
 #define OSSD_GALILEO 3 /*< Reserved for Intel Galileo */
 
+#ifndef OSSD_TARGET
 #ifdef __AVR_ARCH__
 	#define OSSD_TARGET OSSD_AVR
 #else
 	#define OSSD_TARGET OSSD_RPI
 #endif
+#endif
 
+#include <stdint.h>
 #if (OSSD_TARGET == OSSD_AVR)
 	#define I2C_OSSD (0x3C << 1)
-#else
-	#include <stdint.h>
+#endif
+
+/**
+  Text cache: the last string put on every line is kept and only changed
+  glyphs are sent, so redrawing a clock updates only changed digits.
+  Costs 8*(OSSD_CACHE_LEN + 6) bytes of RAM, strings longer than
+  OSSD_CACHE_LEN or wrapped to the next line are not cached
+  */
+#ifndef OSSD_CACHE
+#define OSSD_CACHE 0
+#endif
+#ifndef OSSD_CACHE_LEN
+#define OSSD_CACHE_LEN 16
 #endif
 
 /** 
@@ -16,11 +16,29 @@
    You should have received a copy of the GNU General Public License
    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
+#include <util/atomic.h>
+#include <avr/interrupt.h>
+
+#include "timer.h"
 #include "pcf2127.h"
 #include "i2cmaster.h"
 
 #define I2C_RTC (0x51 << 1)
 
+// time cache advanced by CLKOUT 1Hz on INT2
+#define PCF_CLK_ON    0x01 // interrupt enabled
+#define PCF_CLK_VALID 0x02 // cache is in sync with the chip
+#define PCF_CLK_SYNC  0x04 // re-read the chip after next tick
+#define PCF_CLK_TICK  0x08 // tick since the last pcf2127_clk_poll()
+
+#define PCF_SYNC_PERIOD 3600 // seconds between re-reads
+#define PCF_TICK_TOUT   1500 // ms, CLKOUT is not ticking
+
+static volatile uint8_t pcf_clk;
+static volatile uint16_t pcf_tick; // seconds since the last sync
+static volatile uint16_t pcf_ts;   // mill16() of the last tick
+static volatile pcf_td_t pcf_td;
+
 int8_t pcf2127_write(uint8_t addr, uint8_t *buf, uint8_t len)
 {
 	if (i2c_start(I2C_RTC | I2C_WRITE) != 0)
@@ -49,6 +67,8 @@ int8_t pcf2127_read(uint8_t addr, uint8_t *buf, uint8_t len)
 	return 0;
 }
 
+static int8_t pcf_read_date(pcf_td_t *ptd);
+
 int8_t pcf2127_init(void)
 {
 	uint8_t buf[8];
@@ -63,9 +83,11 @@ int8_t pcf2127_init(void)
 	pcf2127_write(PCF_REG_ASEC, buf, 5);
 
 	// 1 minute temperature compensation, disable clock out
-	buf[0] = 0x87;
+	// unless it drives time cache
+	uint8_t clkout = (pcf_clk & PCF_CLK_ON) ? PCF_CLKOUT_1HZ : PCF_CLKOUT_OFF;
+	buf[0] = 0x80 | clkout;
 	pcf2127_write(PCF_REG_CLKOUT, buf, 1);
-	buf[0] = 0xA6; // refresh OTP
+	buf[0] = 0xA0 | clkout; // refresh OTP
 	pcf2127_write(PCF_REG_CLKOUT, buf, 1);
 	// disable time stamping
 	buf[0] = 0x40;
@@ -92,6 +114,7 @@ int8_t pcf2127_set_time(pcf_td_t *ptd)
 	for(int8_t i = 0; i < 3; i++)
 		buf[i] = dec_to_bcd(ptm[2 - i]);
 
+	pcf_clk = (pcf_clk & ~PCF_CLK_VALID) | PCF_CLK_SYNC;
 	if (pcf2127_write(PCF_REG_SEC, buf, 3) == 0)
 		return 0;
 
@@ -103,6 +126,15 @@ int8_t pcf2127_get_time(pcf_td_t *ptd, uint32_t swclock)
 	uint8_t buf[3];
 	uint8_t *ptm = (uint8_t *)ptd;
 
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (pcf_clk & PCF_CLK_VALID) {
+			ptd->hour = pcf_td.hour;
+			ptd->min  = pcf_td.min;
+			ptd->sec  = pcf_td.sec;
+			return 0;
+		}
+	}
+
 	if (pcf2127_read(PCF_REG_SEC, buf,  3) == 0) {
 		for(int8_t i = 0; i < 3; i++)
 			ptm[i] = bcd_to_dec(buf[2 - i]);
@@ -115,6 +147,20 @@ int8_t pcf2127_get_time(pcf_td_t *ptd, uint32_t swclock)
 	return -1;
 }
 
+int16_t pcf2127_get_phase(pcf_td_t *ptd)
+{
+	int16_t ms = -1;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (pcf_clk & PCF_CLK_VALID) {
+			ptd->hour = pcf_td.hour;
+			ptd->min  = pcf_td.min;
+			ptd->sec  = pcf_td.sec;
+			ms = (uint16_t)millis_clock - pcf_ts;
+		}
+	}
+	return ms;
+}
+
 int8_t pcf2127_set_date(pcf_td_t *ptd)
 {
 	uint8_t buf[2];
@@ -122,12 +168,24 @@ int8_t pcf2127_set_date(pcf_td_t *ptd)
 	pcf2127_write(PCF_REG_DAY, buf, 1);
 	buf[0] = dec_to_bcd(ptd->month);
 	buf[1] = dec_to_bcd(ptd->year);
+	pcf_clk = (pcf_clk & ~PCF_CLK_VALID) | PCF_CLK_SYNC;
 	if (pcf2127_write(PCF_REG_MONTH, buf, 2) == 0)
 		return 0;
 	return -1;
 }
 
 int8_t pcf2127_get_date(pcf_td_t *ptd)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (pcf_clk & PCF_CLK_VALID) {
+			*ptd = *(pcf_td_t *)&pcf_td;
+			return 0;
+		}
+	}
+	return pcf_read_date(ptd);
+}
+
+static int8_t pcf_read_date(pcf_td_t *ptd)
 {
 	uint8_t buf[7];
 	uint8_t *ptm = (uint8_t *)ptd;
@@ -180,3 +238,79 @@ int8_t pcf2127_set_clkout(uint8_t hz)
 	reg |= hz;
 	return pcf2127_write(PCF_REG_CLKOUT, &reg, 1);
 }
+
+void pcf2127_clk_irq(uint8_t on)
+{
+	if (on) {
+		pcf2127_set_clkout(PCF_CLKOUT_1HZ);
+		// falling edge of CLKOUT, ISC2 can be changed only with INT2 disabled
+		GICR &= ~_BV(INT2);
+		MCUCSR &= ~_BV(ISC2);
+		GIFR = _BV(INTF2);
+		pcf_clk = PCF_CLK_ON | PCF_CLK_SYNC;
+		pcf_ts = mill16();
+		GICR |= _BV(INT2);
+	}
+	else {
+		GICR &= ~_BV(INT2);
+		pcf_clk = 0;
+		pcf2127_set_clkout(PCF_CLKOUT_OFF);
+	}
+}
+
+void pcf2127_clk_poll(void)
+{
+	uint8_t clk;
+	uint16_t ts;
+
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		clk = pcf_clk;
+		ts = pcf_ts;
+		pcf_clk &= ~PCF_CLK_TICK;
+	}
+	if (!(clk & PCF_CLK_ON))
+		return;
+
+	// CLKOUT is gone (pcf2127_init() or wiring), read the chip meanwhile
+	if ((uint16_t)(mill16() - ts) > PCF_TICK_TOUT) {
+		ATOMIC_BLOCK(ATOMIC_FORCEON) {
+			pcf_clk = (pcf_clk & ~PCF_CLK_VALID) | PCF_CLK_SYNC;
+			pcf_ts = mill16();
+		}
+		return;
+	}
+
+	// read the chip right after the tick, so the cache
+	// is not half a second behind if the tick and the seconds
+	// counter are not on the same edge
+	if ((clk & (PCF_CLK_SYNC | PCF_CLK_TICK)) == (PCF_CLK_SYNC | PCF_CLK_TICK)) {
+		pcf_td_t td;
+		if (pcf_read_date(&td) != 0)
+			return;
+		ATOMIC_BLOCK(ATOMIC_FORCEON) {
+			*(pcf_td_t *)&pcf_td = td;
+			pcf_tick = 0;
+			pcf_clk = (pcf_clk & ~PCF_CLK_SYNC) | PCF_CLK_VALID;
+		}
+	}
+}
+
+ISR(INT2_vect)
+{
+	pcf_ts = mill16();
+	pcf_clk |= PCF_CLK_TICK;
+	if (++pcf_tick >= PCF_SYNC_PERIOD)
+		pcf_clk |= PCF_CLK_SYNC;
+
+	if (++pcf_td.sec < 60)
+		return;
+	pcf_td.sec = 0;
+	if (++pcf_td.min < 60)
+		return;
+	pcf_td.min = 0;
+	if (++pcf_td.hour < 24)
+		return;
+	// new date is read from the chip
+	pcf_td.hour = 0;
+	pcf_clk |= PCF_CLK_SYNC;
+}
@@ -116,8 +116,18 @@ int8_t pcf2127_set_date(pcf_td_t *ptd);
 // reads only time to the ptd
 int8_t pcf2127_get_time(pcf_td_t *ptd, uint32_t swclock);
 int8_t pcf2127_get_date(pcf_td_t *ptd); // reads time+date to the ptd
+// time from the cache and msec passed since its last tick,
+// -1 if CLKOUT does not drive the cache
+int16_t pcf2127_get_phase(pcf_td_t *ptd);
 
 int8_t pcf2127_set_clkout(uint8_t hz); // one of PCF_CLKOUT_* above
+
+// CLKOUT 1Hz connected to INT2 (PB2) advances time cache, so
+// pcf2127_get_time() and pcf2127_get_date() do not access I2C bus.
+// Cache is re-read from the chip every hour, at midnight and after
+// time or date is set. Call pcf2127_clk_poll() from the main loop
+void pcf2127_clk_irq(uint8_t on);
+void pcf2127_clk_poll(void);
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,64 @@
+/* Loop latency histograms for ATmega32
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>
+
+#include "timer.h"
+#include "perf.h"
+
+void perf_reset(perf_t *pp)
+{
+	memset(pp, 0, sizeof(perf_t));
+	pp->job  = PERF_NOJOB;
+	pp->cjob = PERF_NOJOB;
+}
+
+void perf_mark(perf_t *pp)
+{
+	uint32_t now = micros();
+	uint32_t span = now - pp->ts;
+	uint8_t  first = (pp->ts == 0);
+
+	pp->ts = now ? now : 1;
+	if (first) {
+		pp->cjob = PERF_NOJOB;
+		pp->crun = 0;
+		return;
+	}
+
+	uint8_t bucket = 0;
+	for(uint32_t lim = 128; span >= lim && bucket < PERF_BUCKETS - 1; lim <<= 1)
+		bucket++;
+	if (pp->hist[bucket] != 0xFFFF)
+		pp->hist[bucket]++;
+
+	if (span > pp->worst) {
+		pp->worst = span;
+		pp->when  = millis();
+		pp->job   = pp->cjob;
+	}
+	pp->cjob = PERF_NOJOB;
+	pp->crun = 0;
+}
+
+void perf_job(perf_t *pp, uint8_t job, uint32_t usec)
+{
+	if (usec >= pp->crun) {
+		pp->crun = usec;
+		pp->cjob = job;
+	}
+}
@@ -0,0 +1,61 @@
+/* Loop latency histograms for ATmega32
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ATMEGA_PERF_H
+#define ATMEGA_PERF_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // to trick VisualAssist
+}
+#endif
+#endif
+
+// log2 buckets: 0 - below 128 usec, n - from 64 << n usec,
+// the last one collects everything from 131 msec
+#define PERF_BUCKETS 12
+#define PERF_NOJOB   0xFF
+
+// intervals between marks of a periodic event
+typedef struct perf_s {
+	uint32_t ts;    // micros() of the previous mark
+	uint32_t worst; // worst interval, usec
+	uint32_t when;  // millis() at the end of the worst interval
+	uint8_t  job;   // longest job of the worst interval
+	uint8_t  cjob;  // longest job since the previous mark
+	uint32_t crun;  // and its run time, usec
+	uint16_t hist[PERF_BUCKETS]; // saturated at 0xFFFF
+} perf_t;
+
+void perf_reset(perf_t *pp);
+// call at every event, the first mark after reset only sets time stamp
+void perf_mark(perf_t *pp);
+// report a job run time, the longest one is blamed for the interval
+void perf_job(perf_t *pp, uint8_t job, uint32_t usec);
+
+// low limit of the bucket, usec
+static inline uint32_t perf_bucket_usec(uint8_t bucket)
+{
+	return bucket ? (64UL << bucket) : 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
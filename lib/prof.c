@@ -0,0 +1,122 @@
+/* Sampling profiler for ATmega32, uses Timer2 overflow interrupt
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#include "prof.h"
+
+static uint8_t  prof_hist[PROF_BUCKETS];
+static uint8_t  prof_shift; // counters were halved prof_shift times
+static uint32_t prof_nsamples;
+// word address of interrupted instruction, set by TIMER2_OVF_vect
+static volatile uint16_t prof_pc __attribute__((used));
+
+void __vector_prof(void) __attribute__((signal, used));
+
+// Interrupted PC is on the top of the stack, high byte first.
+// Only r0, r30 and r31 are used here and SREG is not changed,
+// __vector_prof() does the rest and returns with reti.
+ISR(TIMER2_OVF_vect, ISR_NAKED)
+{
+	__asm__ __volatile__(
+		"push r30"           "\n\t"
+		"push r31"           "\n\t"
+		"in   r30, __SP_L__" "\n\t"
+		"in   r31, __SP_H__" "\n\t"
+		"push r0"            "\n\t"
+		"ldd  r0, Z+3"       "\n\t"
+		"sts  prof_pc+1, r0" "\n\t"
+		"ldd  r0, Z+4"       "\n\t"
+		"sts  prof_pc, r0"   "\n\t"
+		"pop  r0"            "\n\t"
+		"pop  r31"           "\n\t"
+		"pop  r30"           "\n\t"
+		"jmp  __vector_prof" "\n\t"
+		::
+	);
+}
+
+void __vector_prof(void)
+{
+	uint16_t bucket = prof_pc >> (PROF_SHIFT - 1);
+	prof_nsamples++;
+	if (bucket >= PROF_BUCKETS)
+		return;
+	if (prof_hist[bucket] == 0xFF) {
+		// keep ratios, counts become samples >> prof_shift
+		for(uint16_t i = 0; i < PROF_BUCKETS; i++)
+			prof_hist[i] >>= 1;
+		prof_shift++;
+	}
+	prof_hist[bucket]++;
+}
+
+int8_t prof_start(void)
+{
+	// Timer2 is RTC on data nodes
+	if (TIMSK & _BV(OCIE2))
+		return -1;
+	TCCR2 = _BV(CS22) | _BV(CS21); // normal mode, clk/256
+	TCNT2 = 0;
+	TIFR  = _BV(TOV2);
+	TIMSK |= _BV(TOIE2);
+	return 0;
+}
+
+void prof_stop(void)
+{
+	TIMSK &= ~_BV(TOIE2);
+	TCCR2 = 0;
+}
+
+void prof_reset(void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		memset(prof_hist, 0, sizeof(prof_hist));
+		prof_shift = 0;
+		prof_nsamples = 0;
+	}
+}
+
+uint8_t prof_running(void)
+{
+	return (TIMSK & _BV(TOIE2)) ? 1 : 0;
+}
+
+uint32_t prof_samples(void)
+{
+	uint32_t n;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		n = prof_nsamples;
+	}
+	return n;
+}
+
+uint8_t prof_scale(void)
+{
+	return prof_shift;
+}
+
+uint8_t prof_count(uint16_t bucket)
+{
+	if (bucket >= PROF_BUCKETS)
+		return 0;
+	return prof_hist[bucket];
+}
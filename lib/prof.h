@@ -0,0 +1,57 @@
+/* Sampling profiler for ATmega32, uses Timer2 overflow interrupt
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ATMEGA_PROF_H
+#define ATMEGA_PROF_H
+
+#include <stdint.h>
+#include <avr/io.h>
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // to trick VisualAssist
+}
+#endif
+#endif
+
+// histogram bucket is 2^PROF_SHIFT bytes of flash,
+// 256 bytes buckets take 128 bytes of RAM for 32K flash
+#ifndef PROF_SHIFT
+#define PROF_SHIFT 8
+#endif
+#define PROF_BUCKETS ((FLASHEND + 1UL) >> PROF_SHIFT)
+
+// Timer2 overflow with clk/256 prescaler: 8MHz/256/256 = 122Hz,
+// not a multiple of 1ms timer, so periodic code is not aliased
+#define PROF_HZ (F_CPU / 256 / 256)
+
+// starts sampling, histogram is kept from the previous run,
+// returns -1 if Timer2 is used as RTC
+int8_t prof_start(void);
+void   prof_stop(void);
+void   prof_reset(void);
+
+uint8_t  prof_running(void);
+uint32_t prof_samples(void);
+// bucket counters are halved on overflow, samples in bucket = count << scale
+uint8_t  prof_scale(void);
+uint8_t  prof_count(uint16_t bucket);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
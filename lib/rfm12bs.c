@@ -77,7 +77,7 @@ static void rfm12_cmdw(rfm12_t *rfm, uint16_t cmd)
 
 uint16_t rfm12_cmdrw(rfm12_t *rfm, uint16_t cmd)
 {
-	uint16_t rdata;
+	uint16_t rdata = 0;
 	if (!(rfm->mode & RFM_SPI_SELECTED))
 		digitalWrite(rfm->cs, LOW);
 
@@ -296,6 +296,15 @@ static uint8_t rfm_crc8(uint8_t crc, uint8_t data)
 	return _crc_ibutton_update(crc, data);
 }
 
+#ifdef RFM12_BENCH
+uint8_t rfm12_crc8(uint8_t crc, const uint8_t *data, uint8_t len)
+{
+	for(uint8_t i = 0; i < len; i++)
+		crc = rfm_crc8(crc, data[i]);
+	return crc;
+}
+#endif
+
 #define RFM_SEND_PRELEN 4
 
 // transmit data stream in the following format:
@@ -280,6 +280,11 @@ uint8_t rfm12_receive_data(rfm12_t *rfm, void *buf, uint8_t len, uint8_t flags);
 // transmit data stream
 int8_t  rfm12_send(rfm12_t *rfm, void *data, uint8_t len);
 
+#ifdef RFM12_BENCH
+// frame crc as rfm12_send() calculates it, for benchmarks only
+uint8_t rfm12_crc8(uint8_t crc, const uint8_t *data, uint8_t len);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -21,6 +21,7 @@
 
 #include "rht.h"
 #include "timer.h"
+#include "fmtnum.h"
 
 // poll t/rh sensor and update RDS radio text
 // dst must be at least 61 byte long
@@ -30,10 +31,10 @@ int8_t rht_read(rht_t *rht, int8_t echo, char *dst)
 	if (ret == 0) {
 		rht_get_temperature(rht);
 		rht_get_humidity(rht);
-		int8_t val = get_u8val(rht->temperature.val);
-		sprintf_P(dst, PSTR("T %d.%02d H %d.%02d"),
-			val, rht->temperature.dec,
-			rht->humidity.val, rht->humidity.dec);
+		char *str = fmt_str_P(dst, PSTR("T "), 0);
+		str = fmt_fixed(str, rht->temperature.val, rht->temperature.dec, 0, 0);
+		str = fmt_str_P(str, PSTR(" H "), 0);
+		fmt_fixed(str, rht->humidity.val, rht->humidity.dec, 0, 0);
 	}
 	if (echo)
 		rht_print(ret == 0 ? dst : NULL);
@@ -39,6 +39,8 @@ extern "C" {
 #define RHT_TVALID 0x01
 #define RHT_HVALID 0x02
 
+#define RHT_BUSY 1 // rht_step() return value, measurement in progress
+
 typedef struct u8val_s
 {
 	uint8_t val; // high bit: negative
@@ -65,6 +67,7 @@ typedef struct rht_s
 static inline void   rht_init(void) { sht1x_init(); }
 static inline void   rht_print(const char *data) { sht1x_print(data); }
 static inline int8_t rht_poll(rht_t *prht) { return sht1x_poll(prht); }
+static inline int8_t rht_step(void) { return sht1x_step(); }
 static inline int8_t rht_get_temperature(rht_t *prht) { return sht1x_get_temperature(prht); }
 static inline int8_t rht_get_humidity(rht_t *prht)  { return sht1x_get_humidity(prht); }
 #else
@@ -72,6 +75,7 @@ static inline int8_t rht_get_humidity(rht_t *prht)  { return sht1x_get_humidity(
 static inline void   rht_init(void) { rht03_init(); }
 static inline void   rht_print(const char *data) { rht03_print(data); }
 static inline int8_t rht_poll(rht_t *prht) { return rht03_poll(prht); }
+static inline int8_t rht_step(void) { return 0; }
 static inline int8_t rht_get_temperature(rht_t *prht) { return rht03_get_temperature(prht); }
 static inline int8_t rht_get_humidity(rht_t *prht)  { return rht03_get_humidity(prht); }
 #endif
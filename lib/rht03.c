@@ -155,7 +155,7 @@ int8_t rht03_get_humidity(rht_t *prht)
 void rht03_print(const char *data)
 {
 	const uint8_t *buf = rht03.bits;
-	printf("%u %lu rht %s: ", rht03.errors, millis(), data ? "error" : "ok");
+	printf("%u %lu rht %s: ", rht03.errors, (unsigned long)millis(), data ? "error" : "ok");
 	for(uint8_t i = 0; i < 41; i++)
 		printf("%u ", buf[i]);
 	printf("| ");
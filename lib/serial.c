@@ -41,7 +41,9 @@ uint8_t osccal_def;
 // 115200 at 8MHz errors up to 7.8%
 
 int uart_tx(char data, FILE *stream);
+#ifdef __AVR_ARCH__
 FILE uart_stdout = FDEV_SETUP_STREAM(uart_tx, NULL, _FDEV_SETUP_WRITE);
+#endif
 
 int uart_tx(char data, FILE *stream __attribute__((unused)))
 {
@@ -88,8 +90,10 @@ void serial_init(long baud_rate)
 	osccal_def = OSCCAL;
 	// all necessary initializations
 	uart_init(UART_BAUD_SELECT(baud_rate, F_CPU));
-	// enable printf, puts...
+	// enable printf, puts... host build keeps libc stdout
+#ifdef __AVR_ARCH__
 	stdout = &uart_stdout;
+#endif
 }
 
 uint16_t serial_getc(void)
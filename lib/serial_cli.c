@@ -24,6 +24,7 @@
 #include <util/delay.h>
 
 #include "mmrio.h"
+#include "pinio.h"
 #include "timer.h"
 #include "serial.h"
 #include "serial_cli.h"
@@ -48,6 +49,137 @@ char *get_arg(char *str)
 	return arg;
 }
 
+int8_t get_on_off(const char *str)
+{
+	if (str_is(str, PSTR("on")))
+		return 1;
+	if (str_is(str, PSTR("off")))
+		return 0;
+	return -1;
+}
+
+int8_t get_hms(char *str, uint8_t *hms)
+{
+	hms[0] = strtoul(str, &str, 10);
+	if (hms[0] < 24 && *str == ':') {
+		hms[1] = strtoul(str + 1, &str, 10);
+		if (hms[1] < 60 && *str == ':') {
+			hms[2] = strtoul(str + 1, &str, 10);
+			if (hms[2] < 60)
+				return 0;
+		}
+	}
+	return CLI_EARG;
+}
+
+// compare the first word of the command line with the first word of pcmd
+static int8_t cmd_match(const char *str, const char *pcmd)
+{
+	for(;; str++, pcmd++) {
+		char ch = pgm_read_byte(pcmd);
+		if (ch == ' ')
+			ch = '\0';
+		char in = *str;
+		if (in == ' ')
+			in = '\0';
+		if (ch != in)
+			return 0;
+		if (ch == '\0')
+			return 1;
+	}
+}
+
+int8_t cli_dispatch(const cli_cmd_t *table, char *cmd, void *ptr)
+{
+	// skip leading spaces
+	while(*cmd == ' ')
+		cmd++;
+
+	for(;; table++) {
+		const char *pcmd = (const char *)pgm_read_word(&table->cmd);
+		if (pcmd == NULL)
+			return CLI_ENOTSUP;
+		// most of the commands are rejected by the first character
+		if (pgm_read_byte(pcmd) != *cmd || !cmd_match(cmd, pcmd))
+			continue;
+
+		char *arg = get_arg(cmd);
+		const cli_cmd_t *sub = (const cli_cmd_t *)pgm_read_word(&table->sub);
+		cli_handler *handler = (cli_handler *)pgm_read_word(&table->handler);
+
+		if (sub && *arg) {
+			int8_t ret = cli_dispatch(sub, arg, ptr);
+			if (ret != CLI_ENOTSUP)
+				return ret;
+		}
+		if (handler)
+			return handler(arg, ptr);
+		return CLI_EARG;
+	}
+}
+
+static void help_walk(const cli_cmd_t *table, char *line, uint8_t len)
+{
+	for(;; table++) {
+		const char *pcmd = (const char *)pgm_read_word(&table->cmd);
+		if (pcmd == NULL)
+			return;
+		const cli_cmd_t *sub = (const cli_cmd_t *)pgm_read_word(&table->sub);
+		// if subcommands are described by their parent do not list them
+		if (sub && !strchr_P(pcmd, ' ')) {
+			uint8_t n = len;
+			char ch;
+			while((ch = pgm_read_byte(pcmd++)) != '\0' && n < (CLI_HELP_LEN - 2))
+				line[n++] = ch;
+			line[n++] = ' ';
+			help_walk(sub, line, n);
+			continue;
+		}
+		line[len] = '\0';
+		uart_puts_p(PSTR("  "));
+		uart_puts(line);
+		uart_puts_p(pcmd);
+		serial_putc('\n');
+	}
+}
+
+void cli_help(const cli_cmd_t *table)
+{
+	char line[CLI_HELP_LEN];
+	help_walk(table, line, 0);
+}
+
+int8_t cli_mem(char *arg UNUSED, void *ptr UNUSED)
+{
+	printf_P(PSTR("memory %d\n"), free_mem());
+	return 0;
+}
+
+int8_t cli_calibrate(char *arg, void *ptr UNUSED)
+{
+	uart_puts_p(PSTR("\ncalibrating..."));
+	if (str_is(arg, PSTR("default")))
+		serial_calibrate(osccal_def);
+	else
+		serial_calibrate(OSCCAL);
+	return 0;
+}
+
+int8_t cli_get_pin(char *arg, void *ptr UNUSED)
+{
+	char   port = arg[0];
+	uint8_t idx = atoi(arg+1) & 0x07;
+	uint8_t val = 0;
+	if (port == 'b')
+		val = _pin_get(&PINB, 1 << idx);
+	if (port == 'c')
+		val = _pin_get(&PINC, 1 << idx);
+	if (port == 'd')
+		val = _pin_get(&PIND, 1 << idx);
+	printf_P(PSTR("%c%d = %d\n"), port, idx, !!val);
+	return 0;
+}
+
 static uint16_t led;
 static uint8_t  cursor;
 static char cmd[CMD_LEN + 1];
@@ -62,7 +194,13 @@ void cli_init(void)
 		cmd[i] = '\0';
 		hist[i] = '\0';
 	}
-	uart_puts_p(PSTR("> "));
+	cli_prompt();
+}
+
+void cli_prompt(void)
+{
+	serial_putc('>');
+	serial_putc(' ');
 }
 
 int8_t cli_interact(cli_processor *process, void *ptr)
@@ -100,10 +238,12 @@ int8_t cli_interact(cli_processor *process, void *ptr)
 	}
 
 	if (ch == '\n') {
+		int8_t ret = CLI_EOK;
 		serial_putc(ch);
 		if (*cmd) {
-			int8_t ret = process(cmd, ptr);
+			// command processor is free to modify the buffer
 			memcpy(hist, cmd, sizeof(cmd));
+			ret = process(cmd, ptr);
 			if (ret == CLI_EARG)
 				uart_puts_p(PSTR("Invalid argument\n"));
 			else if (ret == CLI_ENOTSUP)
@@ -114,8 +254,8 @@ int8_t cli_interact(cli_processor *process, void *ptr)
 		for(uint8_t i = 0; i < cursor; i++)
 			cmd[i] = '\0';
 		cursor = 0;
-		serial_putc('>');
-		serial_putc(' ');
+		if (ret != CLI_EMORE)
+			cli_prompt();
 		return 1;
 	}
 
@@ -29,6 +29,15 @@ extern "C" {
 #define CMD_LEN 0x7F // big enough for our needs
 #endif
 
+#ifndef CLI_HELP_LEN
+#define CLI_HELP_LEN 16 // max length of parent commands in help line
+#endif
+
+#ifndef UNUSED
+#define UNUSED __attribute__((unused))
+#endif
+
+#define CLI_EMORE    1 // command continues, caller prints the prompt
 #define CLI_EOK      0 // success
 #define CLI_EARG    -1 // invalid argument
 #define CLI_ENOTSUP -2 // command not supported
@@ -39,10 +48,33 @@ typedef int8_t cli_processor(char *buf, void *ptr);
 
 void   cli_init(void);
 int8_t cli_interact(cli_processor *process, void *ptr);
+void   cli_prompt(void);
+
+// command handler, arg points to the rest of command line
+typedef int8_t cli_handler(char *arg, void *ptr);
+
+// tables of commands are stored in PROGMEM and terminated by { NULL }
+// cmd is "name [args]" PROGMEM string: the first word is matched
+// against the command line, the whole string is printed as help
+typedef struct cli_cmd_s {
+	const char *cmd;
+	cli_handler *handler; // called if no subcommand matches
+	const struct cli_cmd_s *sub; // optional table of subcommands
+} cli_cmd_t;
+
+int8_t cli_dispatch(const cli_cmd_t *table, char *cmd, void *ptr);
+void   cli_help(const cli_cmd_t *table);
+
+// commonly used handlers
+int8_t cli_mem(char *arg, void *ptr);
+int8_t cli_calibrate(char *arg, void *ptr);
+int8_t cli_get_pin(char *arg, void *ptr);
 
 // helper functions
 char *get_arg(char *str);
 const char *is_on(uint8_t val);
+int8_t get_on_off(const char *str); // 1: "on", 0: "off", -1: anything else
+int8_t get_hms(char *str, uint8_t *hms); // HH:MM:SS to hms[0..2]
 
 static inline int8_t str_is(const char *cmd, const char *str)
 {
@@ -53,7 +85,7 @@ static inline uint16_t free_mem(void)
 {
 	extern int __heap_start, *__brkval; 
 	unsigned val;
-	val = (unsigned)((int)&val - (__brkval == 0 ? (int) &__heap_start : (int) __brkval));
+	val = (unsigned)((intptr_t)&val - (__brkval == 0 ? (intptr_t) &__heap_start : (intptr_t) __brkval));
 	return val;
 }
 
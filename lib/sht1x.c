@@ -32,6 +32,14 @@
 
 // ack timeout
 #define SHT1X_TIMEOUT 128
+// measurement time, 320ms max for 14 bit temperature
+#define SHT1X_MEAS_TOUT 400
+
+// measurement steps, sht1x_step() does only one of them per call
+#define SHT_IDLE 0
+#define SHT_SEND 1 // command is requested by sht1x_poll()
+#define SHT_WAIT 2 // waiting for data ready (data line low)
+#define SHT_READ 3 // clocking out one byte per step
 
 // crc calculation seeds for different commands
 #define SHT1X_CRC_TSEED 0x53
@@ -57,7 +65,11 @@ typedef struct sht1x_s
 	uint8_t  dtype;   // data type - 'T' or 'H'
 	uint16_t draw;    // data raw value
 	u8val_t  t, h;    // data in decimal format
-	double   ft, fh;  // data in double format
+	int16_t  t100;    // temperature in 0.01C for humidity compensation
+	uint8_t  step;    // measurement step
+	uint8_t  cmd;     // command to send
+	uint8_t  nbyte;   // bytes read
+	uint16_t ts;      // mill16() when command was sent
 } sht1x_t;
 
 static sht1x_t sht;
@@ -188,20 +200,6 @@ static uint8_t sht1x_crc(uint8_t data, uint8_t seed)
 	return crc;
 }
 
-static int8_t sht1x_read_data(sht1x_t *psh)
-{
-	sht1x_read(&psh->data[0], 1);
-	sht1x_read(&psh->data[1], 1);
-	sht1x_read(&psh->data[2], 0); // we read crc byte LSB first
-
-	// store raw data as 16 bit value
-	psh->draw = psh->data[0];
-	psh->draw <<= 8;
-	psh->draw |= psh->data[1];
-
-	return 0;
-}
-
 static int8_t sht1x_parse_temperature(sht1x_t *psh)
 {
 	uint8_t crc;
@@ -212,10 +210,10 @@ static int8_t sht1x_parse_temperature(sht1x_t *psh)
 		return -1;
 	}
 
-	double ft = -39.66 + 0.01*psh->draw; // for 3.3V
-	sht.ft = ft;
+	// -39.66 + 0.01*SOt for 3.3V, in 0.01C
+	int16_t tv = (int16_t)psh->draw - 3966;
+	psh->t100 = tv;
 	uint8_t sign = 0;
-	int16_t tv = (int16_t)(ft*100.0);
 	if (tv < 0) {
 		tv = -tv;
 		sign = 0x80;
@@ -237,11 +235,17 @@ static int8_t sht1x_parse_humidity(sht1x_t *psh)
 		return -1;
 	}
 
+	// integer version of floating point formulas, in 0.0001%:
+	// -2.0468 + 0.0367*SOrh - 1.5955e-6*SOrh^2
 	uint16_t h = psh->draw;
-	double fh = -2.0468 + 0.0367*h + -1.5955e-6 * (h*h);
-	double ch = (sht.ft - 25.0)*(0.01 + 0.00008*h) + fh;
-	sht.fh = ch;
-	uint16_t hv = (int16_t)(ch*100.0);
+	int32_t rh = 367L*h - 20468 - (int32_t)((((uint32_t)h*h >> 6) * 1046) >> 10);
+	// temperature compensation (T - 25)*(0.01 + 0.00008*SOrh)
+	rh += ((int32_t)(psh->t100 - 2500) * (int32_t)(500 + 4*h)) / 500;
+	if (rh < 0)
+		rh = 0;
+	if (rh > 1000000L)
+		rh = 1000000L;
+	uint16_t hv = rh / 100;
 	sht.h.val = hv/100;
 	sht.h.dec = (hv%100);
 	sht.valid |= RHT_HVALID;
@@ -268,14 +272,15 @@ void sht1x_init(void)
 	delay(2);
 	sht1x_read_status(&sht);
 	delay(2);
-	sht1x_send(SHT1X_CMD_TEMPERATURE);
+	// the first measurement is started by sht1x_poll()
+	sht.step = SHT_IDLE;
 }
 
 void sht1x_print(const char *data)
 {
 	u8val_t *pval = (sht.dtype == 'T') ? &sht.t : &sht.h;
 
-	printf_P(PSTR("%u %lu "), sht.errors, millis());
+	printf_P(PSTR("%u %lu "), sht.errors, (unsigned long)millis());
 	if (!data)
 		data = "error";
 	int8_t val = get_u8val(pval->val);
@@ -284,23 +289,62 @@ void sht1x_print(const char *data)
 		sht.draw, val, pval->dec, data);
 }
 
-int8_t sht1x_poll(rht_t *psht)
+int8_t sht1x_step(void)
 {
-	// if data line is low - SHT1x is ready
-	// read data and parse it
-	if (sht_ack() == 0) {
-		sht1x_read_data(&sht);
+	switch(sht.step) {
+	case SHT_SEND:
+		if (sht1x_send(sht.cmd) != 0) {
+			sht1x_reset();
+			sht.step = SHT_IDLE;
+			return -1;
+		}
+		sht.ts = mill16();
+		sht.step = SHT_WAIT;
+		return RHT_BUSY;
+
+	case SHT_WAIT:
+		// if data line is low - SHT1x is ready
+		if (sht_ack() != 0) {
+			if ((uint16_t)(mill16() - sht.ts) > SHT1X_MEAS_TOUT) {
+				sht.errors++;
+				sht1x_reset();
+				sht.step = SHT_IDLE;
+				return -1;
+			}
+			return RHT_BUSY;
+		}
+		sht.nbyte = 0;
+		sht.step = SHT_READ;
+		return RHT_BUSY;
+
+	case SHT_READ:
+		// 16 data bits MSB first, crc byte LSB first
+		sht1x_read(&sht.data[sht.nbyte], sht.nbyte < 2);
+		if (++sht.nbyte < 3)
+			return RHT_BUSY;
+		sht.step = SHT_IDLE;
+		sht.draw = sht.data[0];
+		sht.draw <<= 8;
+		sht.draw |= sht.data[1];
 		if ((sht.valid >> 2) == SHT1X_CMD_TEMPERATURE)
-			sht1x_parse_temperature(&sht);
-		if ((sht.valid >> 2) == SHT1X_CMD_HUMIDITY)
-			sht1x_parse_humidity(&sht);
+			return sht1x_parse_temperature(&sht);
+		return sht1x_parse_humidity(&sht);
 	}
 
-	// request new data from SHT1x
-	if ((sht.valid >> 2) == SHT1X_CMD_TEMPERATURE)
-		sht1x_send(SHT1X_CMD_HUMIDITY);
-	else
-		sht1x_send(SHT1X_CMD_TEMPERATURE);
+	return 0;
+}
+
+int8_t sht1x_poll(rht_t *psht)
+{
+	// request new data from SHT1x, results are read by sht1x_step()
+	// if the previous measurement is not finished yet - skip this one
+	if (sht.step == SHT_IDLE) {
+		if ((sht.valid >> 2) == SHT1X_CMD_TEMPERATURE)
+			sht.cmd = SHT1X_CMD_HUMIDITY;
+		else
+			sht.cmd = SHT1X_CMD_TEMPERATURE;
+		sht.step = SHT_SEND;
+	}
 
 	if (psht->errors != sht.errors) {
 		psht->errors = sht.errors;
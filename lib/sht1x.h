@@ -31,7 +31,9 @@ extern "C" {
 
 void   sht1x_init(void);
 void   sht1x_print(const char *data);
-int8_t sht1x_poll(rht_t *psht);
+int8_t sht1x_poll(rht_t *psht); // starts next measurement
+// one short step of the measurement, RHT_BUSY while it is in progress
+int8_t sht1x_step(void);
 int8_t sht1x_get_temperature(rht_t *psht);
 int8_t sht1x_get_humidity(rht_t *psht);
 
@@ -0,0 +1,99 @@
+/* Stack usage tracking for ATmega32: painting, high water mark
+   and guard bytes check, results survive watchdog reset
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include "stack.h"
+
+stack_rec_t stack_rec __attribute__((section(".noinit")));
+static stack_rec_t stack_prev;
+
+void stack_paint(void) __attribute__((naked, used, section(".init3")));
+
+// SP is set and r1 is cleared in .init2, nothing is pushed yet,
+// so everything from _end to RAMEND can be painted
+void stack_paint(void)
+{
+	__asm__ __volatile__(
+		"ldi  r30, lo8(_end)"     "\n\t"
+		"ldi  r31, hi8(_end)"     "\n\t"
+		"ldi  r24, %0"            "\n\t"
+		"ldi  r25, hi8(%1)"       "\n"
+		"1:"                      "\n\t"
+		"st   Z+, r24"            "\n\t"
+		"cpi  r30, lo8(%1)"       "\n\t"
+		"cpc  r31, r25"           "\n\t"
+		"brlo 1b"                 "\n\t"
+		"breq 1b"                 "\n\t"
+		:: "i" (STACK_PAINT), "i" (RAMEND)
+	);
+}
+
+void stack_init(void)
+{
+	uint8_t mcucsr = MCUCSR;
+	MCUCSR = mcucsr & ~(_BV(PORF) | _BV(BORF) | _BV(EXTRF) | _BV(WDRF));
+
+	memset(&stack_prev, 0, sizeof(stack_prev));
+	if (!(mcucsr & (_BV(PORF) | _BV(BORF))) && (stack_rec.magic == stack_seal(&stack_rec))) {
+		stack_prev = stack_rec;
+		stack_prev.magic = STACK_MAGIC;
+	}
+
+	stack_rec.unused = stack_size();
+	stack_rec.sp = 0;
+	stack_rec.flags = 0;
+	if (mcucsr & _BV(WDRF))
+		stack_rec.flags |= STACK_WDT;
+	if (mcucsr & _BV(EXTRF))
+		stack_rec.flags |= STACK_EXT;
+	stack_rec.magic = stack_seal(&stack_rec);
+	stack_unused();
+}
+
+uint16_t stack_size(void)
+{
+	return (RAMEND + 1) - (uint16_t)&_end;
+}
+
+uint16_t stack_unused(void)
+{
+	const uint8_t *ptr = &_end;
+	const uint8_t *end = (const uint8_t *)SP;
+
+	while((ptr <= end) && (*ptr == STACK_PAINT))
+		ptr++;
+	uint16_t unused = ptr - &_end;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (unused < stack_rec.unused) {
+			stack_rec.unused = unused;
+			stack_rec.magic = stack_seal(&stack_rec);
+		}
+	}
+	return unused;
+}
+
+const stack_rec_t *stack_last(void)
+{
+	if (stack_prev.magic == STACK_MAGIC)
+		return &stack_prev;
+	return NULL;
+}
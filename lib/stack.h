@@ -0,0 +1,94 @@
+/* Stack usage tracking for ATmega32: painting, high water mark
+   and guard bytes check, results survive watchdog reset
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ATMEGA_STACK_H
+#define ATMEGA_STACK_H
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/wdt.h>
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // to trick VisualAssist
+}
+#endif
+#endif
+
+// RAM from the end of .noinit (no malloc is used, so no heap) up to RAMEND
+// is painted with STACK_PAINT in .init3, before .data and .bss are initialized
+#define STACK_PAINT 0xC5
+// guard bytes, STACK_GUARD bytes above .noinit, overwritten
+// guard means that stack is about to corrupt global variables
+#ifndef STACK_GUARD
+#define STACK_GUARD 16
+#endif
+
+// stack_rec_t flags
+#define STACK_OVERFLOW 0x01 // reset by guard check
+#define STACK_WDT      0x02 // last reset was by watchdog
+#define STACK_EXT      0x04 // external reset
+
+// kept in .noinit, so previous run record can be checked after reset
+typedef struct stack_rec_s {
+	uint16_t magic;  // STACK_MAGIC ^ unused ^ sp ^ flags
+	uint16_t unused; // minimum of never used stack bytes
+	uint16_t sp;     // SP when guard bytes were found overwritten
+	uint8_t  flags;
+} stack_rec_t;
+
+#define STACK_MAGIC 0x5AC3
+
+extern uint8_t _end;
+extern stack_rec_t stack_rec;
+
+static inline uint16_t stack_seal(const stack_rec_t *rec)
+{
+	return STACK_MAGIC ^ rec->unused ^ rec->sp ^ rec->flags;
+}
+
+// to be used from timer ISR, inline to keep ISR prologue short
+static inline uint8_t stack_guard_ok(void)
+{
+	volatile uint8_t *guard = &_end + STACK_GUARD;
+	return (guard[0] == STACK_PAINT) && (guard[1] == STACK_PAINT);
+}
+
+// record overflow and reset, called with interrupts disabled
+static inline void stack_guard_hit(void)
+{
+	stack_rec.unused = 0;
+	stack_rec.sp     = SP;
+	stack_rec.flags |= STACK_OVERFLOW;
+	stack_rec.magic  = stack_seal(&stack_rec);
+	wdt_enable(WDTO_15MS);
+	while(1);
+}
+
+// to be called at start up, keeps the record of the previous run
+void     stack_init(void);
+// scan for the high water mark, updates the record, returns unused bytes
+uint16_t stack_unused(void);
+uint16_t stack_size(void); // from the end of .noinit up to RAMEND
+// record of the previous run, NULL if powered up
+const stack_rec_t *stack_last(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,132 @@
+/* Simple cooperative priority task runner for ATmega32
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>
+
+#include "timer.h"
+#include "task.h"
+
+static task_t  tasks[TASK_NUM];
+static uint8_t task_cur = TASK_IDLE; // class of the running task
+static task_hook *task_run_hook;
+static uint32_t task_seg; // micros() when the running step was (re)entered
+
+void task_init(uint8_t cls, task_step *step, void *data, uint8_t flags)
+{
+	task_t *pt = &tasks[cls];
+
+	pt->step  = step;
+	pt->data  = data;
+	pt->flags = flags;
+	pt->ts    = mill16();
+	pt->wlat  = 0;
+	pt->wrun  = 0;
+}
+
+void task_post(uint8_t cls)
+{
+	task_t *pt = &tasks[cls];
+
+	// keep the original time stamp if already waiting
+	if (!(pt->flags & TASK_READY)) {
+		pt->flags |= TASK_READY;
+		pt->ts = mill16();
+	}
+}
+
+static void task_exec(uint8_t cls)
+{
+	task_t *pt = &tasks[cls];
+	uint8_t prev = task_cur;
+	uint16_t start = mill16();
+	uint16_t span = start - pt->ts;
+
+	if (span > pt->wlat)
+		pt->wlat = span;
+
+	pt->flags &= ~TASK_READY;
+	task_cur = cls;
+	if (task_run_hook)
+		task_seg = micros();
+	uint8_t ret = pt->step(pt->data);
+	if (task_run_hook) {
+		uint32_t now = micros();
+		task_run_hook(cls, now - task_seg);
+		task_seg = now; // interrupted step continues
+	}
+	task_cur = prev;
+
+	// for polled and resumed tasks latency is counted
+	// from the end of the previous step
+	pt->ts = mill16();
+	span = pt->ts - start;
+	if (span > pt->wrun)
+		pt->wrun = span;
+	if (ret == TASK_MORE)
+		pt->flags |= TASK_READY;
+}
+
+static inline uint8_t task_ready(uint8_t cls)
+{
+	return tasks[cls].step && (tasks[cls].flags & (TASK_POLL | TASK_READY));
+}
+
+uint8_t task_run(void)
+{
+	uint8_t nrun = 0;
+
+	for(uint8_t cls = 0; cls < TASK_NUM; cls++) {
+		if (task_ready(cls)) {
+			task_exec(cls);
+			nrun++;
+		}
+	}
+	return nrun;
+}
+
+void task_yield(void)
+{
+	if (task_run_hook && task_cur != TASK_IDLE) {
+		uint32_t now = micros();
+		task_run_hook(task_cur, now - task_seg);
+		task_seg = now;
+	}
+	for(uint8_t cls = 0; cls < TASK_NUM && cls < task_cur; cls++) {
+		if (task_ready(cls))
+			task_exec(cls);
+	}
+}
+
+void task_set_hook(task_hook *hook)
+{
+	task_run_hook = hook;
+}
+
+void task_reset_stats(void)
+{
+	for(uint8_t cls = 0; cls < TASK_NUM; cls++) {
+		tasks[cls].wlat = 0;
+		tasks[cls].wrun = 0;
+	}
+}
+
+const task_t *task_get(uint8_t cls)
+{
+	if (cls < TASK_NUM)
+		return &tasks[cls];
+	return NULL;
+}
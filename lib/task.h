@@ -0,0 +1,80 @@
+/* Simple cooperative priority task runner for ATmega32
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef TASK_RUNNER_H
+#define TASK_RUNNER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // to trick VisualAssist
+}
+#endif
+#endif
+
+// task classes, one task per class, highest priority first
+#define TASK_RF    0 // RF receive
+#define TASK_RDS   1 // RDS group refill
+#define TASK_CLI   2 // UART command line
+#define TASK_DISP  3 // display updates
+#define TASK_SENS  4 // sensors polling
+#define TASK_RHT   5 // T/RH sensor measurement steps
+#define TASK_NUM   6
+#define TASK_IDLE  0xFF // no task is running
+
+// task step return values
+#define TASK_DONE 0 // wait for the next task_post()
+#define TASK_MORE 1 // call the step again on the next pass
+
+// task flags
+#define TASK_POLL  0x01 // polled task, ready on every pass
+#define TASK_READY 0x02 // posted or resumed task, waiting for its turn
+
+// one step of a task, should not block for more than a few msec
+typedef uint8_t task_step(void *data);
+// called after every step and before task_yield() runs other tasks
+// with step run time in usec, task_yield() splits the step into parts
+typedef void task_hook(uint8_t cls, uint32_t usec);
+
+typedef struct task_s {
+	task_step *step;
+	void    *data;
+	uint8_t  flags;
+	uint16_t ts;   // mill16() when the task became ready
+	uint16_t wlat; // worst case latency, msec
+	uint16_t wrun; // worst case step run time, msec
+} task_t;
+
+void task_init(uint8_t cls, task_step *step, void *data, uint8_t flags);
+void task_post(uint8_t cls);
+
+// run one step of every ready task in priority order,
+// returns number of steps executed
+uint8_t task_run(void);
+// run one step of every ready task with priority higher than the
+// currently running one, to be called from long blocking operations
+void task_yield(void);
+
+void task_set_hook(task_hook *hook);
+void task_reset_stats(void);
+const task_t *task_get(uint8_t cls);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -24,6 +24,9 @@
 
 #include "pinio.h"
 #include "timer.h"
+#if STACK_CHECK
+#include "stack.h"
+#endif
 
 #if (F_CPU != 8000000)
 #error Change init_millis() for F_CPU != 8MHz
@@ -35,11 +38,27 @@ volatile uint32_t millis_clock;
 volatile uint32_t rtc_clock;
 volatile uint8_t  rtc_sec, rtc_min, rtc_hour;
 volatile uint8_t rtc_wdt, rtc_wdtclock;
+volatile uint16_t rtc_tick_ms;
+
+// RTC timer 2 counts 1/32 sec, one second in a while is made one count longer
+// or shorter to correct drift and offset, accumulated in 0.1 usec units.
+// RTC is kept behind by less than a count, as after TCNT2 write,
+// so node sessions do not start before the base tick
+#define RTC_OCR  31
+#define RTC_STEP 312500L
+
+static volatile int32_t rtc_acc; // RTC is ahead
+static volatile int16_t rtc_dppm;
+static uint8_t rtc_ocr;
 
 // compare interrupt handler
 ISR(TIMER1_COMPA_vect)
 {
 	millis_clock++;
+#if STACK_CHECK
+	if (!stack_guard_ok())
+		stack_guard_hit();
+#endif
 	// separate counter for tenth of a second
 	ms_clock++;
 	if (ms_clock == 100) {
@@ -57,7 +76,26 @@ ISR(TIMER1_COMPA_vect)
 
 ISR(TIMER2_COMP_vect)
 {
+	rtc_tick_ms = (uint16_t)millis_clock;
 	rtc_clock++;
+
+	// OCR2 is written in the first count of the second
+	uint8_t ocr = RTC_OCR;
+	int32_t acc = rtc_acc + rtc_dppm;
+	if (acc > 0) {
+		ocr++;
+		acc -= RTC_STEP;
+	}
+	else if (acc <= -RTC_STEP) {
+		ocr--;
+		acc += RTC_STEP;
+	}
+	rtc_acc = acc;
+	if (ocr != rtc_ocr) {
+		OCR2 = ocr;
+		rtc_ocr = ocr;
+	}
+
 	// Increment time
 	if (++rtc_sec == 60) {
 		rtc_sec = 0;
@@ -88,7 +126,9 @@ void init_time_clock(uint8_t clock)
 
 	// RTC timer
 	if (clock & CLOCK_RTC) {
-		OCR2 = 31; //
+		rtc_acc = 0;
+		rtc_ocr = RTC_OCR;
+		OCR2 = RTC_OCR; // 32 counts per second
 		TCCR2 = _BV(WGM21) | _BV(CS22) | _BV(CS21) | _BV(CS20);
 		TIFR = _BV(OCF2);
 		TIMSK |= _BV(OCIE2);
@@ -106,3 +146,25 @@ void init_time_clock(uint8_t clock)
 	}
 }
 
+void rtc_set_drift(int16_t dppm)
+{
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		rtc_dppm = dppm;
+	}
+}
+
+void rtc_set_offset(int32_t usec)
+{
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		rtc_acc = usec * 10;
+	}
+}
+
+int32_t rtc_get_offset(void)
+{
+	int32_t acc;
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		acc = rtc_acc;
+	}
+	return acc / 10;
+}
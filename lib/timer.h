@@ -31,6 +31,7 @@ extern volatile uint32_t millis_clock; // global millis counter
 extern volatile uint32_t rtc_clock;    // rtc driven seconds counter
 extern volatile uint8_t  rtc_sec, rtc_min, rtc_hour;
 extern volatile uint8_t rtc_wdt, rtc_wdtclock;
+extern volatile uint16_t rtc_tick_ms;  // millis of the last rtc tick
 
 #define CLOCK_RTC    0x01
 #define CLOCK_MILLIS 0x02
@@ -38,6 +39,14 @@ extern volatile uint8_t rtc_wdt, rtc_wdtclock;
 
 void init_time_clock(uint8_t clock);
 
+// RTC drift in 0.1 ppm units, positive if RTC is fast, and measured RTC
+// offset, positive if RTC is ahead, are corrected by making one second in
+// a while 1/32 sec longer or shorter. Wait for ASSR OCR2UB before power save
+void rtc_set_drift(int16_t dppm);
+void rtc_set_offset(int32_t usec);
+// expected RTC offset, from -1/32 sec to 0 if drift is corrected
+int32_t rtc_get_offset(void);
+
 static inline uint32_t millis(void)
 {
 	uint32_t mil;
@@ -56,6 +65,21 @@ static inline uint16_t mill16(void)
 	return mil;
 }
 
+// microseconds with 8 usec resolution, Timer1 counts 0-125 every millisecond,
+// millisecond is counted if compare match is pending but not handled yet
+static inline uint32_t micros(void)
+{
+	uint32_t mil;
+	uint8_t  cnt;
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		mil = millis_clock;
+		cnt = (uint8_t)TCNT1;
+		if ((TIFR & _BV(OCF1A)) && cnt < 64)
+			mil++;
+	}
+	return mil * 1000 + cnt * 8;
+}
+
 // As Atmega32 supports only up to 2 sec wdt
 // use our millisecond timer for up to 20 sec watchdog
 static inline void rtc_set_wdt(uint8_t wdt_sec)
@@ -94,6 +118,32 @@ static inline void rtc_get_time(uint8_t *rtc)
 	}
 }
 
+// RTC timer 2 counts 1/32 sec, msec since the last RTC tick
+static inline uint16_t rtc_get_ms(void)
+{
+	return (TCNT2 * 125u) / 4;
+}
+
+// msec since the last RTC tick measured by millisecond timer,
+// timer 1 must not be stopped since the tick
+static inline uint16_t rtc_tick_age(void)
+{
+	uint16_t age;
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		age = (uint16_t)millis_clock - rtc_tick_ms;
+	}
+	return age;
+}
+
+// set RTC phase, waits for asynchronous timer 2 update
+static inline void rtc_set_ms(uint16_t msec)
+{
+	if (msec > 999)
+		msec = 999;
+	TCNT2 = (msec * 4u) / 125;
+	while(ASSR & _BV(TCN2UB));
+}
+
 // set PWM duty cycle on PB3
 static inline void pwm_set_duty(uint8_t duty)
 {
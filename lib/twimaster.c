@@ -6,8 +6,11 @@
 * Target:   any AVR device with hardware TWI 
 * Usage:    API compatible with I2C Software Library i2cmaster.h
 **************************************************************************/
+#include <stddef.h>
 #include <inttypes.h>
 #include <compat/twi.h>
+#include <util/atomic.h>
+#include <avr/interrupt.h>
 
 #include <i2cmaster.h>
 
@@ -15,9 +18,88 @@
 #error "F_CPU must be defined in Makefile, use -DF_CPU=xxxUL"
 #endif
 
-/* I2C clock in Hz */
+/* default I2C clock in Hz */
 #define SCL_CLOCK  400000L
 
+/* per-device SCL clock, TWBR set before start condition */
+#define TWI_PROFILES 4
+
+typedef struct twi_prof_s {
+	uint8_t addr; // without R/W bit, 0 - free slot
+	uint8_t twbr;
+} twi_prof_t;
+
+static twi_prof_t twi_prof[TWI_PROFILES];
+static uint8_t twi_twbr = ((F_CPU/SCL_CLOCK)-16)/2; // default speed
+
+/* bus ownership: synchronous transaction between start and stop,
+   or queued transaction running from TWI interrupt */
+static volatile uint8_t twi_lock;
+static volatile uint8_t twi_busy;
+
+/* queue of transactions, head is the one on the bus */
+static i2c_xfer_t *twi_head;
+static i2c_xfer_t *twi_tail;
+static uint8_t twi_idx; // byte index in wbuf or rbuf
+static uint8_t twi_rd;  // read phase of the transaction
+
+#define TWI_ACT ((1<<TWINT) | (1<<TWEN) | (1<<TWIE))
+
+/* switch SCL clock to the device speed, bus must be idle */
+static void twi_speed(uint8_t addr)
+{
+	uint8_t twbr = twi_twbr;
+
+	addr &= ~I2C_READ;
+	for(uint8_t i = 0; i < TWI_PROFILES; i++) {
+		if (twi_prof[i].addr == addr) {
+			twbr = twi_prof[i].twbr;
+			break;
+		}
+	}
+	TWBR = twbr;
+}
+
+/* start the next queued transaction, interrupts must be disabled */
+static void twi_next(void)
+{
+	if (twi_lock || twi_busy || !twi_head)
+		return;
+	twi_busy = 1;
+	twi_idx = 0;
+	twi_rd = (twi_head->wlen == 0);
+	while(TWCR & (1<<TWSTO));
+	twi_speed(twi_head->addr);
+	TWCR = TWI_ACT | (1<<TWSTA);
+}
+
+/* wait for queued transactions to complete and take the bus */
+static void twi_acquire(void)
+{
+	uint8_t locked = 0;
+
+	while(!locked) {
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+			if (!twi_busy)
+				locked = twi_lock = 1;
+		}
+	}
+	// previous stop condition may still be in progress
+	while(TWCR & (1<<TWSTO));
+}
+
+/* stop condition on failed start, so the bus is not held while unlocked */
+static unsigned char twi_fail(void)
+{
+	TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWSTO);
+	while(TWCR & (1<<TWSTO));
+	twi_lock = 0;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		twi_next();
+	}
+	return 1;
+}
+
 
 /*************************************************************************
  Initialization of the I2C bus interface. Need to be called only once
@@ -27,11 +109,69 @@ void i2c_init(void)
   /* initialize TWI clock: 100 kHz clock, TWPS = 0 => prescaler = 1 */
   
   TWSR = 0;                         /* no prescaler */
-  TWBR = ((F_CPU/SCL_CLOCK)-16)/2;  /* must be > 10 for stable operation */
+  TWBR = twi_twbr;                  /* must be > 10 for stable operation */
 
 }/* i2c_init */
 
 
+/*************************************************************************
+ Set SCL clock for the device, or default clock if address is I2C_ANY.
+ Not to be called between i2c_start and i2c_stop
+
+ Input:    device address, clock in kHz
+ Return:   0 ok, 1 no free profile slots
+*************************************************************************/
+unsigned char i2c_set_speed(unsigned char addr, uint16_t khz)
+{
+	uint16_t div = (uint16_t)(F_CPU/1000) / khz;
+	uint8_t twbr = (div > 16) ? (div - 16) / 2 : 0;
+	twi_prof_t *free = NULL;
+
+	if (addr == I2C_ANY) {
+		twi_twbr = twbr;
+		return 0;
+	}
+
+	addr &= ~I2C_READ;
+	for(uint8_t i = 0; i < TWI_PROFILES; i++) {
+		if (twi_prof[i].addr == addr) {
+			twi_prof[i].twbr = twbr;
+			return 0;
+		}
+		if (!free && !twi_prof[i].addr)
+			free = &twi_prof[i];
+	}
+	if (!free)
+		return 1;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		free->twbr = twbr;
+		free->addr = addr;
+	}
+	return 0;
+
+}/* i2c_set_speed */
+
+
+/*************************************************************************
+ Return SCL clock of the device in kHz
+*************************************************************************/
+uint16_t i2c_get_speed(unsigned char addr)
+{
+	uint8_t twbr = twi_twbr;
+
+	addr &= ~I2C_READ;
+	for(uint8_t i = 0; i < TWI_PROFILES && addr != I2C_ANY; i++) {
+		if (twi_prof[i].addr == addr) {
+			twbr = twi_prof[i].twbr;
+			break;
+		}
+	}
+	return (uint16_t)(F_CPU/1000) / (16 + 2*twbr);
+
+}/* i2c_get_speed */
+
+
 /*************************************************************************	
   Issues a start condition and sends address and transfer direction.
   return 0 = device accessible, 1= failed to access device
@@ -40,6 +180,9 @@ unsigned char i2c_start(unsigned char address)
 {
     uint8_t   twst;
 
+	twi_acquire();
+	twi_speed(address);
+
 	// send START condition
 	TWCR = (1<<TWINT) | (1<<TWSTA) | (1<<TWEN);
 
@@ -48,7 +191,7 @@ unsigned char i2c_start(unsigned char address)
 
 	// check value of TWI Status Register. Mask prescaler bits.
 	twst = TW_STATUS & 0xF8;
-	if ( (twst != TW_START) && (twst != TW_REP_START)) return 1;
+	if ( (twst != TW_START) && (twst != TW_REP_START)) return twi_fail();
 
 	// send device address
 	TWDR = address;
@@ -59,7 +202,7 @@ unsigned char i2c_start(unsigned char address)
 
 	// check value of TWI Status Register. Mask prescaler bits.
 	twst = TW_STATUS & 0xF8;
-	if ( (twst != TW_MT_SLA_ACK) && (twst != TW_MR_SLA_ACK) ) return 1;
+	if ( (twst != TW_MT_SLA_ACK) && (twst != TW_MR_SLA_ACK) ) return twi_fail();
 
 	return 0;
 
@@ -76,6 +219,8 @@ void i2c_start_wait(unsigned char address)
 {
     uint8_t   twst;
 
+    twi_acquire();
+    twi_speed(address);
 
     while ( 1 )
     {
@@ -135,11 +280,21 @@ unsigned char i2c_rep_start(unsigned char address)
 *************************************************************************/
 void i2c_stop(void)
 {
+	// bus was already released by failed i2c_start()
+	if (!twi_lock)
+		return;
+
     /* send stop condition */
 	TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWSTO);
 	
 	// wait until stop condition is executed and bus released
 	while(TWCR & (1<<TWSTO));
+	twi_lock = 0;
+
+	// run transactions queued while the bus was taken
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		twi_next();
+	}
 
 }/* i2c_stop */
 
@@ -198,3 +353,147 @@ unsigned char i2c_readNak(void)
     return TWDR;
 
 }/* i2c_readNak */
+
+
+/*************************************************************************
+ Queue transaction to be executed from TWI interrupt,
+ can be called from interrupt handlers
+
+ Input:    transaction, must stay valid until its status is not queued
+           I2C_URGENT flag to put it in front of the queue
+*************************************************************************/
+void i2c_submit(i2c_xfer_t *xfer, unsigned char flags)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		xfer->status = I2C_XFER_QUEUED;
+		xfer->next = NULL;
+		if (!twi_head)
+			twi_head = twi_tail = xfer;
+		else if (flags & I2C_URGENT) {
+			if (twi_busy) {
+				// head is on the bus already, go next to it
+				xfer->next = twi_head->next;
+				twi_head->next = xfer;
+				if (twi_tail == twi_head)
+					twi_tail = xfer;
+			}
+			else {
+				xfer->next = twi_head;
+				twi_head = xfer;
+			}
+		}
+		else {
+			twi_tail->next = xfer;
+			twi_tail = xfer;
+		}
+		twi_next();
+	}
+
+}/* i2c_submit */
+
+
+/*************************************************************************
+ Wait for queued transaction, not to be called between i2c_start and i2c_stop
+
+ Return:   0 transaction completed
+           1 device did not respond
+*************************************************************************/
+unsigned char i2c_wait(i2c_xfer_t *xfer)
+{
+	while(xfer->status == I2C_XFER_QUEUED);
+	return xfer->status != I2C_XFER_DONE;
+
+}/* i2c_wait */
+
+
+unsigned char i2c_xfer(i2c_xfer_t *xfer)
+{
+	i2c_submit(xfer, 0);
+	return i2c_wait(xfer);
+
+}/* i2c_xfer */
+
+
+static void twi_complete(uint8_t status)
+{
+	i2c_xfer_t *xfer = twi_head;
+
+	TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWSTO);
+	twi_head = xfer->next;
+	if (!twi_head)
+		twi_tail = NULL;
+	twi_busy = 0;
+	xfer->status = status;
+	if (xfer->done)
+		xfer->done(xfer);
+	twi_next();
+}
+
+/* device is busy (EEPROM write cycle), let others to use the bus */
+static void twi_requeue(void)
+{
+	i2c_xfer_t *xfer = twi_head;
+
+	TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWSTO);
+	xfer->retry--;
+	if (xfer->next) {
+		twi_head = xfer->next;
+		twi_tail->next = xfer;
+		twi_tail = xfer;
+		xfer->next = NULL;
+	}
+	twi_busy = 0;
+	twi_next();
+}
+
+ISR(TWI_vect)
+{
+	i2c_xfer_t *xfer = twi_head;
+
+	switch(TW_STATUS & 0xF8) {
+	case TW_START:
+	case TW_REP_START:
+		TWDR = xfer->addr | (twi_rd ? I2C_READ : I2C_WRITE);
+		TWCR = TWI_ACT;
+		break;
+	case TW_MT_SLA_ACK:
+	case TW_MT_DATA_ACK:
+		if (twi_idx < xfer->wlen) {
+			TWDR = xfer->wbuf[twi_idx++];
+			TWCR = TWI_ACT;
+		}
+		else if (xfer->rlen) {
+			// repeated start for read phase
+			twi_rd = 1;
+			twi_idx = 0;
+			TWCR = TWI_ACT | (1<<TWSTA);
+		}
+		else
+			twi_complete(I2C_XFER_DONE);
+		break;
+	case TW_MR_DATA_ACK:
+		xfer->rbuf[twi_idx++] = TWDR;
+		/* fall through */
+	case TW_MR_SLA_ACK:
+		// acknowledge all bytes but the last one
+		if ((twi_idx + 1) < xfer->rlen)
+			TWCR = TWI_ACT | (1<<TWEA);
+		else
+			TWCR = TWI_ACT;
+		break;
+	case TW_MR_DATA_NACK:
+		xfer->rbuf[twi_idx] = TWDR;
+		twi_complete(I2C_XFER_DONE);
+		break;
+	case TW_MT_SLA_NACK:
+	case TW_MR_SLA_NACK:
+		if (xfer->retry) {
+			twi_requeue();
+			break;
+		}
+		/* fall through */
+	default: // NACK or bus error
+		twi_complete(I2C_XFER_ERROR);
+		break;
+	}
+}/* TWI_vect */
@@ -36,221 +36,264 @@ static const char version[] PROGMEM = "2018-03-18\n";
 static const char *pstr_eol = version + 10;
 
 // some PROGMEM strings pooling
-static const char pstr_on[] PROGMEM = "on";
-static const char pstr_off[] PROGMEM = "off";
 static const char pstr_echo[] PROGMEM = "%s echo %s\n";
+static const char pstr_is[] PROGMEM = " is ";
 
-// list of supported commands 
-const char cmd_list[] PROGMEM =
-	"  time\n"
-	"  reset\n"
-	"  status\n"
-	"  calibrate\n"
-	"  set nid N\n"
-	"  set tsync N (every N sessions)\n"
-	"  set osccal X\n"
-	"  set txpwr PWR (0:max to 7:min)\n"
-	"  set repeat on|off\n"
-	"  set led on|off\n"
-	"  set rtc hh:mm:ss\n"
-	"  poll\n"
-	"  get pin (d3,b4,c2...)\n"
-	"  adc chan\n"
-	"  mem\n"
-	"  echo rx|lsd|off\n";
+extern const cli_cmd_t node_cmds[];
 
-int8_t cli_node(char *buf, void *ptr)
+static int8_t cmd_help(char *arg UNUSED, void *ptr UNUSED)
+{
+	uart_puts_p(PSTR("  version: "));
+	uart_puts_p(version);
+	cli_help(node_cmds);
+	return 0;
+}
+
+// SW reset
+static int8_t cmd_reset(char *arg UNUSED, void *ptr UNUSED)
 {
-	char *arg;
-	char cmd[CMD_LEN + 1];
+	uart_puts_p(PSTR("\nresetting..."));
+	wdt_enable(WDTO_15MS);
+	while(1);
+	return 0;
+}
 
-	memcpy(cmd, buf, sizeof(cmd));
-	arg = get_arg(cmd);
+static int8_t cmd_time(char *arg UNUSED, void *ptr UNUSED)
+{
+	char buf[16];
+	get_rtc_time(buf);
+	uart_puts(buf);
+	uart_puts_p(pstr_eol);
+	return 0;
+}
 
-	if (str_is(cmd, PSTR("help"))) {
-		uart_puts_p(PSTR("  version: "));
-		uart_puts_p(version);
-		uart_puts_p(cmd_list);
+static int8_t set_txpwr(char *arg, void *ptr UNUSED)
+{
+	uint8_t pwr = atoi(arg);
+	if (rfm12_set_txpwr(&rfm12, pwr) == 0) {
+		txpwr &= 0xF0;
+		txpwr |= pwr;
+		eeprom_update_byte(&em_txpwr, txpwr);
 		return 0;
 	}
+	return CLI_EARG;
+}
 
-	// SW reset
-	if (str_is(cmd, PSTR("reset"))) {
-		uart_puts_p(PSTR("\nresetting..."));
-		wdt_enable(WDTO_15MS);
-		while(1);
-	}
+static int8_t set_repeat(char *arg, void *ptr UNUSED)
+{
+	if (nid > 6)
+		return CLI_EARG;
+	int8_t on = get_on_off(arg);
+	if (on == 1)
+		txpwr |= RT_TX_REPEAT;
+	if (on == 0)
+		txpwr &= ~RT_TX_REPEAT;
+	eeprom_update_byte(&em_txpwr, txpwr);
+	uart_puts_p(PSTR("repeat"));
+	uart_puts_p(pstr_is);
+	uart_puts(is_on(txpwr & RT_TX_REPEAT));
+	uart_puts_p(pstr_eol);
+	return 0;
+}
 
-	if (str_is(cmd, PSTR("time"))) {
-		get_rtc_time(cmd);
-		uart_puts(cmd);
-		uart_puts_p(pstr_eol);
-		return 0;
-	}
+static int8_t set_led(char *arg, void *ptr UNUSED)
+{
+	int8_t on = get_on_off(arg);
+	if (on == 1)
+		active |= DLED_ACTIVE;
+	if (on == 0)
+		active &= ~DLED_ACTIVE;
+	uart_puts_p(PSTR("led"));
+	uart_puts_p(pstr_is);
+	uart_puts(is_on(active & DLED_ACTIVE));
+	uart_puts_p(pstr_eol);
+	return 0;
+}
 
-	if (str_is(cmd, PSTR("set"))) {
-		char *sval = get_arg(arg);
-		if (str_is(arg, PSTR("txpwr"))) {
-			uint8_t pwr = atoi(sval);
-			if (rfm12_set_txpwr(&rfm12, pwr) == 0) {
-				txpwr &= 0xF0;
-				txpwr |= pwr;
-				eeprom_update_byte(&em_txpwr, txpwr);
-				return 0;
-			}
-			return CLI_EARG;
-		}
+static int8_t set_osccal(char *arg, void *ptr UNUSED)
+{
+	uint8_t osc = atoi(arg);
+	serial_set_osccal(osc);
+	eeprom_update_byte(&em_osccal, osc);
+	return 0;
+}
 
-		if (str_is(arg, PSTR("repeat"))) {
-			if (nid > 6)
-				return CLI_EARG;
-			if (str_is(sval, pstr_on))
-				txpwr |= RT_TX_REPEAT;
-			if (str_is(sval, pstr_off))
-				txpwr &= ~RT_TX_REPEAT;
-			eeprom_update_byte(&em_txpwr, txpwr);
-			uart_puts(arg);
-			uart_puts_p(PSTR(" is "));
-			uart_puts(is_on(txpwr & RT_TX_REPEAT));
-			uart_puts_p(pstr_eol);
-			return 0;
-		}
+static int8_t set_nid(char *arg, void *ptr UNUSED)
+{
+	uint8_t val = atoi(arg);
+	if (!val || val > MAX_DNODE_NUM) // sensor id cannot be 0 or > 12
+		return CLI_EARG;
+	nid = val;
+	if (nid > 6)
+		txpwr &= ~RT_TX_REPEAT;
+	eeprom_update_byte(&em_nid, val);
+	return 0;
+}
 
-		if (str_is(arg, PSTR("led"))) {
-			if (str_is(sval, pstr_on))
-				active |= DLED_ACTIVE;
-			if (str_is(sval, pstr_off))
-				active &= ~DLED_ACTIVE;
-			uart_puts(arg);
-			uart_puts_p(PSTR(" is "));
-			uart_puts(is_on(active & DLED_ACTIVE));
-			uart_puts_p(pstr_eol);
-			return 0;
-		}
+static int8_t set_tsync(char *arg, void *ptr UNUSED)
+{
+	uint8_t val = atoi(arg);
+	if (!val) // sync interval cannot be  0 
+		return CLI_EARG;
+	tsync = val;
+	eeprom_update_byte(&em_tsync, val);
+	return 0;
+}
 
-		if (str_is(arg, PSTR("osccal"))) {
-			uint8_t osc = atoi(sval);
-			serial_set_osccal(osc);
-			eeprom_update_byte(&em_osccal, osc);
-			return 0;
-		}
-		
-		if (str_is(arg, PSTR("nid"))) {
-			uint8_t val = atoi(sval);
-			if (!val || val > MAX_DNODE_NUM) // sensor id cannot be 0 or > 12
-				return CLI_EARG;
-			nid = val;
-			if (nid > 6)
-				txpwr &= ~RT_TX_REPEAT;
-			eeprom_update_byte(&em_nid, val);
-			return 0;
-		}
+static int8_t set_rtc(char *arg, void *ptr UNUSED)
+{
+	uint8_t hms[3];
+	if (get_hms(arg, hms) != 0)
+		return CLI_EARG;
+	cli();
+	rtc_hour = hms[0];
+	rtc_min  = hms[1];
+	rtc_sec  = hms[2];
+	sei();
+	return 0;
+}
 
-		if (str_is(arg, PSTR("tsync"))) {
-			uint8_t val = atoi(sval);
-			if (!val) // sync interval cannot be  0 
-				return CLI_EARG;
-			tsync = val;
-			eeprom_update_byte(&em_tsync, val);
-			return 0;
-		}
+static int8_t cmd_poll(char *arg UNUSED, void *ptr UNUSED)
+{
+	uart_puts_p(PSTR("polling..."));
+	rt_flags |= RT_DATA_POLL;
+	return 0;
+}
 
-		if (str_is(arg, PSTR("rtc"))) {
-			uint8_t hour, min, sec;
-			hour = strtoul(sval, &arg, 10);
-			if (hour < 24 && *arg == ':') {
-				min = strtoul(arg + 1, &arg, 10);
-				if (min < 60 && *arg == ':') {
-					sec = strtoul(arg + 1, &arg, 10);
-					if (sec < 60) {
-						cli();
-						rtc_hour = hour;
-						rtc_min  = min;
-						rtc_sec  = sec;
-						sei();
-						return 0;
-					}
-				}
-			}
-		}
+static int8_t cmd_echo(char *arg UNUSED, void *ptr UNUSED)
+{
+	printf_P(pstr_echo, "rx", is_on(rt_flags & RT_RX_ECHO));
+	printf_P(pstr_echo, "lsd", is_on(rt_flags & RT_LSD_ECHO));
+	return 0;
+}
 
-		return CLI_EARG;
-	}
+static int8_t echo_rx(char *arg UNUSED, void *ptr UNUSED)
+{
+	rt_flags ^= RT_RX_ECHO;
+	printf_P(pstr_echo, "rx", is_on(rt_flags & RT_RX_ECHO));
+	return 0;
+}
 
-	if (str_is(cmd, PSTR("calibrate"))) {
-		uart_puts_p(PSTR("\ncalibrating..."));
-		if (str_is(arg, PSTR("default")))
-			serial_calibrate(osccal_def);
-		else
-			serial_calibrate(OSCCAL);
-		return 0;
-	}
+static int8_t echo_lsd(char *arg UNUSED, void *ptr UNUSED)
+{
+	rt_flags ^= RT_LSD_ECHO;
+	printf_P(pstr_echo, "lsd", is_on(rt_flags & RT_LSD_ECHO));
+	return 0;
+}
 
-	if (str_is(cmd, PSTR("poll"))) {
-		uart_puts_p(PSTR("polling..."));
-		rt_flags |= RT_DATA_POLL;
+static int8_t echo_off(char *arg UNUSED, void *ptr UNUSED)
+{
+	rt_flags = 0;
+	uart_puts_p(PSTR("echo OFF\n"));
+	return 0;
+}
+
+static int8_t cmd_adc(char *arg, void *ptr UNUSED)
+{
+	uint8_t ai = atoi((const char *)arg);
+	if (ai < 8) {
+		// enable ADC in case if we out of sleep mode
+		analogReference(VREF_AVCC);
+		uint16_t val = analogRead(ai);
+		printf_P(PSTR("ADC %d %4d\n"), ai, val);
 		return 0;
 	}
+	return CLI_EARG;
+}
 
-	if (str_is(cmd, PSTR("echo"))) {
-		if (arg[0] == '\0') {
-			printf_P(pstr_echo, "rx", is_on(rt_flags & RT_RX_ECHO));
-			printf_P(pstr_echo, "lsd", is_on(rt_flags & RT_LSD_ECHO));
-			return 0;
-		}
-		if (str_is(arg, PSTR("rx"))) {
-			rt_flags ^= RT_RX_ECHO;
-			printf_P(pstr_echo, arg, is_on(rt_flags & RT_RX_ECHO));
-			return 0;
-		}
-		if (str_is(arg, PSTR("lsd"))) {
-			rt_flags ^= RT_LSD_ECHO;
-			printf_P(pstr_echo, arg, is_on(rt_flags & RT_LSD_ECHO));
-			return 0;
-		}
-		if (str_is(arg, pstr_off)) {
-			rt_flags = 0;
-			uart_puts_p(PSTR("echo OFF\n"));
-			return 0;
+// sens [N drv [arg [period [warmup]]]]
+static int8_t cmd_sens(char *arg, void *ptr UNUSED)
+{
+	if (*arg) {
+		char *drv = get_arg(arg);
+		uint8_t n = atoi(arg);
+		if (!n || n > MAX_SENS || !*drv)
+			return CLI_EARG;
+		sens_cfg_t cfg = { 0, 0, 1, 0 };
+		char *val = get_arg(drv);
+		int8_t idx = sens_drv_find(drv);
+		if (idx < 0)
+			return CLI_EARG;
+		cfg.drv = idx;
+		for(uint8_t i = 1; *val && i < sizeof(cfg); i++) {
+			char *next = get_arg(val);
+			((uint8_t *)&cfg)[i] = atoi(val);
+			val = next;
 		}
-		return CLI_EARG;
+		if (!cfg.period)
+			return CLI_EARG;
+		eeprom_update_block(&cfg, &em_sens[n - 1], sizeof(cfg));
+		uart_puts_p(PSTR("reset to apply\n"));
 	}
+	sens_print();
+	return 0;
+}
 
-	if (str_is(cmd, PSTR("mem"))) {
-		printf_P(PSTR("memory %d\n"), free_mem());
-		return 0;
-	}
+static int8_t cmd_status(char *arg UNUSED, void *ptr)
+{
+	print_status(ptr);
+	return 0;
+}
 
-	if (str_is(cmd, PSTR("adc"))) {
-		uint8_t ai = atoi((const char *)arg);
-		if (ai < 8) {
-			// enable ADC in case if we out of sleep mode
-			analogReference(VREF_AVCC);
-			uint16_t val = analogRead(ai);
-			printf_P(PSTR("ADC %d %4d\n"), ai, val);
-			return 0;
-		}
-		return CLI_EARG;
-	}
+static const char pstr_help[] PROGMEM = "help";
+static const char pstr_time[] PROGMEM = "time";
+static const char pstr_reset[] PROGMEM = "reset";
+static const char pstr_status[] PROGMEM = "status";
+static const char pstr_calibrate[] PROGMEM = "calibrate";
+static const char pstr_set[] PROGMEM = "set";
+static const char pstr_set_nid[] PROGMEM = "nid N";
+static const char pstr_set_tsync[] PROGMEM = "tsync N (every N sessions)";
+static const char pstr_set_osccal[] PROGMEM = "osccal X";
+static const char pstr_set_txpwr[] PROGMEM = "txpwr PWR (0:max to 7:min)";
+static const char pstr_set_repeat[] PROGMEM = "repeat on|off";
+static const char pstr_set_led[] PROGMEM = "led on|off";
+static const char pstr_set_rtc[] PROGMEM = "rtc hh:mm:ss";
+static const char pstr_poll[] PROGMEM = "poll";
+static const char pstr_get[] PROGMEM = "get pin (d3,b4,c2...)";
+static const char pstr_adc[] PROGMEM = "adc chan";
+static const char pstr_mem[] PROGMEM = "mem";
+static const char pstr_sens[] PROGMEM = "sens [N drv [arg [period [warmup]]]]";
+static const char pstr_echo_cmd[] PROGMEM = "echo rx|lsd|off";
+static const char pstr_rx[] PROGMEM = "rx";
+static const char pstr_lsd[] PROGMEM = "lsd";
+static const char pstr_off[] PROGMEM = "off";
 
-	if (str_is(cmd, PSTR("get"))) {
-		char   port = arg[0];
-		uint8_t idx = atoi(arg+1) & 0x07;
-		uint8_t val = 0;
-		if (port == 'b')
-			val = _pin_get(&PINB, 1 << idx);
-		if (port == 'c')
-			val = _pin_get(&PINC, 1 << idx);
-		if (port == 'd')
-			val = _pin_get(&PIND, 1 << idx);
-		printf_P(PSTR("%c%d = %d\n"), port, idx, !!val);
-		return 0;
-	}
+static const cli_cmd_t set_cmds[] PROGMEM = {
+	{ pstr_set_nid, set_nid, NULL },
+	{ pstr_set_tsync, set_tsync, NULL },
+	{ pstr_set_osccal, set_osccal, NULL },
+	{ pstr_set_txpwr, set_txpwr, NULL },
+	{ pstr_set_repeat, set_repeat, NULL },
+	{ pstr_set_led, set_led, NULL },
+	{ pstr_set_rtc, set_rtc, NULL },
+	{ NULL, NULL, NULL }
+};
 
-	if (str_is(cmd, PSTR("status"))) {
-		print_status(ptr);
-		return 0;
-	}
+static const cli_cmd_t echo_cmds[] PROGMEM = {
+	{ pstr_rx, echo_rx, NULL },
+	{ pstr_lsd, echo_lsd, NULL },
+	{ pstr_off, echo_off, NULL },
+	{ NULL, NULL, NULL }
+};
+
+// list of supported commands 
+const cli_cmd_t node_cmds[] PROGMEM = {
+	{ pstr_help, cmd_help, NULL },
+	{ pstr_time, cmd_time, NULL },
+	{ pstr_reset, cmd_reset, NULL },
+	{ pstr_status, cmd_status, NULL },
+	{ pstr_calibrate, cli_calibrate, NULL },
+	{ pstr_set, NULL, set_cmds },
+	{ pstr_poll, cmd_poll, NULL },
+	{ pstr_get, cli_get_pin, NULL },
+	{ pstr_adc, cmd_adc, NULL },
+	{ pstr_sens, cmd_sens, NULL },
+	{ pstr_mem, cli_mem, NULL },
+	{ pstr_echo_cmd, cmd_echo, echo_cmds },
+	{ NULL, NULL, NULL }
+};
 
-	return CLI_ENOTSUP;
+int8_t cli_node(char *buf, void *ptr)
+{
+	return cli_dispatch(node_cmds, buf, ptr);
 }
@@ -35,6 +35,7 @@
 #include "bmp180.h"
 #include "serial.h"
 #include "bmfont.h"
+#include "fmtnum.h"
 #include "rfm12bs.h"
 #include "ossd_i2c.h"
 #include "serial_cli.h"
@@ -83,7 +84,25 @@ rfm12_t rfm12 = {
 #define PIN_INTERACTIVE PB0 // on port B
 #define REPLY_TIMEOUT 60 // time sync reply timeout, must be less than 127 msec
 
+// time sync beacon reception
+#define BEACON_AIR  15 // msec, frame time on air at 9600 bps
+#define BEACON_MISS 2  // missed beacons before time sync is requested
+// RTC phase error after time sync, 1/32 sec timer 2 step and base jitter
+#define SYNC_ERR_BEACON (32 + BEACON_LATE / 2)
+#define SYNC_ERR_REPLY  (32 + 500 / 7)
+
+// RTC drift estimation from beacon arrivals, 0.1 ppm units
+#define DRIFT_TIME    600 // sec, minimum time between beacons
+#define DRIFT_NOISE   20  // msec, offset measurement error
+#define DRIFT_ERR_MIN 30  // temperature changes
+#define DRIFT_ERR_MAX 1000 // RTC crystal tolerance, until drift is measured
+// beacon time sync interval is doubled while RTC drift offset stays within
+// half of the guard band and halved down to tsync if it is out of the band
+#define SYNC_BAND    50  // msec
+#define SYNC_INT_MAX 240 // sessions
+
 #define TIME_TO_POLL(x) (rtc_sec == ((x - 1)*5))
+#define TIME_TO_REPEAT(x) (rtc_sec == ((x + 5)*5 + REPEAT_DELAY))
 
 uint8_t  rt_flags;
 uint8_t  active;
@@ -94,10 +113,13 @@ bmp180_t bmp;
 uint8_t  nid;   // node id
 uint8_t  txpwr; // RFM12 TX power in the lower nibble
 
-// List all attached sensors here
-int8_t poll_bmp180(dnode_t *dval, void *ptr);
-// #if (NODE_ID == 1) // so far all nodes have bmp180 only
-dsens_t sens[] = { {SET_SENS(1,SENS_TEMPER), poll_bmp180, &bmp} };
+static uint8_t  sync_err;   // RTC phase error, msec, 0 if phase is not known
+static uint32_t sync_clock; // rtc_clock of the last time sync
+static uint8_t  beacon_miss;
+static uint8_t  beacon_synced; // last time sync was a beacon
+static uint8_t  sync_int;      // sessions between beacon time syncs
+static int16_t  drift;         // RTC drift estimate, 0.1 ppm
+static uint16_t drift_err;     // drift estimate error, 0.1 ppm
 
 // power save functions
 #define power_twi_disable() (TWCR &= ~_BV(TWEN))
@@ -129,6 +151,8 @@ static void sleep(uint8_t mode)
 	asleep();
 
 	power_timer1_disable(); // our msec timer
+	// timer 2 wakes us up, its registers must be updated before power save
+	while(ASSR & (_BV(OCR2UB) | _BV(TCN2UB)));
 	sleep_enable();
 	sei();
 	sleep_cpu();
@@ -153,15 +177,126 @@ static int8_t rf_receive(rfm12_t *rfm, dnode_t *msg, uint8_t flags)
 	return -1;
 }
 
-static inline void sync_time(dnode_t *dval)
+// RTC phase is set only if the base sent it
+static void sync_time(dnode_t *dval)
 {
+	uint16_t phase = 0xFFFF;
+	if (dval->nid == NODE_TSYNC) // not an ACK with time sync request
+		phase = ts_phase_unpack(dval->raw[0]);
 	ts_unpack(dval);
 	rt_flags |= RT_TSYNCED;
+	beacon_synced = 0;
+
+	sync_err = 0;
+	if (phase != 0xFFFF) {
+		phase += BEACON_AIR;
+		sync_err = SYNC_ERR_REPLY;
+	}
+	// keep timer 2 away from OCR2, compare match is blocked after TCNT2 write
+	if (phase > 900)
+		phase = 900;
+
 	ATOMIC_BLOCK(ATOMIC_FORCEON) {
 		rtc_hour = dval->hour;
 		rtc_min  = dval->min;
 		rtc_sec  = dval->sec;
+		if (sync_err)
+			rtc_set_ms(phase);
+		sync_clock = rtc_clock;
+	}
+	if (sync_err)
+		rtc_set_offset(0);
+}
+
+// beacon arrival msec after RTC tick gives RTC offset from the base,
+// offset not expected by timer 2 ISR is residual drift of trimmed RTC
+static void beacon_sync(dnode_t *msg, uint16_t msec)
+{
+	int16_t  off = msec - (BEACON_DELAY + BEACON_LATE / 2 + BEACON_AIR);
+	int32_t  doff = (int32_t)off * 1000 - rtc_get_offset(); // usec
+	uint16_t aoff = ((doff < 0) ? -doff : doff) / 1000;
+	uint32_t elapsed = rtc_get_clock() - sync_clock;
+
+	if (beacon_synced && (elapsed >= DRIFT_TIME)) {
+		int16_t res = doff * 10 / (int32_t)elapsed;
+		drift += res / 2;
+		rtc_set_drift(drift);
+
+		uint32_t err = ((res < 0) ? -res : res) + DRIFT_NOISE * 10000ul / elapsed;
+		if (err < DRIFT_ERR_MIN)
+			err = DRIFT_ERR_MIN;
+		if (err > DRIFT_ERR_MAX)
+			err = DRIFT_ERR_MAX;
+		drift_err = err;
+
+		if (aoff <= SYNC_BAND / 2) {
+			uint16_t sint = sync_int * 2;
+			sync_int = (sint > SYNC_INT_MAX) ? SYNC_INT_MAX : sint;
+		}
+		else if (aoff > SYNC_BAND)
+			sync_int = (sync_int / 2 < tsync) ? tsync : sync_int / 2;
+	}
+
+	ts_unpack(msg);
+	rt_flags |= RT_TSYNCED;
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		rtc_hour = msg->hour;
+		rtc_min  = msg->min;
+		rtc_sec  = msg->sec;
+		sync_clock = rtc_clock;
+	}
+	rtc_set_offset((int32_t)off * 1000);
+	sync_err = SYNC_ERR_BEACON;
+	beacon_synced = 1;
+}
+
+// once in the beacon second if time sync is due and RTC phase is known
+static uint8_t beacon_due(uint8_t isync)
+{
+	static uint8_t done;
+	uint8_t ts[3];
+
+	rtc_get_time(ts);
+	if (!IS_BEACON(ts[1], ts[0])) {
+		done = 0;
+		return 0;
 	}
+	if (sync_int < tsync)
+		sync_int = tsync;
+	if (done || (isync < sync_int) || !sync_err || (beacon_miss >= BEACON_MISS))
+		return 0;
+	done = 1;
+	return 1;
+}
+
+// radio is turned on only around the expected beacon arrival,
+// the window grows with RTC drift error since the last time sync
+static int8_t beacon_listen(rfm12_t *rfm)
+{
+	dnode_t msg;
+	uint32_t elapsed = rtc_get_clock() - sync_clock;
+	uint32_t guard = sync_err + elapsed * drift_err / 10000;
+	if (guard > 999)
+		guard = 999;
+	uint16_t open  = (guard < BEACON_DELAY) ? BEACON_DELAY - guard : 0;
+	uint16_t close = BEACON_DELAY + BEACON_LATE + BEACON_AIR + guard;
+
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	while((rtc_sec == BEACON_SEC) && (rtc_get_ms() < open))
+		sleep_mode();
+
+	rfm12_cmdrw(rfm, RFM12CMD_STATUS);
+	rfm12_set_mode(rfm, RFM_MODE_RX);
+	rfm12_reset_fifo(rfm);
+	while((rtc_sec == BEACON_SEC) && (rtc_get_ms() < close)) {
+		if (rfm12_receive_data(rfm, &msg, sizeof(dnode_t), rt_flags & RT_RX_ECHO) != sizeof(dnode_t))
+			continue;
+		if (msg.nid == NODE_TSYNC) {
+			beacon_sync(&msg, rtc_tick_age());
+			return 0;
+		}
+	}
+	return -1;
 }
 
 static int8_t process_cmd(rfm12_t *rfm, dnode_t *msg)
@@ -259,16 +394,16 @@ int main(void)
 	isync = eeprom_read_byte(&em_rfm_sync);
 	rfm12_init(rfm, isync, RFM12_BAND_868, 868.0, RFM12_BPS_9600);
 	isync = tsync-1; // re-sync time at the first data poll
+	sync_int = tsync;
+	drift_err = DRIFT_ERR_MAX;
 	rfm12_set_txpwr(rfm, txpwr & RFM12_OPWR_21);
 	mmr_led_off();
 
-	// create "List of Sensors" message
+	// create "List of Sensors" message while registering sensors
 	dval.nid = NODE_TSYNC | SENS_LIST | nid;
 	dval.data.v16 = 0;
-
-	for(uint8_t n = 0; n < sizeof(sens)/sizeof(sens[0]); n++) {
-		set_sens_type(&dval, sens[n].tos_sid & 0x0F, sens[n].tos_sid >> 4);
-	}
+	i2c_init(); // needed for ossd* and bmp180*
+	sens_init(&dval);
 
 	// try to get RTC time from the base
 	for(uint8_t i = 0; i < 5; i++) {
@@ -286,7 +421,6 @@ int main(void)
 	}
 
 	mmr_led_on();
-	i2c_init(); // needed for ossd* and bmp180*
 	// try to init oled display
 	if (ossd_init(OSSD_UPDOWN) == 0) {
 		bmfont_select(BMFONT_8x16);
@@ -296,7 +430,6 @@ int main(void)
 		active |= OLED_ACTIVE;
 	}
 
-	bmp180_init(&bmp);
 	cli_init();
 	rt_flags |= RT_DATA_INIT;
 	dval.stat = rfm12_battery(rfm, RFM_MODE_IDLE, 14);
@@ -309,7 +442,7 @@ int main(void)
 	else {
 		if (active & OLED_ACTIVE)
 			ossd_sleep(1);
-		sleep(SLEEP_MODE_PWR_SAVE);
+		sleep((sens_flags & SENS_KEEP_IO) ? SLEEP_MODE_IDLE : SLEEP_MODE_PWR_SAVE);
 	}
 
 	for(;;) {
@@ -336,34 +469,45 @@ int main(void)
 		uint8_t ttp = TIME_TO_POLL(nid);
 		// check for the second interval if repeat is configured
 		if ((txpwr & RT_TX_REPEAT) && !ttp)
-			ttp = TIME_TO_POLL(nid + 6);
+			ttp = TIME_TO_REPEAT(nid);
 
-		// poll attached sensors once a minute depending on Node ID
+		// poll sensors due this minute, session time depends on Node ID
 		if ((rt_flags & (RT_DATA_POLL | RT_DATA_INIT)) || (ttp && !(rt_flags & RT_DATA_SENT))) {
 			awake();
-			dval.stat &= ~(STAT_LED | STAT_SLEEP);
+			dval.stat &= ~(STAT_LED | STAT_SLEEP | STAT_EOS);
 			if (active & DLED_ACTIVE)
 				dval.stat |= STAT_LED;
 			if (!(active & ACTIVE_MODE))
 				dval.stat |= STAT_SLEEP;
 
-			for(uint8_t n = 0; n < sizeof(sens)/sizeof(sens[0]); n++) {
-				if (active & DLED_ACTIVE)
-					mmr_led_on();
-
-				if (sens[n].poll(&dval, sens[n].data) == 0)
-					dval.nid = SET_NID(nid, n+1);
-
-				if (active & DLED_ACTIVE)
-					mmr_led_off();
-
-				// Local Sensor Data log
-				if ((rt_flags & (RT_LSD_ECHO | RT_DATA_POLL)) && (active & ACTIVE_MODE))
-					print_dval(&dval);
+			// if no sensor is due this minute the last reading is re-sent,
+			// base times out nodes silent for 5 minutes
+			uint8_t due = sens_start(rt_flags & (RT_DATA_POLL | RT_DATA_INIT));
+			if (!due)
+				dval.nid &= ~NODE_TSYNC;
+			for(uint8_t n = 0; ; n++, due >>= 1) {
+				if (due && !(due & 0x01))
+					continue;
+				if (due) {
+					if (active & DLED_ACTIVE)
+						mmr_led_on();
+
+					if (sens_read(n, &dval.data) == 0)
+						dval.nid = SET_NID(nid, n+1);
+
+					if (active & DLED_ACTIVE)
+						mmr_led_off();
+
+					// Local Sensor Data log
+					if ((rt_flags & (RT_LSD_ECHO | RT_DATA_POLL)) && (active & ACTIVE_MODE))
+						print_dval(&dval);
+				}
 
-				if (n == (sizeof(sens)/sizeof(sens[0]) - 1)) {
+				if (due <= 0x01) {
 					dval.stat |= STAT_EOS;
-					if (isync >= tsync || !(rt_flags & RT_TSYNCED)) {
+					// time sync beacon is used if RTC phase is known
+					uint8_t beacon = sync_err && (beacon_miss < BEACON_MISS);
+					if ((isync >= tsync && !beacon) || !(rt_flags & RT_TSYNCED)) {
 						dval.nid |= NODE_TSYNC; // request time sync
 						dval.stat &= ~STAT_VBAT; // update battery voltage
 						dval.stat |= rfm12_battery(rfm, RFM_MODE_IDLE, 14) & STAT_VBAT;
@@ -371,6 +515,8 @@ int main(void)
 				}
 
 				rfm12_send(rfm, &dval, sizeof(dval));
+				if (due <= 0x01)
+					break;
 			}
 
 			// set RFM mode to RX if needed
@@ -399,12 +545,35 @@ int main(void)
 			if (dval.nid & NODE_TSYNC) {
 				dval.nid &= ~NODE_TSYNC;
 				isync = 0;
+				// try beacon again if the base sent RTC phase
+				if (sync_err && beacon_miss)
+					beacon_miss = BEACON_MISS - 1;
 			}
 
 			if (!(active & ACTIVE_MODE))
 				rfm12_set_mode(rfm, RFM_MODE_SLEEP);
 		}
 
+		// listen to the time sync beacon instead of requesting time sync
+		if (beacon_due(isync)) {
+			awake();
+			if (beacon_listen(rfm) == 0) {
+				isync = 0;
+				beacon_miss = 0;
+				dval.stat &= ~STAT_VBAT; // update battery voltage
+				dval.stat |= rfm12_battery(rfm, RFM_MODE_IDLE, 14) & STAT_VBAT;
+			}
+			else
+				beacon_miss++;
+
+			if (active & ACTIVE_MODE) {
+				rfm12_set_mode(rfm, RFM_MODE_RX);
+				rfm12_reset_fifo(rfm);
+			}
+			else
+				rfm12_set_mode(rfm, RFM_MODE_SLEEP);
+		}
+
 		if (rt_flags & RT_OLED_ECHO) {
 			if ((active & ACTIVE_MODE) && (active & OLED_ACTIVE)) {
 				show_time(buf);
@@ -423,7 +592,7 @@ int main(void)
 				if (active & OLED_ACTIVE)
 					ossd_sleep(1);
 			}
-			sleep(SLEEP_MODE_PWR_SAVE);
+			sleep((sens_flags & SENS_KEEP_IO) ? SLEEP_MODE_IDLE : SLEEP_MODE_PWR_SAVE);
 		}
 	}
 }
@@ -432,13 +601,13 @@ void get_rtc_time(char *buf)
 {
 	uint8_t ts[3];
 	rtc_get_time(ts);
-	sprintf_P(buf, PSTR("%02d:%02d:%02d"), ts[2], ts[1], ts[0]);
+	fmt_hms(buf, ts[2], ts[1], ts[0]);
 }
 
 void get_vbat(dnode_t *val, char *buf)
 {
 	uint16_t vbat = 230 + (val->stat & STAT_VBAT)*10;
-	sprintf_P(buf, PSTR("Vbat %d.%02d"), vbat/100, vbat %100);
+	fmt_cent(fmt_str_P(buf, PSTR("Vbat "), 0), vbat);
 }
 
 void print_dval(dnode_t *dval)
@@ -455,10 +624,7 @@ void show_time(char *buf)
 {
 	get_rtc_time(buf);
 	ossd_putlx(2, -1, buf, TEXT_OVERLINE | TEXT_UNDERLINE);
-	int8_t t = bmp.t;
-	if (t & 0x80)
-		t = -(t & 0x7F);
-	sprintf_P(buf, PSTR("T %d.%02d"), t, bmp.tdec);
+	fmt_fixed(fmt_str_P(buf, PSTR("T "), 0), bmp.t, bmp.tdec, 0, 0);
 	ossd_putlx(4, -1, buf, TEXT_UNDERLINE);
 }
 
@@ -475,17 +641,12 @@ void print_status(dnode_t *val)
 		uart_puts_p(PSTR("(is not set) "));
 	uart_puts(buf);
 	printf_P(PSTR(" Uptime %lu sec or %lu:%02ld:%02ld\n"), uptime, uptime / 3600, (uptime / 60) % 60, uptime % 60);
-}
-
-int8_t poll_bmp180(dnode_t *dval, void *ptr)
-{
-	bmp180_t *bmp = ptr;
-	bmp180_poll(bmp, BMP180_T_MODE);
-
-	if (bmp->valid & BMP180_T_VALID) {
-		dval->data.val = bmp->t;
-		dval->data.dec = bmp->tdec;
-		return 0;
+	int16_t dppm = drift;
+	char sign = '+';
+	if (dppm < 0) {
+		sign = '-';
+		dppm = -dppm;
 	}
-	return -1;
+	printf_P(PSTR("RTC drift %c%d.%d ppm, error %u.%u ppm, beacon sync every %u sessions\n"),
+		sign, dppm / 10, dppm % 10, drift_err / 10, drift_err % 10, sync_int);
 }
@@ -23,6 +23,7 @@
 
 #include "rfm12bs.h"
 #include "dnode.h"
+#include "bmp180.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -58,12 +59,40 @@ extern uint8_t EEMEM em_txpwr;
 extern uint8_t EEMEM em_osccal;
 extern uint8_t EEMEM em_rt_flags;
 
+// sensor drivers, stored in EEPROM sensors configuration
+#define SDRV_NONE  0
+#define SDRV_BMP   1 // bmp180 temperature
+#define SDRV_PRESS 2 // bmp180 pressure
+#define SDRV_RHT_T 3 // sht1x/rht03 temperature
+#define SDRV_RHT_H 4 // sht1x/rht03 humidity
+#define SDRV_DS    5 // ds18x20, arg: pin | device index << 5
+#define SDRV_LIGHT 6 // ADC, arg: channel
+#define SDRV_DIGIT 7 // digital port, arg: 0 to 3 for A to D
+#define SDRV_COUNT 8 // INT0 pulse counter
+#define SDRV_NUM   9
+
+#define MAX_SENS 6 // sensor IDs 1 to 6
+
+// sens_flags
+#define SENS_KEEP_IO 0x01 // registered sensor needs I/O clock in sleep mode
+
+typedef struct sens_cfg_s {
+	uint8_t drv;
+	uint8_t arg;    // driver specific: pin, ADC channel, port
+	uint8_t period; // poll interval, minutes
+	uint8_t warmup; // time between start and read, 10 msec units
+} sens_cfg_t;
+
+extern sens_cfg_t EEMEM em_sens[MAX_SENS];
+
 extern rfm12_t rfm12;
+extern bmp180_t bmp;
 extern uint8_t nid;
 extern uint8_t txpwr;
 extern uint8_t tsync;
 extern uint8_t rt_flags;
 extern uint8_t active;
+extern uint8_t sens_flags;
 
 extern uint32_t uptime;
 
@@ -75,6 +104,16 @@ void get_vbat(dnode_t *val, char *buf);
 
 int8_t cli_node(char *buf, void *ptr);
 
+// registers sensors from EEPROM configuration, sets their types in the list
+uint8_t sens_init(dnode_t *list);
+// starts sensors due in this session, all - every registered sensor,
+// returns mask of sensors to read
+uint8_t sens_start(uint8_t all);
+int8_t  sens_read(uint8_t n, dsens_data_t *data);
+void    sens_print(void);
+const char *sens_drv_name(uint8_t drv);
+int8_t  sens_drv_find(const char *name);
+
 #ifdef __cplusplus
 }
 #endif
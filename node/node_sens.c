@@ -0,0 +1,378 @@
+/* Sensors registry for data node
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#include "rht.h"
+#include "pinio.h"
+#include "timer.h"
+#include "ds18x.h"
+#include "bmp180.h"
+
+#include "node_main.h"
+
+// worst case BMP180 pressure conversion, msec
+#define BMP_CONV_TIME 26
+
+// bmp180 temperature every minute by default
+#define SENS_DEFAULT { SDRV_BMP, 0, 1, 0 }
+
+sens_cfg_t EEMEM em_sens[MAX_SENS] = { SENS_DEFAULT };
+
+typedef struct sens_drv_s {
+	const char *name;
+	uint8_t type; // SENS_* type reported in SENS_LIST
+	int8_t (*init)(uint8_t arg);
+	void   (*start)(uint8_t arg); // optional, called before warm-up
+	int8_t (*read)(uint8_t arg, dsens_data_t *data);
+} sens_drv_t;
+
+static sens_cfg_t sens[MAX_SENS];
+static uint8_t sens_cnt[MAX_SENS]; // minutes left till the next poll
+static uint8_t sens_mask;  // registered sensors
+static uint8_t sens_due;   // sensors due in the current minute
+static uint8_t sens_min = 0xFF;
+static uint8_t sens_cycle; // incremented every session
+uint8_t sens_flags;
+
+// bmp180 --------------------------------------------------------------------
+
+static int8_t bmp_init(uint8_t arg __attribute__((unused)))
+{
+	// bmp and press share the chip, the first init result is kept
+	static int8_t ret = 1;
+	if (ret > 0)
+		ret = bmp180_init(&bmp);
+	return ret;
+}
+
+static int8_t bmp_read_t(uint8_t arg __attribute__((unused)), dsens_data_t *data)
+{
+	bmp180_poll(&bmp, BMP180_T_MODE);
+	if (bmp.valid & BMP180_T_VALID) {
+		data->val = bmp.t;
+		data->dec = bmp.tdec;
+		return 0;
+	}
+	return -1;
+}
+
+static int8_t bmp_read_p(uint8_t arg __attribute__((unused)), dsens_data_t *data)
+{
+	// every poll reads the last conversion and starts the next one,
+	// temperature is converted first for pressure compensation
+	bmp.valid &= ~BMP180_P_VALID;
+	for(uint8_t i = 0; i < 3; i++) {
+		bmp180_poll(&bmp, BMP180_P_MODE);
+		if (bmp.valid & BMP180_P_VALID) {
+			data->v16 = bmp.p;
+			return 0;
+		}
+		delay(BMP_CONV_TIME);
+	}
+	return -1;
+}
+
+// sht1x or rht03, type is selected in Makefile -------------------------------
+
+static rht_t rht;
+static uint8_t rht_cycle = 0xFF;
+
+static int8_t rht_sens_init(uint8_t arg __attribute__((unused)))
+{
+	static uint8_t done;
+	if (!done) {
+		done = 1;
+		rht_init();
+	}
+	return 0;
+}
+
+// both T and H are measured once per session
+static void rht_start(uint8_t arg __attribute__((unused)))
+{
+	if (rht_cycle == sens_cycle)
+		return;
+	rht_cycle = sens_cycle;
+#if (RHT_TYPE == RHT_TYPE_SHT10)
+	// measurements alternate between T and H
+	for(uint8_t i = 0; i < 2; i++) {
+		rht_poll(&rht);
+		while(rht_step() == RHT_BUSY);
+	}
+#else
+	rht_poll(&rht);
+#endif
+	rht_get_temperature(&rht);
+	rht_get_humidity(&rht);
+}
+
+static int8_t rht_read_t(uint8_t arg __attribute__((unused)), dsens_data_t *data)
+{
+	if (!(rht.valid & RHT_TVALID))
+		return -1;
+	data->val = rht.temperature.val;
+	data->dec = rht.temperature.dec;
+	return 0;
+}
+
+static int8_t rht_read_h(uint8_t arg __attribute__((unused)), dsens_data_t *data)
+{
+	if (!(rht.valid & RHT_HVALID))
+		return -1;
+	data->val = rht.humidity.val;
+	data->dec = rht.humidity.dec;
+	return 0;
+}
+
+// ds18x20, arg: pin | device index << 5, one pin per node --------------------
+
+static ds_bus_t ds_bus;
+static uint8_t ds_cycle = 0xFF;
+
+static int8_t ds_init(uint8_t arg)
+{
+	uint8_t pin = arg & 0x1F;
+	int8_t ndev = ds_bus.ndev;
+	if (!ndev || ds_bus.pin != pin) {
+		ndev = ds18x_bus_init(&ds_bus, pin, 0);
+		if (ndev < 0)
+			return ndev;
+	}
+	return ((arg >> 5) < ndev) ? 0 : -1;
+}
+
+// all devices on the pin convert at once
+static void ds_start(uint8_t arg __attribute__((unused)))
+{
+	if (ds_cycle == sens_cycle)
+		return;
+	ds_cycle = sens_cycle;
+	ds18x_bus_convert(&ds_bus);
+}
+
+static int8_t ds_read(uint8_t arg, dsens_data_t *data)
+{
+	ds_temp_t t;
+	// returns at once if warm-up was long enough
+	if (ds18x_bus_wait(&ds_bus) != DS18x_EOK)
+		return -1;
+	if (ds18x_bus_read(&ds_bus, arg >> 5, &t, NULL) != DS18x_EOK)
+		return -1;
+	data->val = t.neg ? (-t.val | 0x80) : t.val;
+	data->dec = t.dec * 10;
+	return 0;
+}
+
+// light sensor, arg: ADC channel ---------------------------------------------
+
+static int8_t light_init(uint8_t arg)
+{
+	return (arg < 8) ? 0 : -1;
+}
+
+static int8_t light_read(uint8_t arg, dsens_data_t *data)
+{
+	// ADC is disabled in sleep mode
+	analogReference(VREF_AVCC);
+	data->v16 = analogRead(arg);
+	return 0;
+}
+
+// digital inputs, arg: port 0 to 3 for A to D --------------------------------
+
+static int8_t digit_init(uint8_t arg)
+{
+	return (arg < 4) ? 0 : -1;
+}
+
+static int8_t digit_read(uint8_t arg, dsens_data_t *data)
+{
+	switch(arg) {
+	case 0:
+		data->v16 = PINA;
+		break;
+	case 1:
+		data->v16 = PINB;
+		break;
+	case 2:
+		data->v16 = PINC;
+		break;
+	default:
+		data->v16 = PIND;
+	}
+	return 0;
+}
+
+// pulse counter on INT0 (PD2), pulses since the last poll ---------------------
+
+static volatile uint16_t pulse_count;
+
+ISR(INT0_vect)
+{
+	pulse_count++;
+}
+
+static int8_t count_init(uint8_t arg __attribute__((unused)))
+{
+	pinMode(PND2, INPUT_UP);
+	MCUCR = (MCUCR & ~_BV(ISC00)) | _BV(ISC01); // falling edge
+	GICR |= _BV(INT0);
+	// edges are detected only while I/O clock is running
+	sens_flags |= SENS_KEEP_IO;
+	return 0;
+}
+
+static int8_t count_read(uint8_t arg __attribute__((unused)), dsens_data_t *data)
+{
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		data->v16 = pulse_count;
+		pulse_count = 0;
+	}
+	return 0;
+}
+
+// ----------------------------------------------------------------------------
+
+static const char drv_none[] PROGMEM = "none";
+static const char drv_bmp[] PROGMEM = "bmp";
+static const char drv_press[] PROGMEM = "press";
+static const char drv_rht_t[] PROGMEM = "rht.t";
+static const char drv_rht_h[] PROGMEM = "rht.h";
+static const char drv_ds[] PROGMEM = "ds";
+static const char drv_light[] PROGMEM = "light";
+static const char drv_digit[] PROGMEM = "digit";
+static const char drv_count[] PROGMEM = "count";
+
+static const sens_drv_t sens_drv[SDRV_NUM] PROGMEM = {
+	{ drv_none, 0, NULL, NULL, NULL },
+	{ drv_bmp, SENS_TEMPER, bmp_init, NULL, bmp_read_t },
+	{ drv_press, SENS_PRESS, bmp_init, NULL, bmp_read_p },
+	{ drv_rht_t, SENS_TEMPER, rht_sens_init, rht_start, rht_read_t },
+	{ drv_rht_h, SENS_HUMID, rht_sens_init, rht_start, rht_read_h },
+	{ drv_ds, SENS_TEMPER, ds_init, ds_start, ds_read },
+	{ drv_light, SENS_LIGHT, light_init, NULL, light_read },
+	{ drv_digit, SENS_DIGIT, digit_init, NULL, digit_read },
+	{ drv_count, SENS_COUNT, count_init, NULL, count_read }
+};
+
+const char *sens_drv_name(uint8_t drv)
+{
+	if (drv >= SDRV_NUM)
+		drv = SDRV_NONE;
+	return (const char *)pgm_read_word(&sens_drv[drv].name);
+}
+
+int8_t sens_drv_find(const char *name)
+{
+	for(uint8_t drv = 0; drv < SDRV_NUM; drv++) {
+		if (strcmp_P(name, sens_drv_name(drv)) == 0)
+			return drv;
+	}
+	return -1;
+}
+
+uint8_t sens_init(dnode_t *list)
+{
+	static const sens_cfg_t def PROGMEM = SENS_DEFAULT;
+
+	eeprom_read_block(sens, em_sens, sizeof(sens));
+	// EEPROM was not programmed
+	if (sens[0].drv == 0xFF) {
+		memset(sens, 0, sizeof(sens));
+		memcpy_P(&sens[0], &def, sizeof(def));
+		eeprom_update_block(sens, em_sens, sizeof(sens));
+	}
+
+	sens_mask = 0;
+	for(uint8_t n = 0; n < MAX_SENS; n++) {
+		sens_cfg_t *ps = &sens[n];
+		if (ps->drv == SDRV_NONE || ps->drv >= SDRV_NUM)
+			continue;
+		const sens_drv_t *drv = &sens_drv[ps->drv];
+		int8_t (*init)(uint8_t) = (void *)pgm_read_word(&drv->init);
+		if (init(ps->arg) != 0)
+			continue;
+		if (!ps->period)
+			ps->period = 1;
+		sens_cnt[n] = 1; // poll at the first session
+		sens_mask |= 1 << n;
+		set_sens_type(list, n + 1, pgm_read_byte(&drv->type));
+	}
+	return sens_mask;
+}
+
+uint8_t sens_start(uint8_t all)
+{
+	uint8_t due = sens_mask;
+	if (!all) {
+		// repeated session in the same minute sends the same sensors
+		if (rtc_min != sens_min) {
+			sens_min = rtc_min;
+			sens_due = 0;
+			for(uint8_t n = 0; n < MAX_SENS; n++) {
+				if ((sens_mask & (1 << n)) && (--sens_cnt[n] == 0)) {
+					sens_cnt[n] = sens[n].period;
+					sens_due |= 1 << n;
+				}
+			}
+		}
+		due = sens_due;
+	}
+
+	// start all due sensors and wait for the longest warm-up only
+	uint8_t warmup = 0;
+	sens_cycle++;
+	for(uint8_t n = 0; n < MAX_SENS; n++) {
+		if (!(due & (1 << n)))
+			continue;
+		void (*start)(uint8_t) = (void *)pgm_read_word(&sens_drv[sens[n].drv].start);
+		if (start)
+			start(sens[n].arg);
+		if (sens[n].warmup > warmup)
+			warmup = sens[n].warmup;
+	}
+	if (warmup)
+		delay(warmup * 10);
+
+	return due;
+}
+
+int8_t sens_read(uint8_t n, dsens_data_t *data)
+{
+	if (!(sens_mask & (1 << n)))
+		return -1;
+	int8_t (*read)(uint8_t, dsens_data_t *) = (void *)pgm_read_word(&sens_drv[sens[n].drv].read);
+	return read(sens[n].arg, data);
+}
+
+void sens_print(void)
+{
+	for(uint8_t n = 0; n < MAX_SENS; n++) {
+		sens_cfg_t cfg;
+		eeprom_read_block(&cfg, &em_sens[n], sizeof(cfg));
+		printf_P(PSTR("%u %-5S arg %3u period %3u min warmup %4u msec%s\n"),
+			n + 1, sens_drv_name(cfg.drv), cfg.arg, cfg.period, cfg.warmup * 10,
+			(sens_mask & (1 << n)) ? "" : " (off)");
+	}
+}
@@ -157,6 +157,7 @@ int main(void)
 
 	// turn on RDS
 	ns741_rds(1);
+	ns741_rds_irq(1);
 	ns_rt_flags |= NS741_RDS;
 	ns_rt_flags |= RDS_RESET; // set reset flag so next poll of RHT will start new text
 
@@ -168,11 +169,12 @@ int main(void)
 	cli_init();
 
 	for(;;) {
-		// RDSPIN is low when NS741 is ready to transmit next RDS frame
-		if (mmr_rdsint_get() == LOW)
-			ns741_rds_isr();
+		// RDS blocks are sent from INT0, only debug output and recovery here
+		ns741_rds_poll();
 		// process serial port commands
 		cli_interact(cli_radio, &rht);
+		// T/RH measurement steps, each one is short
+		rht_step();
 
 		// once-a-second checks
 		if (tenth_clock >= 10) {
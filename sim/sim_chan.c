@@ -0,0 +1,200 @@
+/* Radio channel model for shDAN simulator
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <math.h>
+#include <string.h>
+#include <util/crc16.h>
+
+#include "sim_main.h"
+
+#define TX_COLLIDED 0x01
+#define TX_NOISE    0x02
+
+// frame on air, one per device as radios are half-duplex
+typedef struct sim_tx_s {
+	int64_t t_start;
+	int64_t t_end;
+	uint8_t flags;
+	uint8_t frame[FRAME_LEN];
+} sim_tx_t;
+
+static sim_tx_t tx[SIM_MAX_DEV];
+static uint8_t  tx_on[SIM_MAX_DEV];
+static int64_t  airtime;
+static int64_t  noise_end;
+static double   ber_log; // log(1 - ber) for error intervals
+uint32_t chan_bursts;
+
+static int64_t sim_exp(double mean)
+{
+	return (int64_t)(-log(sim_urand()) * mean);
+}
+
+void chan_init(void)
+{
+	// RFM12 bit rate is 10 MHz/29/(R + 1), cs bit is never set
+	double bps = 10000000.0 / 29.0 / (cfg.rate + 1);
+	airtime = (int64_t)(FRAME_LEN * 8 * 1e6 / bps);
+	ber_log = (cfg.ber > 0) ? log(1.0 - cfg.ber) : 0;
+	noise_end = 0;
+	if (cfg.noise > 0)
+		sim_sched(sim_exp(3600.0 * SIM_SEC / cfg.noise), EV_NOISE, 0, 0);
+}
+
+int64_t chan_airtime(void)
+{
+	return airtime;
+}
+
+void radio_set(sim_dev_t *d, uint8_t state)
+{
+	if (d->radio != RADIO_OFF)
+		d->st.radio_on += sim_now - d->radio_ts;
+	d->radio = state;
+	d->radio_ts = sim_now;
+}
+
+// same bytes and crc as rfm12_send()
+static void frame_build(uint8_t *frame, const dnode_t *msg)
+{
+	const uint8_t *data = (const uint8_t *)msg;
+	uint8_t len = sizeof(dnode_t);
+	uint8_t crc = _crc_ibutton_update(FRAME_SYNC, len);
+
+	for(uint8_t i = 0; i < FRAME_PRELEN; i++)
+		*frame++ = 0xAA;
+	*frame++ = 0x2D;
+	*frame++ = FRAME_SYNC;
+	*frame++ = len;
+	for(uint8_t i = 0; i < len; i++) {
+		crc = _crc_ibutton_update(crc, data[i]);
+		*frame++ = data[i] ^ 0xA5;
+	}
+	*frame++ = crc;
+	for(uint8_t i = 0; i < (FRAME_PRELEN / 2); i++)
+		*frame++ = 0x55;
+}
+
+// as rfm12_receive_data(), returns 0 if sync, length and crc are valid
+static int8_t frame_parse(const uint8_t *frame, dnode_t *msg)
+{
+	uint8_t *data = (uint8_t *)msg;
+	uint8_t len = sizeof(dnode_t);
+
+	frame += FRAME_PRELEN;
+	if (frame[0] != 0x2D || frame[1] != FRAME_SYNC || frame[2] != len)
+		return -1;
+	uint8_t crc = _crc_ibutton_update(FRAME_SYNC, len);
+	for(uint8_t i = 0; i < len; i++) {
+		data[i] = frame[3 + i] ^ 0xA5;
+		crc = _crc_ibutton_update(crc, data[i]);
+	}
+	return (crc == frame[3 + len]) ? 0 : -1;
+}
+
+// flip bits after preamble, errors in preamble do not matter
+static void frame_errors(uint8_t *frame)
+{
+	if (cfg.ber <= 0)
+		return;
+	const int64_t nbits = (FRAME_LEN - FRAME_PRELEN) * 8;
+	for(int64_t bit = 0;; bit++) {
+		bit += (int64_t)(log(sim_urand()) / ber_log);
+		if (bit >= nbits)
+			break;
+		frame[FRAME_PRELEN + bit / 8] ^= 0x80 >> (bit % 8);
+	}
+}
+
+void chan_send(sim_dev_t *d, dnode_t *msg)
+{
+	sim_tx_t *ptx = &tx[d->id];
+
+	radio_set(d, RADIO_TX);
+	ptx->t_start = sim_now + TX_START;
+	ptx->t_end = ptx->t_start + airtime;
+	ptx->flags = (ptx->t_start < noise_end) ? TX_NOISE : 0;
+	frame_build(ptx->frame, msg);
+
+	// no capture effect, overlapping frames are lost for everybody
+	for(uint8_t i = 0; i < SIM_MAX_DEV; i++) {
+		if (!tx_on[i] || tx[i].t_end <= ptx->t_start)
+			continue;
+		tx[i].flags |= TX_COLLIDED;
+		ptx->flags |= TX_COLLIDED;
+	}
+	tx_on[d->id] = 1;
+	d->st.frames++;
+	sim_sched(ptx->t_end, EV_TX_END, d->id, 0);
+}
+
+void chan_tx_end(uint8_t src)
+{
+	sim_tx_t *ptx = &tx[src];
+	sim_dev_t *s = &dev[src];
+	const int64_t preamble = airtime * FRAME_PRELEN / FRAME_LEN;
+
+	tx_on[src] = 0;
+	for(uint8_t i = 0; i <= cfg.nodes; i++) {
+		sim_dev_t *r = &dev[i];
+		// receiver needs the preamble to lock
+		if (i == src || r->radio != RADIO_RX || !dev_listening(r) ||
+			r->radio_ts > ptx->t_start + preamble)
+			continue;
+
+		// losses are counted for frames sent to the base only
+		sim_stat_t *st = (i == SIM_BASE) ? &s->st : NULL;
+		if (ptx->flags & (TX_COLLIDED | TX_NOISE)) {
+			if (st && (ptx->flags & TX_COLLIDED))
+				st->coll++;
+			else if (st)
+				st->noise++;
+			continue;
+		}
+
+		uint8_t frame[FRAME_LEN];
+		dnode_t msg;
+		memcpy(frame, ptx->frame, FRAME_LEN);
+		frame_errors(frame);
+		if (frame_parse(frame, &msg) != 0) {
+			if (st)
+				st->crc++;
+			continue;
+		}
+		if (st && memcmp(frame, ptx->frame, FRAME_LEN - FRAME_PRELEN / 2))
+			st->bad++;
+
+		if (i == SIM_BASE)
+			base_recv(r, &msg, s);
+		else
+			node_recv(r, &msg);
+	}
+	dev_tx_done(s);
+}
+
+void chan_noise(void)
+{
+	int64_t end = sim_now + sim_exp(cfg.noise_ms * SIM_MS);
+	if (end > noise_end)
+		noise_end = end;
+	chan_bursts++;
+	for(uint8_t i = 0; i < SIM_MAX_DEV; i++) {
+		if (tx_on[i] && tx[i].t_start < end)
+			tx[i].flags |= TX_NOISE;
+	}
+	sim_sched(sim_now + sim_exp(3600.0 * SIM_SEC / cfg.noise), EV_NOISE, 0, 0);
+}
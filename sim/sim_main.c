@@ -0,0 +1,339 @@
+/* Discrete-event simulator of shDAN - Data Acquisition Network
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "rfm12bs.h"
+#include "sim_main.h"
+
+sim_cfg_t cfg = {
+	.nodes    = 6,
+	.nsens    = 1,
+	.period   = { 1, 1, 1, 1, 1, 1 },
+	.rate     = RFM12_BPS_9600,
+	.repeat   = 1,
+	.tsync    = 20,
+	.beacon   = 1,
+	.days     = 100,
+	.read_ms  = 5,
+	.turn_ms  = 2,
+	.ber      = 1e-5,
+	.noise    = 0,
+	.noise_ms = 20,
+	.drift    = 50,
+	.base_ppm = 0,
+	.seed     = 1
+};
+
+sim_dev_t dev[SIM_MAX_DEV];
+int64_t   sim_now;
+
+typedef struct sim_ev_s {
+	int64_t  t;
+	uint32_t seq;
+	uint8_t  type;
+	uint8_t  arg;
+} sim_ev_t;
+
+// binary heap of pending events
+static sim_ev_t *evq;
+static uint32_t nev, evq_size;
+static uint64_t nevents;
+
+static const struct {
+	uint16_t bps;
+	uint8_t  rate;
+} rates[] = {
+	{  2400, RFM12_BPS_2400 },
+	{  4800, RFM12_BPS_4800 },
+	{  9600, RFM12_BPS_9600 },
+	{ 14400, RFM12_BPS_14400 },
+	{ 38400, RFM12_BPS_38400 },
+	{ 57600, RFM12_BPS_57600 },
+};
+
+void sim_sched(int64_t t, uint8_t type, uint8_t arg, uint32_t seq)
+{
+	if (nev == evq_size) {
+		evq_size = evq_size ? evq_size * 2 : 64;
+		evq = realloc(evq, evq_size * sizeof(sim_ev_t));
+		if (!evq) {
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+	}
+	uint32_t i = nev++;
+	while(i) {
+		uint32_t parent = (i - 1) / 2;
+		if (evq[parent].t <= t)
+			break;
+		evq[i] = evq[parent];
+		i = parent;
+	}
+	evq[i].t = t;
+	evq[i].seq = seq;
+	evq[i].type = type;
+	evq[i].arg = arg;
+}
+
+static sim_ev_t sim_pop(void)
+{
+	sim_ev_t ev = evq[0];
+	sim_ev_t last = evq[--nev];
+	uint32_t i = 0;
+	for(;;) {
+		uint32_t child = 2 * i + 1;
+		if (child >= nev)
+			break;
+		if ((child + 1 < nev) && (evq[child + 1].t < evq[child].t))
+			child++;
+		if (last.t <= evq[child].t)
+			break;
+		evq[i] = evq[child];
+		i = child;
+	}
+	evq[i] = last;
+	return ev;
+}
+
+void dev_timer(sim_dev_t *d, int64_t t)
+{
+	sim_sched(t, EV_TIMER, d->id, ++d->seq);
+}
+
+// xorshift32, reproducible for the same seed
+static uint32_t rnd_state;
+
+uint32_t sim_rand(void)
+{
+	rnd_state ^= rnd_state << 13;
+	rnd_state ^= rnd_state >> 17;
+	rnd_state ^= rnd_state << 5;
+	return rnd_state;
+}
+
+double sim_urand(void)
+{
+	return (sim_rand() + 1.0) / 4294967296.0;
+}
+
+double dev_clock(sim_dev_t *d)
+{
+	return d->clk_off + (sim_now - d->clk_ref) * (1.0 + (d->ppm - d->trim) * 1e-6) / SIM_SEC;
+}
+
+int64_t dev_clock_at(sim_dev_t *d, double local)
+{
+	double t = (local - d->clk_off) * SIM_SEC / (1.0 + (d->ppm - d->trim) * 1e-6);
+	return d->clk_ref + (int64_t)(t + 0.5);
+}
+
+void dev_set_clock(sim_dev_t *d, double local)
+{
+	d->clk_ref = sim_now;
+	d->clk_off = local;
+}
+
+static void usage(const char *name)
+{
+	printf("usage: %s [options]\n", name);
+	printf("  -n N    data nodes, 1-%u (%u)\n", MAX_DNODE_NUM, cfg.nodes);
+	printf("  -s N    sensors per node, 1-%u (%u)\n", MAX_SENSORS, cfg.nsens);
+	printf("  -m LIST sensor poll periods in minutes, the last one repeats (1)\n");
+	printf("  -d N    days to simulate (%u)\n", cfg.days);
+	printf("  -r BPS  2400, 4800, 9600, 14400, 38400 or 57600 (9600)\n");
+	printf("  -R 0|1  TX repeat for NIDs 1-6 (%u)\n", cfg.repeat);
+	printf("  -t N    time sync every N sessions (%u)\n", cfg.tsync);
+	printf("  -B 0|1  time sync beacons and RTC phase from the base (%u)\n", cfg.beacon);
+	printf("  -b BER  bit error rate (%g)\n", cfg.ber);
+	printf("  -N N    noise bursts per hour (%g)\n", cfg.noise);
+	printf("  -L MS   average noise burst length (%g)\n", cfg.noise_ms);
+	printf("  -p PPM  nodes RTC drift range, +-ppm (%g)\n", cfg.drift);
+	printf("  -P PPM  base RTC drift (%g)\n", cfg.base_ppm);
+	printf("  -S N    random seed (%u)\n", cfg.seed);
+}
+
+static int8_t set_rate(const char *arg)
+{
+	uint32_t bps = atoi(arg);
+	for(uint8_t i = 0; i < sizeof(rates)/sizeof(rates[0]); i++) {
+		if (rates[i].bps == bps) {
+			cfg.rate = rates[i].rate;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+// comma separated periods, the last one is used for the rest of sensors
+static int set_period(const char *arg)
+{
+	uint8_t n = 0;
+	char *end;
+	while(n < MAX_SENSORS) {
+		long period = strtol(arg, &end, 10);
+		if (end == arg || period < 1 || period > 255)
+			return -1;
+		cfg.period[n++] = (uint8_t)period;
+		if (*end != ',')
+			break;
+		arg = end + 1;
+	}
+	if (*end)
+		return -1;
+	for(; n < MAX_SENSORS; n++)
+		cfg.period[n] = cfg.period[n - 1];
+	return 0;
+}
+
+static void report(double wall)
+{
+	sim_stat_t sum;
+	memset(&sum, 0, sizeof(sum));
+
+	printf("%u nodes, %u days, %.0f bps, frame %.2f ms, BER %g, noise %g/h %g ms, "
+		"drift +-%g ppm, tsync %u, repeat %s, beacon %s\n",
+		cfg.nodes, cfg.days, 10000000.0 / 29.0 / (cfg.rate + 1), chan_airtime() / 1000.0,
+		cfg.ber, cfg.noise, cfg.noise_ms, cfg.drift, cfg.tsync, cfg.repeat ? "on" : "off",
+		cfg.beacon ? "on" : "off");
+	printf("NID    ppm sessions readings delivered   ratio  coll noise   crc  bad  late  gaps"
+		"  sync ok/req  bad  bcn ok/miss  latency ms avg/max  clk err ms avg/max  radio ms/day\n");
+
+	for(uint8_t i = 0; i <= cfg.nodes; i++) {
+		sim_stat_t *st = &dev[i].st;
+		radio_set(&dev[i], RADIO_OFF);
+		if (i == SIM_BASE)
+			continue;
+		printf("%3u %+6.1f %8u %8u  %8u %7.3f%% %5u %5u %5u %4u %5u %5u %6u/%-6u %4u %6u/%-5u %9.1f/%-9.1f %8.1f/%-8.1f %10.1f\n",
+			i, dev[i].ppm, st->sess, st->items, st->dlvd,
+			st->items ? 100.0 * st->dlvd / st->items : 0.0,
+			st->coll, st->noise, st->crc, st->bad, st->late, st->gaps,
+			st->sync_ok, st->sync_req, st->sync_bad, st->bcn_ok, st->bcn_miss,
+			st->dlvd ? st->lat_sum / 1000.0 / st->dlvd : 0.0, st->lat_max / 1000.0,
+			st->nerr ? st->err_sum * 1000.0 / st->nerr : 0.0, st->err_max * 1000.0,
+			st->radio_on / 1000.0 / cfg.days);
+		sum.items += st->items;
+		sum.dlvd += st->dlvd;
+		sum.coll += st->coll;
+		sum.noise += st->noise;
+		sum.crc += st->crc;
+		sum.bad += st->bad;
+		sum.late += st->late;
+		sum.gaps += st->gaps;
+	}
+
+	printf("total: %u of %u readings delivered (%.3f%%), lost: %u collisions, %u noise, %u crc, "
+		"%u bad frames passed crc, %u late, %u gaps, %u noise bursts\n",
+		sum.dlvd, sum.items, sum.items ? 100.0 * sum.dlvd / sum.items : 0.0,
+		sum.coll, sum.noise, sum.crc, sum.bad, sum.late, sum.gaps, chan_bursts);
+	printf("base radio on %.1f%%, %u frames sent, %u beacons, %u skipped, %llu events in %.2f sec\n",
+		100.0 * dev[SIM_BASE].st.radio_on / (cfg.days * SIM_DAY),
+		dev[SIM_BASE].st.frames, dev[SIM_BASE].st.bcn_ok, dev[SIM_BASE].st.bcn_miss,
+		(unsigned long long)nevents, wall);
+}
+
+int main(int argc, char **argv)
+{
+	int opt;
+
+	while((opt = getopt(argc, argv, "n:s:m:d:r:R:t:B:b:N:L:p:P:S:h")) != -1) {
+		switch(opt) {
+		case 'n': cfg.nodes = atoi(optarg); break;
+		case 's': cfg.nsens = atoi(optarg); break;
+		case 'd': cfg.days = atoi(optarg); break;
+		case 'R': cfg.repeat = atoi(optarg); break;
+		case 't': cfg.tsync = atoi(optarg); break;
+		case 'B': cfg.beacon = atoi(optarg); break;
+		case 'b': cfg.ber = atof(optarg); break;
+		case 'N': cfg.noise = atof(optarg); break;
+		case 'L': cfg.noise_ms = atof(optarg); break;
+		case 'p': cfg.drift = atof(optarg); break;
+		case 'P': cfg.base_ppm = atof(optarg); break;
+		case 'S': cfg.seed = atoi(optarg); break;
+		case 'm':
+			if (set_period(optarg) == 0)
+				break;
+			usage(argv[0]);
+			return 1;
+		case 'r':
+			if (set_rate(optarg) == 0)
+				break;
+			/* fall through */
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (!cfg.nodes || cfg.nodes > MAX_DNODE_NUM || !cfg.nsens ||
+		cfg.nsens > MAX_SENSORS || !cfg.days || !cfg.tsync) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	rnd_state = cfg.seed ? cfg.seed : 1;
+	memset(dev, 0, sizeof(dev));
+	for(uint8_t i = 0; i <= cfg.nodes; i++)
+		dev[i].id = i;
+
+	sim_now = 0;
+	chan_init();
+	base_init(&dev[SIM_BASE]);
+	for(uint8_t i = 1; i <= cfg.nodes; i++)
+		node_init(&dev[i]);
+
+	clock_t start = clock();
+	const int64_t end = cfg.days * SIM_DAY;
+	while(nev) {
+		sim_ev_t ev = sim_pop();
+		if (ev.t > end)
+			break;
+		sim_now = ev.t;
+		nevents++;
+
+		switch(ev.type) {
+		case EV_TIMER: {
+			sim_dev_t *d = &dev[ev.arg];
+			if (ev.seq != d->seq)
+				break;
+			if (ev.arg == SIM_BASE)
+				base_timer(d);
+			else
+				node_timer(d);
+			break;
+		}
+		case EV_TX_END:
+			chan_tx_end(ev.arg);
+			break;
+		case EV_NOISE:
+			chan_noise();
+			break;
+		case EV_BEACON:
+			base_beacon(&dev[SIM_BASE]);
+			break;
+		}
+	}
+	sim_now = end;
+
+	report((double)(clock() - start) / CLOCKS_PER_SEC);
+	free(evq);
+	return 0;
+}
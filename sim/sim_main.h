@@ -0,0 +1,192 @@
+/* Discrete-event simulator of shDAN - Data Acquisition Network
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SIM_MAIN_H
+#define SIM_MAIN_H
+
+#include <stdint.h>
+
+#include "dnode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // to trick VisualAssist
+}
+#endif
+#endif
+
+// simulation time is true time in usec
+#define SIM_MS  1000LL
+#define SIM_SEC 1000000LL
+#define SIM_DAY (86400LL * SIM_SEC)
+
+#define SIM_BASE    0 // device 0 is the base station, 1-12 data nodes
+#define SIM_MAX_DEV (MAX_DNODE_NUM + 1)
+
+// frame as sent by rfm12_send(): preamble, 0x2D, sync, len, data, crc, tail
+#define FRAME_PRELEN 4
+#define FRAME_SYNC   0xD4
+#define FRAME_LEN    (FRAME_PRELEN + 3 + sizeof(dnode_t) + 1 + FRAME_PRELEN/2)
+
+// timing constants of the firmware and RFM12
+#define TX_START      250  // synthesizer and PA start-up, usec
+#define REPLY_TIMEOUT 60   // node_main.c reply window, msec
+#define BOOT_TRIES    5    // node_main.c time sync attempts on boot
+#define BOOT_DELAY    217  // msec between boot attempts
+#define BEACON_AIR    15   // node_main.c beacon reception constants
+#define BEACON_MISS   2
+#define SYNC_ERR_BEACON (32 + BEACON_LATE / 2)
+#define SYNC_ERR_REPLY  (32 + 500 / 7)
+#define DRIFT_TIME    600  // node_main.c drift estimation, 0.1 ppm units
+#define DRIFT_NOISE   20
+#define DRIFT_ERR_MIN 30
+#define DRIFT_ERR_MAX 1000
+#define SYNC_BAND     50
+#define SYNC_INT_MAX  240
+
+// radio states for radio-on time
+#define RADIO_OFF 0 // sleep or idle, crystal only
+#define RADIO_RX  1
+#define RADIO_TX  2
+
+// event types
+#define EV_TIMER  0 // device timer, arg: device
+#define EV_TX_END 1 // end of frame on air, arg: device
+#define EV_NOISE  2 // noise burst
+#define EV_BEACON 3 // base time sync beacon
+
+typedef struct sim_cfg_s {
+	uint8_t  nodes;    // data nodes, NID 1 to nodes
+	uint8_t  nsens;    // sensors per node
+	uint8_t  period[MAX_SENSORS]; // sensor poll periods, minutes
+	uint8_t  rate;     // RFM12_BPS_* value
+	uint8_t  repeat;   // RT_TX_REPEAT, used by NIDs 1-6 only
+	uint8_t  tsync;    // em_tsync, sessions between time sync requests
+	uint8_t  beacon;   // base sends time sync beacons and RTC phase
+	uint16_t days;
+	uint16_t read_ms;  // sensor read time
+	uint16_t turn_ms;  // base reply turnaround
+	double   ber;      // bit error rate
+	double   noise;    // noise bursts per hour
+	double   noise_ms; // average noise burst length
+	double   drift;    // nodes RTC drift, uniform in +-ppm
+	double   base_ppm; // base RTC drift
+	uint32_t seed;
+} sim_cfg_t;
+
+typedef struct sim_stat_s {
+	uint32_t sess;     // data sessions
+	uint32_t frames;   // frames sent
+	uint32_t items;    // sensor readings to deliver
+	uint32_t dlvd;     // readings received by the base at least once
+	uint32_t coll;     // frames lost in collisions
+	uint32_t noise;    // frames lost in noise bursts
+	uint32_t crc;      // frames lost to bit errors
+	uint32_t bad;      // frames with bit errors passed CRC
+	uint32_t late;     // frames received outside NID's slot
+	uint32_t sync_req;
+	uint32_t sync_ok;
+	uint32_t sync_bad; // clock set from a data frame
+	uint32_t bcn_ok;   // node: beacons received, base: sent
+	uint32_t bcn_miss; // node: beacon windows missed, base: late beacons
+	uint32_t gaps;     // base heard nothing from the node for 2 minutes or more
+	uint32_t nerr;     // clock error samples
+	int64_t  lat_sum;
+	int64_t  lat_max;
+	int64_t  radio_on; // RX and TX time
+	double   err_sum;  // clock error vs base at session start, sec
+	double   err_max;
+} sim_stat_t;
+
+typedef struct sim_dev_s {
+	uint8_t  id;
+	uint8_t  step;     // firmware step, see sim_node.c
+	uint32_t seq;      // timer events with other seq are stale
+	uint8_t  radio;
+	int64_t  radio_ts; // radio state change time
+	// RTC: local = clk_off + (t - clk_ref)*(1 + (ppm - trim)/1e6), sec
+	double   ppm;
+	double   trim;     // drift estimate set by rtc_set_drift()
+	double   clk_off;
+	int64_t  clk_ref;
+	int64_t  tick;     // local second the timer is set for
+	// node_main.c state
+	uint8_t  rt_flags;
+	uint8_t  isync;
+	uint8_t  sync_err; // RTC phase error, msec, 0 if phase is not known
+	uint8_t  beacon_miss;
+	uint16_t bcn_close; // beacon window end, msec after the tick
+	double   sync_clk;  // local time of the last time sync
+	uint8_t  beacon_synced;
+	uint8_t  sync_int;
+	int16_t  drift;     // 0.1 ppm
+	double   sync_off;  // RTC offset left after beacon correction, msec
+	uint16_t drift_err;
+	uint8_t  boot;     // boot attempts
+	uint8_t  due;      // sensors left in the session
+	uint8_t  sens;     // sensor being read
+	uint8_t  sens_min;
+	uint8_t  sens_due;
+	uint8_t  sens_cnt[MAX_SENSORS];
+	uint8_t  alive;    // no sensor was due, last reading is re-sent
+	dnode_t  dval;
+	uint32_t item;     // reading id: local minute + 1
+	uint32_t item_cnt[MAX_SENSORS]; // last counted reading
+	uint32_t item_rx[MAX_SENSORS];  // last reading received by the base
+	int64_t  t_data;   // true time of the reading
+	int64_t  last_rx;  // base: last frame from this node
+	dnode_t  reply;    // base: time sync reply
+	sim_stat_t st;
+} sim_dev_t;
+
+extern sim_cfg_t cfg;
+extern sim_dev_t dev[SIM_MAX_DEV];
+extern int64_t   sim_now;
+
+// sim_main.c
+void     sim_sched(int64_t t, uint8_t type, uint8_t arg, uint32_t seq);
+void     dev_timer(sim_dev_t *d, int64_t t);
+uint32_t sim_rand(void);
+double   sim_urand(void); // (0,1]
+double   dev_clock(sim_dev_t *d); // local time now, sec
+int64_t  dev_clock_at(sim_dev_t *d, double local); // true time of local time
+void     dev_set_clock(sim_dev_t *d, double local);
+
+// sim_chan.c
+void    chan_init(void);
+int64_t chan_airtime(void); // frame time on air, usec
+void    chan_send(sim_dev_t *d, dnode_t *msg);
+void    chan_tx_end(uint8_t src);
+void    chan_noise(void);
+void    radio_set(sim_dev_t *d, uint8_t state);
+extern uint32_t chan_bursts;
+
+// sim_node.c
+void node_init(sim_dev_t *d);
+void node_timer(sim_dev_t *d);
+void node_recv(sim_dev_t *d, dnode_t *msg);
+void base_init(sim_dev_t *d);
+void base_timer(sim_dev_t *d);
+void base_recv(sim_dev_t *d, dnode_t *msg, sim_dev_t *src);
+void base_beacon(sim_dev_t *d);
+void dev_tx_done(sim_dev_t *d);
+uint8_t dev_listening(sim_dev_t *d);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
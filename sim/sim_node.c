@@ -0,0 +1,564 @@
+/* Data node and base station models for shDAN simulator,
+   step by step copies of node_main.c main loop and base io_handler()
+
+   Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <math.h>
+#include <stddef.h>
+
+#include "sim_main.h"
+
+// node_main.h runtime flags
+#define RT_TSYNCED   0x02
+#define RT_DATA_SENT 0x04
+#define RT_DATA_INIT 0x10
+
+// node firmware steps
+#define NODE_BOOT    0 // send SENS_LIST with time sync request
+#define NODE_BOOT_RX 1 // wait for reply
+#define NODE_BOOT_DL 2 // delay(217) before the next attempt
+#define NODE_SLEEP   3 // wake up on RTC tick
+#define NODE_READ    4 // sensor read in progress
+#define NODE_SEND    5
+#define NODE_RX      6 // reply window after the session
+#define NODE_BCN_WAIT 7 // beacon second, waiting for the window
+#define NODE_BCN_RX  8 // beacon window
+
+// base steps
+#define BASE_RX      0 // io_handler() polls radio
+#define BASE_REPLY   1 // preparing time sync reply
+#define BASE_SEND    2
+
+#define TIME_TO_POLL(x) (sec == ((x - 1)*5))
+#define TIME_TO_REPEAT(x) (sec == ((x + 5)*5 + REPEAT_DELAY))
+
+static uint8_t node_ttp(sim_dev_t *d, int64_t tick)
+{
+	uint8_t sec = ((tick % 60) + 60) % 60;
+	uint8_t ttp = TIME_TO_POLL(d->id);
+	// repeat supported only for NIDs in 1-6 range
+	if (cfg.repeat && (d->id <= 6) && !ttp)
+		ttp = TIME_TO_REPEAT(d->id);
+	return ttp;
+}
+
+// beacon_due()
+static uint8_t node_beacon_due(sim_dev_t *d, int64_t tick)
+{
+	uint8_t sec = ((tick % 60) + 60) % 60;
+	uint8_t min = (((tick / 60) % 60) + 60) % 60;
+	if (!IS_BEACON(min, sec) || !(d->rt_flags & RT_TSYNCED))
+		return 0;
+	if (d->sync_int < cfg.tsync)
+		d->sync_int = cfg.tsync;
+	return (d->isync >= d->sync_int) && d->sync_err && (d->beacon_miss < BEACON_MISS);
+}
+
+// local time after the tick when rtc_get_ms() reaches msec
+static double rtc_ms_at(uint16_t msec)
+{
+	return ((msec * 4u + 124) / 125) / 32.0;
+}
+
+// sleep till the next RTC tick with a session or beacon, ticks without
+// them only clear RT_DATA_SENT
+static void node_sleep(sim_dev_t *d)
+{
+	radio_set(d, RADIO_OFF);
+	d->step = NODE_SLEEP;
+	// timer fires within a usec of the tick, local time may be just below it
+	int64_t tick = (int64_t)floor(dev_clock(d) + 1e-3) + 1;
+	if (!(d->rt_flags & RT_DATA_INIT)) {
+		while(!node_ttp(d, tick) && !node_beacon_due(d, tick)) {
+			d->rt_flags &= ~RT_DATA_SENT;
+			tick++;
+		}
+	}
+	d->tick = tick;
+	dev_timer(d, dev_clock_at(d, tick));
+}
+
+static void sync_time(sim_dev_t *d, dnode_t *msg)
+{
+	dnode_t ts = *msg;
+	uint16_t phase = 0xFFFF;
+	if (msg->nid == NODE_TSYNC)
+		phase = ts_phase_unpack(msg->raw[0]);
+	ts_unpack(&ts);
+	d->rt_flags |= RT_TSYNCED;
+	if (msg->nid != NODE_TSYNC)
+		d->st.sync_bad++;
+
+	d->beacon_synced = 0;
+	d->sync_err = 0;
+	if (phase != 0xFFFF) {
+		phase += BEACON_AIR;
+		d->sync_err = SYNC_ERR_REPLY;
+	}
+	if (phase > 900)
+		phase = 900;
+
+	// rtc_hour, rtc_min and rtc_sec are set, timer 2 keeps its phase
+	// unless the base sent it, day is the one closest to the base time
+	double local = dev_clock(d);
+	double frac = local - floor(local);
+	if (d->sync_err)
+		frac = ((phase * 4u) / 125) / 32.0;
+	double sec = ts.hour * 3600.0 + ts.min * 60.0 + ts.sec + frac;
+	double base = dev_clock(&dev[SIM_BASE]);
+	double day = floor(base / 86400.0) * 86400.0;
+	double t = day + sec;
+	if (t - base > 43200.0)
+		t -= 86400.0;
+	else if (base - t > 43200.0)
+		t += 86400.0;
+	dev_set_clock(d, t);
+	d->sync_clk = t;
+}
+
+// beacon_sync(), msec after the tick are counted by timer 1, RC oscillator
+// error is not simulated. Timer 2 trim is continuous here, offset is corrected
+// in 1/32 sec steps leaving RTC behind by less than a step
+static void beacon_sync(sim_dev_t *d)
+{
+	double local = dev_clock(d);
+	uint16_t msec = (uint16_t)floor((local - d->tick) * 1000.0);
+	int16_t off = msec - (BEACON_DELAY + BEACON_LATE / 2 + BEACON_AIR);
+	int32_t doff = (int32_t)off * 1000 - (int32_t)(d->sync_off * 1000.0);
+	uint16_t aoff = ((doff < 0) ? -doff : doff) / 1000;
+	uint32_t elapsed = (uint32_t)(local - d->sync_clk);
+
+	if (d->beacon_synced && (elapsed >= DRIFT_TIME)) {
+		int16_t res = doff * 10 / (int32_t)elapsed;
+		d->drift += res / 2;
+		dev_set_clock(d, local);
+		d->trim = d->drift / 10.0;
+
+		uint32_t err = ((res < 0) ? -res : res) + DRIFT_NOISE * 10000ul / elapsed;
+		if (err < DRIFT_ERR_MIN)
+			err = DRIFT_ERR_MIN;
+		if (err > DRIFT_ERR_MAX)
+			err = DRIFT_ERR_MAX;
+		d->drift_err = err;
+
+		if (aoff <= SYNC_BAND / 2) {
+			uint16_t sint = d->sync_int * 2;
+			d->sync_int = (sint > SYNC_INT_MAX) ? SYNC_INT_MAX : sint;
+		}
+		else if (aoff > SYNC_BAND)
+			d->sync_int = (d->sync_int / 2 < cfg.tsync) ? cfg.tsync : d->sync_int / 2;
+	}
+
+	double steps = ceil(off / 31.25);
+	d->sync_off = off - steps * 31.25;
+	local -= steps / 32.0;
+	dev_set_clock(d, local);
+	d->sync_clk = local;
+	d->sync_err = SYNC_ERR_BEACON;
+	d->beacon_synced = 1;
+}
+
+// process_cmd(), commands to always active nodes are not simulated
+static void process_cmd(sim_dev_t *d, dnode_t *msg)
+{
+	if (msg->nid & NODE_TSYNC)
+		sync_time(d, msg);
+}
+
+static void node_session(sim_dev_t *d)
+{
+	d->st.sess++;
+	if (d->rt_flags & RT_TSYNCED) {
+		double err = fabs(dev_clock(d) - dev_clock(&dev[SIM_BASE]));
+		d->st.err_sum += err;
+		d->st.nerr++;
+		if (err > d->st.err_max)
+			d->st.err_max = err;
+	}
+
+	d->dval.stat &= ~(STAT_LED | STAT_SLEEP | STAT_EOS);
+	d->dval.stat |= STAT_SLEEP;
+
+	// sens_start(), sensors due this minute by their periods
+	uint8_t mask = (1 << cfg.nsens) - 1;
+	uint8_t min = (uint8_t)(d->tick / 60) % 60;
+	if (d->rt_flags & RT_DATA_INIT)
+		d->due = mask;
+	else {
+		// repeated session in the same minute sends the same sensors
+		if (min != d->sens_min) {
+			d->sens_min = min;
+			d->sens_due = 0;
+			for(uint8_t n = 0; n < cfg.nsens; n++) {
+				if (--d->sens_cnt[n] == 0) {
+					d->sens_cnt[n] = cfg.period[n];
+					d->sens_due |= 1 << n;
+				}
+			}
+		}
+		d->due = d->sens_due;
+	}
+	d->item = (uint32_t)(d->tick / 60) + 1;
+	d->sens = 0;
+	// the last reading is re-sent if no sensor is due
+	d->alive = !d->due;
+	if (d->alive) {
+		d->due = 0x01;
+		d->dval.nid &= ~NODE_TSYNC;
+	}
+	else {
+		while(!(d->due & (1 << d->sens)))
+			d->sens++;
+		d->due >>= d->sens;
+	}
+	d->step = NODE_READ;
+	dev_timer(d, sim_now + cfg.read_ms * SIM_MS);
+}
+
+static void node_read(sim_dev_t *d)
+{
+	uint8_t n = d->sens;
+
+	// reading of this sensor in this minute is to be delivered
+	if (!d->alive) {
+		if (d->item_cnt[n] != d->item) {
+			d->item_cnt[n] = d->item;
+			d->st.items++;
+			d->t_data = sim_now;
+		}
+		d->dval.nid = SET_NID(d->id, n + 1);
+		d->dval.data.v16 = (uint16_t)d->item;
+	}
+
+	if (d->due == 0x01) {
+		d->dval.stat |= STAT_EOS;
+		uint8_t beacon = d->sync_err && (d->beacon_miss < BEACON_MISS);
+		if ((d->isync >= cfg.tsync && !beacon) || !(d->rt_flags & RT_TSYNCED)) {
+			d->dval.nid |= NODE_TSYNC; // request time sync
+			d->st.sync_req++;
+		}
+	}
+	d->step = NODE_SEND;
+	chan_send(d, &d->dval);
+}
+
+static void node_rx_done(sim_dev_t *d)
+{
+	if (d->dval.nid & NODE_TSYNC) {
+		d->dval.nid &= ~NODE_TSYNC;
+		d->isync = 0;
+		if (d->sync_err && d->beacon_miss)
+			d->beacon_miss = BEACON_MISS - 1;
+	}
+	node_sleep(d);
+}
+
+// beacon_listen(), radio is off till the window opens
+static void node_beacon(sim_dev_t *d)
+{
+	d->rt_flags &= ~RT_DATA_SENT;
+	uint32_t elapsed = (uint32_t)(dev_clock(d) - d->sync_clk);
+	uint32_t guard = d->sync_err + elapsed * d->drift_err / 10000;
+	if (guard > 999)
+		guard = 999;
+	uint16_t open  = (guard < BEACON_DELAY) ? BEACON_DELAY - guard : 0;
+	uint16_t close = BEACON_DELAY + BEACON_LATE + BEACON_AIR + guard;
+	if (close > 1000)
+		close = 1000;
+	d->bcn_close = close;
+	d->step = NODE_BCN_WAIT;
+	dev_timer(d, dev_clock_at(d, d->tick + rtc_ms_at(open)));
+}
+
+static void node_beacon_done(sim_dev_t *d, dnode_t *msg)
+{
+	if (msg) {
+		beacon_sync(d);
+		d->isync = 0;
+		d->beacon_miss = 0;
+		d->st.bcn_ok++;
+	}
+	else {
+		d->beacon_miss++;
+		d->st.bcn_miss++;
+	}
+	node_sleep(d);
+}
+
+static void node_sent(sim_dev_t *d)
+{
+	// next due sensor
+	do {
+		d->due >>= 1;
+		d->sens++;
+	} while(d->due && !(d->due & 0x01));
+
+	if (d->due) {
+		d->step = NODE_READ;
+		radio_set(d, RADIO_OFF);
+		dev_timer(d, sim_now + cfg.read_ms * SIM_MS);
+		return;
+	}
+
+	d->rt_flags &= ~RT_DATA_INIT;
+	d->rt_flags |= RT_DATA_SENT;
+	d->isync++;
+	if (d->dval.nid & NODE_TSYNC) {
+		radio_set(d, RADIO_RX);
+		d->step = NODE_RX;
+		dev_timer(d, sim_now + REPLY_TIMEOUT * SIM_MS);
+		return;
+	}
+	node_sleep(d);
+}
+
+static void node_boot(sim_dev_t *d)
+{
+	dnode_t msg;
+	msg.nid = NODE_TSYNC | SENS_LIST | d->id;
+	msg.data.v16 = 0;
+	for(uint8_t i = 1; i <= cfg.nsens; i++)
+		set_sens_type(&msg, i, SENS_TEMPER);
+	d->boot++;
+	d->st.sync_req++;
+	d->step = NODE_BOOT;
+	chan_send(d, &msg);
+}
+
+static void node_boot_done(sim_dev_t *d)
+{
+	// rfm12_battery() leaves radio in idle mode
+	d->rt_flags |= RT_DATA_INIT;
+	node_sleep(d);
+}
+
+void node_init(sim_dev_t *d)
+{
+	d->rt_flags = 0;
+	d->isync = cfg.tsync - 1; // re-sync time at the first data poll
+	d->sync_int = cfg.tsync;
+	d->drift_err = DRIFT_ERR_MAX;
+	d->sens_min = 0xFF;
+	for(uint8_t n = 0; n < MAX_SENSORS; n++)
+		d->sens_cnt[n] = 1; // poll at the first session
+	d->dval.stat = 0x0A; // 3.3V
+	// nodes are powered on during the first minute, RTC starts at 00:00:00
+	d->clk_ref = (int64_t)(sim_urand() * 60 * SIM_SEC);
+	d->clk_off = 0;
+	d->ppm = (2.0 * sim_urand() - 1.0) * cfg.drift;
+	d->step = NODE_BOOT_DL;
+	dev_timer(d, d->clk_ref);
+}
+
+void node_timer(sim_dev_t *d)
+{
+	switch(d->step) {
+	case NODE_BOOT_RX:
+		// radio is left in RX mode during the delay
+		d->step = NODE_BOOT_DL;
+		dev_timer(d, sim_now + BOOT_DELAY * SIM_MS);
+		break;
+	case NODE_BOOT_DL:
+		if (d->boot < BOOT_TRIES)
+			node_boot(d);
+		else
+			node_boot_done(d);
+		break;
+	case NODE_SLEEP:
+		if ((d->rt_flags & RT_DATA_INIT) ||
+			(node_ttp(d, d->tick) && !(d->rt_flags & RT_DATA_SENT)))
+			node_session(d);
+		else if (node_beacon_due(d, d->tick))
+			node_beacon(d);
+		else
+			node_sleep(d);
+		break;
+	case NODE_BCN_WAIT:
+		radio_set(d, RADIO_RX);
+		d->step = NODE_BCN_RX;
+		dev_timer(d, dev_clock_at(d, d->tick + rtc_ms_at(d->bcn_close)));
+		break;
+	case NODE_BCN_RX:
+		node_beacon_done(d, NULL);
+		break;
+	case NODE_READ:
+		node_read(d);
+		break;
+	case NODE_RX:
+		node_rx_done(d);
+		break;
+	}
+}
+
+void node_recv(sim_dev_t *d, dnode_t *msg)
+{
+	if (d->step == NODE_BOOT_RX) {
+		if (msg->nid == NODE_TSYNC) {
+			sync_time(d, msg);
+			d->st.sync_ok++;
+			node_boot_done(d);
+			return;
+		}
+		// any other message ends rf_receive() as well
+		node_timer(d);
+		return;
+	}
+
+	if (d->step == NODE_BCN_RX) {
+		if (msg->nid == NODE_TSYNC)
+			node_beacon_done(d, msg);
+		return;
+	}
+
+	// NODE_RX: process messages till time sync reply
+	process_cmd(d, msg);
+	if (msg->nid == NODE_TSYNC) {
+		d->st.sync_ok++;
+		node_rx_done(d);
+	}
+	else
+		dev_timer(d, sim_now + REPLY_TIMEOUT * SIM_MS);
+}
+
+// base local time sec and msec since its tick, time sync to dest
+static void base_tsync(sim_dev_t *d, dnode_t *msg, double local, uint8_t dest)
+{
+	int64_t sec = (int64_t)floor(local) % 86400;
+	msg->raw[0] = sec / 3600;
+	msg->raw[1] = (sec / 60) % 60;
+	msg->raw[2] = sec % 60;
+	msg->nid = NODE_TSYNC;
+	ts_pack(msg, dest);
+	// tsync_send() adds RTC phase if CLKOUT ticks are available
+	if (cfg.beacon)
+		msg->raw[0] |= ts_phase_pack((uint16_t)((local - floor(local)) * 1000.0));
+}
+
+// tsync_beacon() is polled by rf_task, main loop jitter is up to BEACON_LATE
+static void base_beacon_next(sim_dev_t *d)
+{
+	double local = dev_clock(d);
+	double t = (floor((local - BEACON_SEC) / (BEACON_PERIOD * 60)) + 1) * BEACON_PERIOD * 60 + BEACON_SEC;
+	t += (BEACON_DELAY + sim_urand() * BEACON_LATE) / 1000.0;
+	sim_sched(dev_clock_at(d, t), EV_BEACON, d->id, 0);
+}
+
+void base_beacon(sim_dev_t *d)
+{
+	// skipped while a reply to a node is pending or on air
+	if (d->step == BASE_RX) {
+		dnode_t msg;
+		base_tsync(d, &msg, dev_clock(d), 0);
+		d->step = BASE_SEND;
+		chan_send(d, &msg);
+		d->st.bcn_ok++;
+	}
+	else
+		d->st.bcn_miss++;
+	base_beacon_next(d);
+}
+
+void base_init(sim_dev_t *d)
+{
+	d->ppm = cfg.base_ppm;
+	d->clk_ref = 0;
+	d->clk_off = 0;
+	d->step = BASE_RX;
+	radio_set(d, RADIO_RX);
+	if (cfg.beacon)
+		base_beacon_next(d);
+}
+
+// message is received outside of the node's 5 seconds slot
+static uint8_t base_late(sim_dev_t *s)
+{
+	int64_t sec = (int64_t)floor(dev_clock(&dev[SIM_BASE]));
+	int64_t slot = (s->id - 1) * 5;
+	if ((sec - slot + 60) % 60 < 5)
+		return 0;
+	if (cfg.repeat && (s->id <= 6) && ((sec - slot - 30 + 60) % 60 < 5))
+		return 0;
+	return 1;
+}
+
+void base_recv(sim_dev_t *d, dnode_t *msg, sim_dev_t *s)
+{
+	uint8_t dan = GET_NID(msg->nid);
+	if (!dan || dan > NODE_LBS)
+		return;
+
+	if (dan != NODE_LBS && dan == s->id) {
+		// update_screen() shows the node late after 2 minutes without frames
+		if (s->last_rx && (sim_now - s->last_rx >= 120 * SIM_SEC))
+			s->st.gaps++;
+		s->last_rx = sim_now;
+	}
+
+	if (dan != NODE_LBS && dan == s->id && !s->alive && (msg->nid & SENS_MASK) != SENS_LIST) {
+		if (base_late(s))
+			s->st.late++;
+		uint8_t n = s->sens;
+		if (s->item_rx[n] != s->item) {
+			s->item_rx[n] = s->item;
+			s->st.dlvd++;
+			int64_t lat = sim_now - s->t_data;
+			s->st.lat_sum += lat;
+			if (lat > s->st.lat_max)
+				s->st.lat_max = lat;
+		}
+	}
+
+	if (msg->nid & NODE_TSYNC) { // remote node requests time sync
+		// time is taken when the reply is sent,
+		// io_handler() uses zero based node index as destination
+		double local = dev_clock(d) + cfg.turn_ms / 1000.0;
+		base_tsync(d, &d->reply, local, (dan != NODE_LBS) ? dan - 1 : dan);
+		d->step = BASE_REPLY;
+		dev_timer(d, sim_now + cfg.turn_ms * SIM_MS);
+	}
+}
+
+void base_timer(sim_dev_t *d)
+{
+	if (d->step == BASE_REPLY) {
+		d->step = BASE_SEND;
+		chan_send(d, &d->reply);
+	}
+}
+
+void dev_tx_done(sim_dev_t *d)
+{
+	if (d->id == SIM_BASE) {
+		d->step = BASE_RX;
+		radio_set(d, RADIO_RX);
+		return;
+	}
+
+	if (d->step == NODE_BOOT) {
+		radio_set(d, RADIO_RX);
+		d->step = NODE_BOOT_RX;
+		dev_timer(d, sim_now + REPLY_TIMEOUT * SIM_MS);
+		return;
+	}
+	node_sent(d);
+}
+
+uint8_t dev_listening(sim_dev_t *d)
+{
+	if (d->id == SIM_BASE)
+		return d->step == BASE_RX;
+	return (d->step == NODE_BOOT_RX) || (d->step == NODE_RX) || (d->step == NODE_BCN_RX);
+}
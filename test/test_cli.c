@@ -27,6 +27,9 @@
 #include "timer.h"
 #include "i2cmem.h"
 #include "bmp180.h"
+#include "pcf2127.h"
+#include "ossd_i2c.h"
+#include "i2cmaster.h"
 #include "ds18x.h"
 #include "serial.h"
 #include "serial_cli.h"
@@ -35,27 +38,9 @@
 
 static const char version[] PROGMEM = "2015-12-06\n";
 
-// list of supported commands 
-const char cmd_list[] PROGMEM = 
-	"  mem\n"
-	"  time\n"
-	"  reset\n"
-	"  status\n"
-	"  calibrate\n"
-	"  led on|off\n"
-	"  set osccal X\n"
-	"  set time hh:mm:ss\n"
-	"  adc chan\n"
-	"  get pin (d3,b4,c2...)\n"
-	"  set pin (d3,b4,c2...)\n"
-	"  bmp init|poll\n"
-	"  ds init|get|start|read|data|write\n"
-	"  i2cmem init [hex]\n"
-	"  i2cmem write addr val\n"
-	"  i2cmem dump [addr [len]]\n";
-
 static bmp180_t bmp;
 static uint8_t ds_pin = PNB1;
+static ds_bus_t ds_bus;
 
 uint8_t strnum(const char *str, uint8_t base)
 {
@@ -69,268 +54,455 @@ uint8_t strnum(const char *str, uint8_t base)
 	return num;
 }
 
-int8_t cli_test(char *buf, void *ptr)
+extern const cli_cmd_t test_cmds[];
+
+static int8_t cmd_help(char *arg UNUSED, void *ptr UNUSED)
 {
-	char *arg;
-	char cmd[CMD_LEN + 1];
+	uart_puts_p(PSTR("  version: "));
+	uart_puts_p(version);
+	cli_help(test_cmds);
+	return 0;
+}
 
-	ptr = ptr; // unused
-	memcpy(cmd, buf, sizeof(cmd));
-	arg = get_arg(cmd);
+// SW reset
+static int8_t cmd_reset(char *arg UNUSED, void *ptr UNUSED)
+{
+	puts_P(PSTR("\nresetting..."));
+	wdt_enable(WDTO_15MS);
+	while(1);
+	return 0;
+}
 
-	if (str_is(cmd, PSTR("help"))) {
-		uart_puts_p(PSTR("  version: "));
-		uart_puts_p(version);
-		uart_puts_p(cmd_list);
-		return 0;
-	}
+static int8_t cmd_time(char *arg UNUSED, void *ptr UNUSED)
+{
+	char buf[16];
+	get_time(buf);
+	printf_P(PSTR("%s\n"), buf);
+	return 0;
+}
 
-	// SW reset
-	if (str_is(cmd, PSTR("reset"))) {
-		puts_P(PSTR("\nresetting..."));
-		wdt_enable(WDTO_15MS);
-		while(1);
-	}
+static int8_t cmd_led(char *arg, void *ptr UNUSED)
+{
+	int8_t on = get_on_off(arg);
+	if (on == 1)
+		active |= ACTIVE_DLED;
+	if (on == 0)
+		active &= ~ACTIVE_DLED;
+	printf_P(PSTR("led is %s\n"), is_on(active & ACTIVE_DLED));
+	return 0;
+}
 
-	if (str_is(cmd, PSTR("mem"))) {
-		printf_P(PSTR("memory %d\n"), free_mem());
-		return 0;
-	}
+static int8_t cmd_status(char *arg UNUSED, void *ptr UNUSED)
+{
+	print_status();
+	return 0;
+}
 
-	if (str_is(cmd, PSTR("time"))) {
-		get_time(cmd);
-		printf_P(PSTR("%s\n"), cmd);
-		return 0;
+static int8_t i2cmem_dump(char *arg, void *ptr UNUSED)
+{
+	char *sval1 = get_arg(arg);
+	uint16_t val0 = atoi(arg);
+	uint16_t val1 = atoi(sval1);
+	if (val1 == 0)
+		val1 = 256;
+	for(uint16_t i = 0; i < val1; i++) {
+		uint8_t data;
+		if (i2cmem_read_data(val0 + i, &data, 1) != 0)
+			return CLI_ENODEV;
+		if (!(i % 16) && i)
+			uart_puts("\n");
+		printf(" %02X", data);
 	}
+	uart_puts("\n");
+	return 0;
+}
 
-	if (str_is(cmd, PSTR("led"))) {
-		if (str_is(arg, PSTR("on")))
-			active |= ACTIVE_DLED;
-		if (str_is(arg, PSTR("off")))
-			active &= ~ACTIVE_DLED;
-		printf_P(PSTR("%s is %s\n"), cmd, is_on(active & ACTIVE_DLED));
+static int8_t i2cmem_write(char *arg, void *ptr UNUSED)
+{
+	char *sval1 = get_arg(arg);
+	uint16_t val0 = atoi(arg);
+	uint8_t data = strnum(sval1, 10);
+	if (i2cmem_write_byte(val0, data) == 0)
 		return 0;
-	}
+	return CLI_ENODEV;
+}
 
-	if (str_is(cmd, PSTR("status"))) {
-		print_status();
-		return 0;
+static int8_t i2cmem_init(char *arg, void *ptr UNUSED)
+{
+	int8_t ret = 0;
+	uint8_t line[I2C_MEM_PAGE_SIZE];
+	uint8_t fill = strnum(arg, 16);
+	memset(line, fill, sizeof(line));
+	uint32_t ms = millis();
+	for(uint16_t page = 0; page < I2C_MEM_MAX_PAGE; page++) {
+		ret = i2cmem_write_page(page, 0, line, I2C_MEM_PAGE_SIZE);
+		if (ret < 0) {
+			printf("error writing page %u\n", page);
+			ret = CLI_ENODEV;
+			break;
+		}
 	}
+	ms = millis() - ms;
+	printf("filled in %lums, %lums per page\n", ms, ms/512);
+	return ret;
+}
 
-	if (str_is(cmd, PSTR("calibrate"))) {
-		puts_P(PSTR("\ncalibrating..."));
-		if (str_is(arg, PSTR("default")))
-			serial_calibrate(osccal_def);
-		else
-			serial_calibrate(OSCCAL);
-		return 0;
-	}
+#define BENCH_LOOPS 32
 
-	if (str_is(cmd, PSTR("i2cmem"))) {
-		char *sval0 = get_arg(arg);
-		char *sval1 = get_arg(sval0);
-		uint16_t val0 = atoi(sval0);
-
-		if (str_is(arg, PSTR("dump"))) {
-			uint16_t val1 = atoi(sval1);
-			if (val1 == 0)
-				val1 = 256;
-			for(uint16_t i = 0; i < val1; i++) {
-				uint8_t data;
-				if (i2cmem_read_data(val0 + i, &data, 1) != 0)
-					return CLI_ENODEV;
-				if (!(i % 16) && i)
-					uart_puts("\n");
-				printf(" %02X", data);
-			}
-			uart_puts("\n");
-			return 0;
-		}
+// average time of one operation in us, or 0 if device did not respond
+static uint16_t bus_time(uint8_t op)
+{
+	uint8_t buf[I2C_MEM_PAGE_SIZE];
+	pcf_td_t td;
 
-		if (str_is(arg, PSTR("write"))) {
-			uint8_t data = strnum(sval1, 10);
-			if (i2cmem_write_byte(val0, data) == 0)
+	uint32_t ms = millis();
+	for(uint8_t i = 0; i < BENCH_LOOPS; i++) {
+		switch(op) {
+		case 0:
+			if (i2cmem_read_data(i * I2C_MEM_PAGE_SIZE, buf, sizeof(buf)) != 0)
 				return 0;
-			return CLI_ENODEV;
-		}
-
-		if (str_is(arg, PSTR("init"))) {
-			int8_t ret;
-			uint8_t line[I2C_MEM_PAGE_SIZE];
-			uint8_t fill = strnum(sval0, 16);
-			memset(line, fill, sizeof(line));
-			uint32_t ms = millis();
-			for(uint16_t page = 0; page < I2C_MEM_MAX_PAGE; page++) {
-				ret = i2cmem_write_page(page, 0, line, I2C_MEM_PAGE_SIZE);
-				if (ret < 0) {
-					printf("error writing page %u\n", page);
-					ret = CLI_ENODEV;
-					break;
-				}
-			}
-			ms = millis() - ms;
-			printf("filled in %lums, %lums per page\n", ms, ms/512);
-			return ret;
+			break;
+		case 1:
+			ossd_putlx(i & 0x07, 0, "0123456789ABCDEF", 0);
+			break;
+		default:
+			if (pcf2127_get_date(&td) != 0)
+				return 0;
+			break;
 		}
 	}
+	ms = millis() - ms;
+	return (ms * 1000) / BENCH_LOOPS;
+}
 
-	if (str_is(cmd, PSTR("set"))) {
-		char *sval = get_arg(arg);
-		if (str_is(arg, PSTR("osccal"))) {
-			uint8_t osc = atoi(sval);
-			serial_set_osccal(osc);
-			eeprom_update_byte(&em_osccal, osc);
-			return 0;
-		}
-		
-		if (str_is(arg, PSTR("time"))) {
-			uint8_t hour, min, sec;
-			hour = strtoul(sval, &arg, 10);
-			if (hour < 24 && *arg == ':') {
-				min = strtoul(arg + 1, &arg, 10);
-				if (min < 60 && *arg == ':') {
-					sec = strtoul(arg + 1, &arg, 10);
-					if (sec < 60) {
-						swtime = hour * 3600;
-						swtime += min*60;
-						swtime += sec;
-						return 0;
-					}
-				}
-			}
-		}
+// times 24C256 page read, SSD1306 text line write and PCF2127 date read
+static int8_t bus_bench(char *arg UNUSED, void *ptr UNUSED)
+{
+	static const uint16_t speed[] PROGMEM = { I2C_SPEED_STD, I2C_SPEED_FAST };
+	uint16_t khz = i2c_get_speed(I2C_ANY);
+	uint8_t oled = (ossd_init(0) == 0);
 
-		if (str_is(arg, PSTR("pin"))) {
-			char   port = sval[0];
-			uint8_t idx = atoi(sval+1) & 0x07;
-			uint8_t val = (atoi(sval+2) & 0x01) << 1;
-			if (port == 'b')
-				_pin_mode(&DDRB, _BV(idx), OUTPUT | val);
-			else
-			if (port == 'c')
-				_pin_mode(&DDRC, _BV(idx), OUTPUT | val);
-			else
-			if (port == 'd')
-				_pin_mode(&DDRD, _BV(idx), OUTPUT | val);
-			else
-				return -1;
-			printf_P(PSTR("%c%d = %d\n"), port, idx, !!val);
-			return 0;
-		}
+	puts_P(PSTR("  kHz   page   line    rtc (us)"));
+	for(uint8_t i = 0; i < sizeof(speed)/sizeof(speed[0]); i++) {
+		uint16_t us[3];
+		i2c_set_speed(I2C_ANY, pgm_read_word(&speed[i]));
+		for(uint8_t op = 0; op < 3; op++)
+			us[op] = (op != 1 || oled) ? bus_time(op) : 0;
+		printf_P(PSTR("%5u %6u %6u %6u\n"), pgm_read_word(&speed[i]), us[0], us[1], us[2]);
+	}
+	if (oled)
+		ossd_cls();
 
-		return -1;
+	i2c_set_speed(I2C_ANY, khz);
+	return 0;
+}
+
+static int8_t bus_speed(char *arg, void *ptr UNUSED)
+{
+	uint16_t khz = atoi(arg);
+	if (khz) {
+		if (khz < 32 || khz > 400)
+			return CLI_EARG;
+		i2c_set_speed(I2C_ANY, khz);
 	}
+	printf_P(PSTR("%u kHz\n"), i2c_get_speed(I2C_ANY));
+	return 0;
+}
 
-	if (str_is(cmd, PSTR("adc"))) {
-		uint8_t ai = atoi((const char *)arg);
-		if (ai < 8) {
-			uint16_t val = analogRead(ai);
-			printf_P(PSTR("ADC %d %4d\n"), ai, val);
-			return 0;
-		}
+static int8_t set_osccal(char *arg, void *ptr UNUSED)
+{
+	uint8_t osc = atoi(arg);
+	serial_set_osccal(osc);
+	eeprom_update_byte(&em_osccal, osc);
+	return 0;
+}
+
+static int8_t set_time(char *arg, void *ptr UNUSED)
+{
+	uint8_t hms[3];
+	if (get_hms(arg, hms) != 0)
+		return CLI_EARG;
+	swtime = hms[0] * 3600;
+	swtime += hms[1]*60;
+	swtime += hms[2];
+	return 0;
+}
+
+static int8_t set_pin(char *arg, void *ptr UNUSED)
+{
+	char   port = arg[0];
+	uint8_t idx = atoi(arg+1) & 0x07;
+	uint8_t val = (atoi(arg+2) & 0x01) << 1;
+	if (port == 'b')
+		_pin_mode(&DDRB, _BV(idx), OUTPUT | val);
+	else
+	if (port == 'c')
+		_pin_mode(&DDRC, _BV(idx), OUTPUT | val);
+	else
+	if (port == 'd')
+		_pin_mode(&DDRD, _BV(idx), OUTPUT | val);
+	else
 		return -1;
-	}
+	printf_P(PSTR("%c%d = %d\n"), port, idx, !!val);
+	return 0;
+}
 
-	if (str_is(cmd, PSTR("get"))) {
-		char   port = arg[0];
-		uint8_t idx = atoi(arg+1) & 0x07;
-		uint8_t val = 0;
-		if (port == 'b') {
-			_pin_mode(&DDRB, _BV(idx), INPUT_UP);
-			val++;
-			val = _pin_get(&PINB, _BV(idx));
-		}
-		else
-		if (port == 'c') {
-			_pin_mode(&DDRC, _BV(idx), INPUT_UP);
-			val++;
-			val = _pin_get(&PINC, _BV(idx));
-		}
-		else
-		if (port == 'd') {
-			_pin_mode(&DDRD, _BV(idx), INPUT_UP);
-			val++;
-			val = _pin_get(&PIND, _BV(idx));
-		}
-		else
-			return -1;
-		printf_P(PSTR("%c%d = %d\n"), port, idx, !!val);
+static int8_t cmd_adc(char *arg, void *ptr UNUSED)
+{
+	uint8_t ai = atoi((const char *)arg);
+	if (ai < 8) {
+		uint16_t val = analogRead(ai);
+		printf_P(PSTR("ADC %d %4d\n"), ai, val);
 		return 0;
 	}
+	return -1;
+}
 
-	if (str_is(cmd, PSTR("bmp"))) {
-		if (str_is(arg, PSTR("init"))) {
-			int8_t error = bmp180_init(&bmp);
-			if (error)
-				printf_P(PSTR("bmp180 init error %d\n"), error);
-			return 0;
-		}
-		if (str_is(arg, PSTR("poll"))) {
-			int8_t error = bmp180_poll(&bmp, BMP180_T_MODE);
-			if (bmp.valid & BMP180_T_VALID) {
-				int8_t t = get_u8val(bmp.t);
-				printf("t %d.%02u\n", t, bmp.tdec);
-			}
-			else
-				printf_P(PSTR("bmp180 init error %d\n"), error);
-			return 0;
-		}
+static int8_t cmd_get(char *arg, void *ptr UNUSED)
+{
+	char   port = arg[0];
+	uint8_t idx = atoi(arg+1) & 0x07;
+	uint8_t val = 0;
+	if (port == 'b') {
+		_pin_mode(&DDRB, _BV(idx), INPUT_UP);
+		val++;
+		val = _pin_get(&PINB, _BV(idx));
+	}
+	else
+	if (port == 'c') {
+		_pin_mode(&DDRC, _BV(idx), INPUT_UP);
+		val++;
+		val = _pin_get(&PINC, _BV(idx));
+	}
+	else
+	if (port == 'd') {
+		_pin_mode(&DDRD, _BV(idx), INPUT_UP);
+		val++;
+		val = _pin_get(&PIND, _BV(idx));
+	}
+	else
 		return -1;
+	printf_P(PSTR("%c%d = %d\n"), port, idx, !!val);
+	return 0;
+}
+
+static int8_t bmp_init(char *arg UNUSED, void *ptr UNUSED)
+{
+	int8_t error = bmp180_init(&bmp);
+	if (error)
+		printf_P(PSTR("bmp180 init error %d\n"), error);
+	return 0;
+}
+
+static int8_t bmp_poll(char *arg UNUSED, void *ptr UNUSED)
+{
+	int8_t error = bmp180_poll(&bmp, BMP180_T_MODE);
+	if (bmp.valid & BMP180_T_VALID) {
+		int8_t t = get_u8val(bmp.t);
+		printf("t %d.%02u\n", t, bmp.tdec);
 	}
+	else
+		printf_P(PSTR("bmp180 init error %d\n"), error);
+	return 0;
+}
 
-	if (str_is(cmd, PSTR("ds"))) {
-		if (str_is(arg, PSTR("init"))) {
-			int8_t error = ds18x_init(ds_pin, DSx18_TYPE_B);
-			if (error)
-				printf_P(PSTR("ds1820 init error %d\n"), error);
-			return 0;
-		}
-		if (str_is(arg, PSTR("get"))) {
-			ds_temp_t t;
-			uint8_t buf[DS18x_PAD_LEN];
-			int8_t error = ds18x_get_temp(ds_pin, &t, buf);
-			for (uint8_t i = 0; i < DS18x_PAD_LEN; i++)
-				printf("%02X ", buf[i]);
-			printf("%d.%u\n", t.val, t.dec);
-			if (error)
-				printf_P(PSTR("ds1820 get error %d\n"), error);
-			return 0;
-		}
-		if (str_is(arg, PSTR("read"))) {
-			ds_temp_t t;
-			uint8_t buf[DS18x_PAD_LEN];
-			int8_t error = ds18x_read_temp(ds_pin, &t, buf);
-			for (uint8_t i = 0; i < DS18x_PAD_LEN; i++)
-				printf("%02X ", buf[i]);
-			printf("%d.%u\n", t.val, t.dec);
-			if (error)
-				printf_P(PSTR("ds1820 read error %d\n"), error);
-			return 0;
-		}
-		if (str_is(arg, PSTR("start"))) {
-			int8_t error = ds18x_cmd(ds_pin, DS18x_CMD_COVERT);
-			if (error)
-				printf_P(PSTR("ds1820 start error %d\n"), error);
-			return 0;
-		}
-		if (str_is(arg, PSTR("data"))) {
-			uint16_t data;
-			int8_t error = ds18x_read_data(ds_pin, &data);
-			printf_P(PSTR("ds1820 data %u\n"), data);
-			if (error)
-				printf_P(PSTR("ds1820 data error %d\n"), error);
-			return 0;
-		}
-		if (str_is(arg, PSTR("write"))) {
-			uint16_t data = uptime;
-			int8_t error = ds18x_wite_data(ds_pin, data);
-			printf_P(PSTR("ds1820 data %u\n"), data);
-			if (error)
-				printf_P(PSTR("ds1820 write error %d\n"), error);
+static int8_t ds_init(char *arg UNUSED, void *ptr UNUSED)
+{
+	int8_t error = ds18x_init(ds_pin, DSx18_TYPE_B);
+	if (error)
+		printf_P(PSTR("ds1820 init error %d\n"), error);
+	return 0;
+}
+
+static void ds_print(ds_temp_t *t, uint8_t *buf)
+{
+	for (uint8_t i = 0; i < DS18x_PAD_LEN; i++)
+		printf("%02X ", buf[i]);
+	printf("%s%d.%u\n", (t->neg && !t->val) ? "-" : "", t->val, t->dec);
+}
+
+static int8_t ds_get(char *arg UNUSED, void *ptr UNUSED)
+{
+	ds_temp_t t;
+	uint8_t buf[DS18x_PAD_LEN];
+	int8_t error = ds18x_get_temp(ds_pin, &t, buf);
+	ds_print(&t, buf);
+	if (error)
+		printf_P(PSTR("ds1820 get error %d\n"), error);
+	return 0;
+}
+
+static int8_t ds_read(char *arg UNUSED, void *ptr UNUSED)
+{
+	ds_temp_t t;
+	uint8_t buf[DS18x_PAD_LEN];
+	int8_t error = ds18x_read_temp(ds_pin, &t, buf);
+	ds_print(&t, buf);
+	if (error)
+		printf_P(PSTR("ds1820 read error %d\n"), error);
+	return 0;
+}
+
+static int8_t ds_start(char *arg UNUSED, void *ptr UNUSED)
+{
+	int8_t error = ds18x_cmd(ds_pin, DS18x_CMD_COVERT);
+	if (error)
+		printf_P(PSTR("ds1820 start error %d\n"), error);
+	return 0;
+}
+
+static int8_t ds_data(char *arg UNUSED, void *ptr UNUSED)
+{
+	uint16_t data;
+	int8_t error = ds18x_read_data(ds_pin, &data);
+	printf_P(PSTR("ds1820 data %u\n"), data);
+	if (error)
+		printf_P(PSTR("ds1820 data error %d\n"), error);
+	return 0;
+}
+
+static int8_t ds_write(char *arg UNUSED, void *ptr UNUSED)
+{
+	uint16_t data = uptime;
+	int8_t error = ds18x_wite_data(ds_pin, data);
+	printf_P(PSTR("ds1820 data %u\n"), data);
+	if (error)
+		printf_P(PSTR("ds1820 write error %d\n"), error);
+	return 0;
+}
+
+static void ds_print_bus(void)
+{
+	for (uint8_t n = 0; n < ds_bus.ndev; n++) {
+		printf("%u: ", n);
+		for (uint8_t i = 0; i < DS18x_ROM_LEN; i++)
+			printf("%02X", ds_bus.rom[n][i]);
+		printf("\n");
+	}
+}
+
+static int8_t ds_scan(char *arg UNUSED, void *ptr UNUSED)
+{
+	int8_t ndev = ds18x_bus_init(&ds_bus, ds_pin, 1);
+	if (ndev < 0)
+		printf_P(PSTR("ds1820 scan error %d\n"), ndev);
+	ds_print_bus();
+	return 0;
+}
+
+static int8_t ds_all(char *arg UNUSED, void *ptr UNUSED)
+{
+	ds_temp_t t[DS18x_BUS_DEV];
+	if (ds_bus.ndev == 0) {
+		// device table cached by the last 'ds scan'
+		int8_t ndev = ds18x_bus_init(&ds_bus, ds_pin, 0);
+		if (ndev < 0) {
+			printf_P(PSTR("ds1820 bus error %d\n"), ndev);
 			return 0;
 		}
-		return CLI_EARG;
 	}
 
-	return CLI_ENOTSUP;
+	uint32_t start = millis();
+	int8_t error = ds18x_bus_get_temp(&ds_bus, t);
+	uint32_t dt = millis() - start;
+	if (error)
+		printf_P(PSTR("ds1820 bus error %d\n"), error);
+	for (uint8_t n = 0; n < ds_bus.ndev; n++)
+		printf("%u: %s%d.%u\n", n, (t[n].neg && !t[n].val) ? "-" : "", t[n].val, t[n].dec);
+	printf_P(PSTR("%lu msec\n"), dt);
+	return 0;
+}
+
+static const char pstr_help[] PROGMEM = "help";
+static const char pstr_mem[] PROGMEM = "mem";
+static const char pstr_time[] PROGMEM = "time";
+static const char pstr_reset[] PROGMEM = "reset";
+static const char pstr_status[] PROGMEM = "status";
+static const char pstr_calibrate[] PROGMEM = "calibrate";
+static const char pstr_led[] PROGMEM = "led on|off";
+static const char pstr_set[] PROGMEM = "set";
+static const char pstr_osccal[] PROGMEM = "osccal X";
+static const char pstr_set_time[] PROGMEM = "time hh:mm:ss";
+static const char pstr_set_pin[] PROGMEM = "pin (d3,b4,c2...)";
+static const char pstr_adc[] PROGMEM = "adc chan";
+static const char pstr_get[] PROGMEM = "get pin (d3,b4,c2...)";
+static const char pstr_bmp[] PROGMEM = "bmp init|poll";
+static const char pstr_init[] PROGMEM = "init";
+static const char pstr_poll[] PROGMEM = "poll";
+static const char pstr_ds[] PROGMEM = "ds init|get|start|read|data|write|scan|all";
+static const char pstr_ds_get[] PROGMEM = "get";
+static const char pstr_ds_read[] PROGMEM = "read";
+static const char pstr_ds_start[] PROGMEM = "start";
+static const char pstr_ds_data[] PROGMEM = "data";
+static const char pstr_ds_write[] PROGMEM = "write";
+static const char pstr_ds_scan[] PROGMEM = "scan";
+static const char pstr_ds_all[] PROGMEM = "all";
+static const char pstr_i2cmem[] PROGMEM = "i2cmem";
+static const char pstr_i2cmem_init[] PROGMEM = "init [hex]";
+static const char pstr_i2cmem_write[] PROGMEM = "write addr val";
+static const char pstr_i2cmem_dump[] PROGMEM = "dump [addr [len]]";
+static const char pstr_bus[] PROGMEM = "bus bench|speed";
+static const char pstr_bus_bench[] PROGMEM = "bench";
+static const char pstr_bus_speed[] PROGMEM = "speed [kHz]";
+
+static const cli_cmd_t set_cmds[] PROGMEM = {
+	{ pstr_osccal, set_osccal, NULL },
+	{ pstr_set_time, set_time, NULL },
+	{ pstr_set_pin, set_pin, NULL },
+	{ NULL, NULL, NULL }
+};
+
+static const cli_cmd_t bmp_cmds[] PROGMEM = {
+	{ pstr_init, bmp_init, NULL },
+	{ pstr_poll, bmp_poll, NULL },
+	{ NULL, NULL, NULL }
+};
+
+static const cli_cmd_t ds_cmds[] PROGMEM = {
+	{ pstr_init, ds_init, NULL },
+	{ pstr_ds_get, ds_get, NULL },
+	{ pstr_ds_read, ds_read, NULL },
+	{ pstr_ds_start, ds_start, NULL },
+	{ pstr_ds_data, ds_data, NULL },
+	{ pstr_ds_write, ds_write, NULL },
+	{ pstr_ds_scan, ds_scan, NULL },
+	{ pstr_ds_all, ds_all, NULL },
+	{ NULL, NULL, NULL }
+};
+
+static const cli_cmd_t i2cmem_cmds[] PROGMEM = {
+	{ pstr_i2cmem_init, i2cmem_init, NULL },
+	{ pstr_i2cmem_write, i2cmem_write, NULL },
+	{ pstr_i2cmem_dump, i2cmem_dump, NULL },
+	{ NULL, NULL, NULL }
+};
+
+static const cli_cmd_t bus_cmds[] PROGMEM = {
+	{ pstr_bus_bench, bus_bench, NULL },
+	{ pstr_bus_speed, bus_speed, NULL },
+	{ NULL, NULL, NULL }
+};
+
+// list of supported commands 
+const cli_cmd_t test_cmds[] PROGMEM = {
+	{ pstr_help, cmd_help, NULL },
+	{ pstr_mem, cli_mem, NULL },
+	{ pstr_time, cmd_time, NULL },
+	{ pstr_reset, cmd_reset, NULL },
+	{ pstr_status, cmd_status, NULL },
+	{ pstr_calibrate, cli_calibrate, NULL },
+	{ pstr_led, cmd_led, NULL },
+	{ pstr_set, NULL, set_cmds },
+	{ pstr_adc, cmd_adc, NULL },
+	{ pstr_get, cmd_get, NULL },
+	{ pstr_bmp, NULL, bmp_cmds },
+	{ pstr_ds, NULL, ds_cmds },
+	{ pstr_i2cmem, NULL, i2cmem_cmds },
+	{ pstr_bus, NULL, bus_cmds },
+	{ NULL, NULL, NULL }
+};
+
+int8_t cli_test(char *buf, void *ptr)
+{
+	return cli_dispatch(test_cmds, buf, ptr);
 }
@@ -26,6 +26,7 @@
 #include "pinio.h"
 #include "mmrio.h"
 #include "timer.h"
+#include "i2cmaster.h"
 #include "serial.h"
 #include "serial_cli.h"
 
@@ -75,6 +76,8 @@ int main(void)
 	// setup our ~millisecond timer for mill*() and tenth_clock counter
 	init_time_clock(CLOCK_TYPE);
 
+	i2c_init(); // needed for i2cmem*, bmp180*, pcf2127* and ossd*
+
 	// reset our soft clock
 	uptime = swtime = 0;
 
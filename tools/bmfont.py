@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+#
+# Converts bitmap fonts made by bdfe (https://github.com/achilikin/bdfe)
+# to glyph layouts and compression supported by lib/bmfont.c
+#
+# Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# usage: bmfont.py [-r] [-c] [-s scale] [-g first-last] font816.h > font.h
+#   -r  BMFONT_ROWS layout, rows of pixels for ILI9225 window writes
+#   -c  BMFONT_RLE, PackBits compressed glyphs with 16 bit offsets table
+#   -s  scale glyphs up, for example 2 makes 16x32 digits from font816.h
+#   -g  subset of glyphs, for example -g 48-58 for digits and colon
+#
+# Output is included into PROGMEM array like fonts made by bdfe,
+# bmfont_t initializer for it is printed at the end.
+
+import argparse
+import re
+import sys
+
+def load(fname):
+    text = open(fname).read()
+    m = re.search(r'Converted Font Size (\d+)x(\d+)', text)
+    if not m:
+        sys.exit('%s: no "Converted Font Size" line' % fname)
+    gw, gh = int(m.group(1)), int(m.group(2))
+    head = [l for l in text.splitlines() if l.startswith('//')]
+    glyphs = []
+    for line in text.splitlines():
+        m = re.match(r'\s*((?:0x[0-9A-Fa-f]{2},?)+)\s*//\s*(\d+)', line)
+        if m:
+            data = [int(x, 16) for x in re.findall(r'0x[0-9A-Fa-f]{2}', m.group(1))]
+            glyphs.append((int(m.group(2)), data))
+    # font6x8.h says 5x8, glyphs have an empty column
+    if glyphs:
+        gw = len(glyphs[0][1]) // ((gh + 7) // 8)
+    return gw, gh, head, glyphs
+
+# page layout (as bdfe makes) to 2D pixels and back
+def to_pixels(data, gw, gh):
+    return [[(data[(y // 8)*gw + x] >> (y % 8)) & 1 for x in range(gw)] for y in range(gh)]
+
+def from_pixels(pix, gw, gh, rows):
+    if rows:
+        rb = (gw + 7) // 8
+        out = [0] * (rb * gh)
+        for y in range(gh):
+            for x in range(gw):
+                if pix[y][x]:
+                    out[y*rb + x // 8] |= 1 << (x % 8)
+        return out
+    out = [0] * (gw * ((gh + 7) // 8))
+    for y in range(gh):
+        for x in range(gw):
+            if pix[y][x]:
+                out[(y // 8)*gw + x] |= 1 << (y % 8)
+    return out
+
+def scale(pix, n):
+    return [[p for p in row for _ in range(n)] for row in pix for _ in range(n)]
+
+# PackBits, must match bmfont_unpack()
+def pack(data):
+    out = []
+    i = 0
+    lit = []
+    while i < len(data):
+        run = 1
+        while i + run < len(data) and data[i + run] == data[i] and run < 129:
+            run += 1
+        if run >= 2:
+            if lit:
+                out += [len(lit) - 1] + lit
+                lit = []
+            out += [0x80 | (run - 2), data[i]]
+            i += run
+        else:
+            lit.append(data[i])
+            if len(lit) == 128:
+                out += [len(lit) - 1] + lit
+                lit = []
+            i += 1
+    if lit:
+        out += [len(lit) - 1] + lit
+    return out
+
+def hexline(data):
+    return ','.join('0x%02X' % b for b in data) + ','
+
+def main():
+    ap = argparse.ArgumentParser(description='convert bdfe font for lib/bmfont.c')
+    ap.add_argument('font')
+    ap.add_argument('-r', '--rows', action='store_true', help='BMFONT_ROWS layout')
+    ap.add_argument('-c', '--rle', action='store_true', help='BMFONT_RLE compression')
+    ap.add_argument('-s', '--scale', type=int, default=1)
+    ap.add_argument('-g', '--glyphs', help='first-last glyph codes')
+    args = ap.parse_args()
+
+    gw, gh, head, glyphs = load(args.font)
+    if args.glyphs:
+        first, last = [int(x) for x in args.glyphs.split('-')]
+        glyphs = [g for g in glyphs if first <= g[0] <= last]
+    if not glyphs:
+        sys.exit('no glyphs')
+
+    ow, oh = gw * args.scale, gh * args.scale
+    if args.scale > 1 and oh % 8:
+        sys.exit('glyph height must be multiple of 8')
+    out = []
+    for code, data in glyphs:
+        pix = to_pixels(data, gw, gh)
+        if args.scale > 1:
+            pix = scale(pix, args.scale)
+        out.append((code, from_pixels(pix, ow, oh, args.rows)))
+
+    gb = len(out[0][1])
+    if gb > 64:
+        print('// warning: %u bytes glyphs do not fit BMFONT_GLYPH_MAX' % gb, file=sys.stderr)
+
+    flags = ['BMFONT_ROWS' if args.rows else 'BMFONT_PAGES']
+    if args.rle:
+        flags.append('BMFONT_RLE')
+    for line in head:
+        if 'Converted Font Size' not in line:
+            print(line)
+    print('// Converted Font Size %ux%u' % (ow, oh))
+    print('// Converted by \'bmfont.py %s\'' % ' '.join(sys.argv[1:]))
+    print('')
+
+    size = 0
+    if args.rle:
+        packed = [(code, pack(data)) for code, data in out]
+        off = 2 * len(packed)
+        print('\t// glyph offsets')
+        for code, data in packed:
+            print('\t%s // %5u' % (hexline([off & 0xFF, off >> 8]), code))
+            off += len(data)
+        print('')
+        out = packed
+        size = off
+    else:
+        size = gb * len(out)
+
+    for code, data in out:
+        ch = chr(code) if 32 <= code < 127 and code not in (39, 92) else ''
+        print('\t%s // %5u \'%s\'' % (hexline(data), code, ch))
+
+    print('')
+    print('// %u bytes, %u uncompressed' % (size, gb * len(out)))
+    print('// { %u, %u, %u, %u, font, %s }' % (ow, oh, out[0][0], len(out), ' | '.join(flags)))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+#
+# Maps 'prof dump' output of the sampling profiler (lib/prof.c)
+# to functions using .lss or .sym file made by firmware Makefiles
+#
+# Copyright (c) 2018 Andrey Chilikin (https://github.com/achilikin)
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# usage: profmap.py base_main.lss prof.txt
+#        profmap.py base_main.sym < prof.txt
+#
+# Sample in a bucket shared by several functions is split between them
+# in proportion to the bytes of the bucket they occupy.
+
+import re
+import sys
+
+LSS_LABEL = re.compile(r'^([0-9a-fA-F]{8}) <([^>]+)>:')
+SYM_LABEL = re.compile(r'^([0-9a-fA-F]+) [tTwW] (\S+)')
+DUMP_HEAD = re.compile(r'^prof (\d+) samples (\d+) Hz bucket (\d+)')
+DUMP_LINE = re.compile(r'^([0-9a-fA-F]{4}) (\d+)$')
+
+def load_symbols(fname):
+    syms = {}
+    with open(fname) as f:
+        for line in f:
+            m = LSS_LABEL.match(line) or SYM_LABEL.match(line)
+            if m:
+                addr = int(m.group(1), 16)
+                # .text only, .data and .bss are at 0x800000 and up
+                if addr < 0x10000:
+                    syms.setdefault(addr, m.group(2))
+    funcs = sorted(syms.items())
+    # function ends where the next one starts
+    spans = []
+    for i, (addr, name) in enumerate(funcs):
+        end = funcs[i + 1][0] if i + 1 < len(funcs) else addr + 2
+        spans.append((addr, end, name))
+    return spans
+
+def load_dump(f):
+    bucket, hz, total, hist = 0, 0, 0, []
+    for line in f:
+        line = line.strip()
+        m = DUMP_HEAD.match(line)
+        if m:
+            total, hz, bucket = int(m.group(1)), int(m.group(2)), int(m.group(3))
+            hist = []
+            continue
+        m = DUMP_LINE.match(line)
+        if m and bucket:
+            hist.append((int(m.group(1), 16), int(m.group(2))))
+    if not bucket:
+        sys.exit('no "prof dump" output found')
+    return bucket, hz, total, hist
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit('usage: %s firmware.lss|firmware.sym [prof.txt]' % sys.argv[0])
+    spans = load_symbols(sys.argv[1])
+    if len(sys.argv) > 2:
+        with open(sys.argv[2]) as f:
+            bucket, hz, total, hist = load_dump(f)
+    else:
+        bucket, hz, total, hist = load_dump(sys.stdin)
+
+    funcs = {}
+    for addr, n in hist:
+        end = addr + bucket
+        overlap = []
+        for start, stop, name in spans:
+            lo, hi = max(start, addr), min(stop, end)
+            if lo < hi:
+                overlap.append((name, hi - lo))
+        if not overlap:
+            overlap = [('0x%04X' % addr, bucket)]
+        size = sum(b for _, b in overlap)
+        for name, b in overlap:
+            funcs[name] = funcs.get(name, 0) + n * b / size
+
+    counted = sum(n for _, n in hist)
+    print('%u samples at %u Hz, %.1f sec, %u bytes buckets' % (total, hz, total / hz if hz else 0, bucket))
+    print('%9s %7s  %s' % ('samples', '%', 'function'))
+    for name, n in sorted(funcs.items(), key=lambda x: -x[1]):
+        print('%9.1f %6.2f%%  %s' % (n, 100.0 * n / counted if counted else 0, name))
+
+if __name__ == '__main__':
+    main()